@@ -0,0 +1,106 @@
+/**
+ * @file bench_data.hpp
+ * @brief synthetic input data shared by the benchmarks
+ */
+
+#pragma once
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+#include "KatherineEmulator.hpp"
+#include "ShowerGenerator.hpp"
+#include "globals.h"
+
+/**
+ * @fn std::vector<mode::pixel_type> makeToaBatch(size_t n, uint64_t seed)
+ * @brief a batch of hits as delivered by pixels_received
+ *
+ * Clusters of 1-8 hits a few tics apart arrive at exponentially distributed
+ * intervals on top of a large acquisition time offset; the readout delivers
+ * hits close to, but not in, time order: each hit ends up at most
+ * maxDisplacement positions from its time ordered position.
+ */
+inline std::vector<mode::pixel_type> makeToaBatch(
+    size_t n,
+    uint64_t seed = 1,
+    size_t maxDisplacement = 48
+)
+{
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> gap(1.0 / 200.0);
+    std::uniform_int_distribution<int> clusterSize(1, 8);
+    std::uniform_int_distribution<int> jitter(0, 4);
+    std::uniform_int_distribution<int> coord(0, CHIP_WIDTH - 1);
+    std::uniform_int_distribution<int> tot(5, 400);
+
+    std::vector<mode::pixel_type> hits(n);
+    uint64_t toa = 1ull << 36;
+    for (size_t i = 0; i < n; ) {
+        toa += static_cast<uint64_t>(gap(rng)) + 6;
+        const int x = coord(rng);
+        const int y = coord(rng);
+        for (int c = clusterSize(rng); c > 0 && i < n; --c, ++i) {
+            hits[i] = {};
+            hits[i].coord.x = static_cast<uint8_t>(std::min(x + c % 3, CHIP_WIDTH - 1));
+            hits[i].coord.y = static_cast<uint8_t>(std::min(y + c / 3, CHIP_HEIGHT - 1));
+            hits[i].toa = toa + jitter(rng);
+            hits[i].tot = static_cast<uint16_t>(tot(rng));
+        }
+    }
+
+    // readout order: time order perturbed by a bounded random delay
+    std::uniform_int_distribution<size_t> delay(0, maxDisplacement);
+    std::vector<std::pair<size_t, size_t>> order(n);
+    for (size_t i = 0; i < n; ++i) { order[i] = {i + delay(rng), i}; }
+    std::sort(order.begin(), order.end());
+
+    std::vector<mode::pixel_type> readout(n);
+    for (size_t i = 0; i < n; ++i) { readout[i] = hits[order[i].second]; }
+    return readout;
+}
+
+/**
+ * @fn std::vector<mode::pixel_type> makeShowerBatch(size_t n, double particleRate, uint64_t seed)
+ * @brief a batch of particle shower hits (see ShowerGenerator.hpp) in readout order
+ */
+inline std::vector<mode::pixel_type> makeShowerBatch(
+    size_t n,
+    double particleRate = 1e5,
+    uint64_t seed = 1
+)
+{
+    ShowerSettings settings;
+    settings.particleRate = particleRate;
+    settings.startToa = 1ull << 36;
+    settings.seed = seed;
+    ShowerGenerator gen(settings);
+
+    std::vector<mode::pixel_type> hits(n);
+    gen.generate(hits.data(), n);
+    return hits;
+}
+
+/**
+ * @fn std::vector<uint8_t> makeMdStream(const std::vector<mode::pixel_type>& hits)
+ * @brief measurement data of hits as the readout sends it: pixel MDs, preceded by
+ * a time offset MD whenever the upper toa bits change
+ */
+inline std::vector<uint8_t> makeMdStream(const std::vector<mode::pixel_type>& hits)
+{
+    std::vector<uint8_t> mds;
+    mds.reserve(2 * hits.size() * KATHERINE_MD_SIZE);
+    auto append = [&](uint64_t md){
+        for (size_t b = 0; b < KATHERINE_MD_SIZE; ++b) { mds.push_back(static_cast<uint8_t>(md >> (8 * b))); }
+    };
+
+    uint64_t offset = UINT64_MAX;
+    for (const auto& px : hits) {
+        if (px.toa >> 14 != offset) {
+            offset = px.toa >> 14;
+            append(uint64_t(0x5) << 44 | (offset & 0xFFFFFFFF));
+        }
+        append(encodePixelMd(px));
+    }
+    return mds;
+}
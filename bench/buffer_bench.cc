@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "CustomDataTypes.hpp"
+#include "bench_data.hpp"
+
+// SafeBuff hand over: chunks of arg hits are added under the lock, as a
+// pixels_received callback does, then copied out and cleared by the consumer
+static void BM_SafeBuffAddCopy(benchmark::State& state)
+{
+    const size_t chunk = state.range(0);
+    const auto hits = makeToaBatch(MAX_BUFF_EL);
+    auto buf = std::make_unique<SafeBuff<mode::pixel_type>>();
+    std::vector<mode::pixel_type> work(MAX_BUFF_EL);
+
+    size_t discarded = 0;
+    for (auto _ : state) {
+        for (size_t pos = 0; pos < hits.size(); pos += chunk) {
+            std::lock_guard lk(buf->mtx_);
+            buf->addElements(std::min(chunk, hits.size() - pos), hits.data() + pos, discarded);
+        }
+        std::lock_guard lk(buf->mtx_);
+        benchmark::DoNotOptimize(buf->copyClear(work.data(), work.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+}
+BENCHMARK(BM_SafeBuffAddCopy)->Arg(64)->Arg(1024)->Arg(MAX_BUFF_EL);
+
+// raw hit ring hand over: chunks of arg hits are pushed, then every cursor peeks
+// and releases them, as processing and storage do
+static void BM_BroadcastRingPushPeek(benchmark::State& state)
+{
+    const size_t chunk = state.range(0);
+    const auto hits = makeToaBatch(MAX_BUFF_EL);
+    auto ring = std::make_unique<BroadcastRing<mode::pixel_type>>(RAW_CURSOR_COUNT);
+
+    size_t discarded = 0;
+    for (auto _ : state) {
+        for (size_t pos = 0; pos < hits.size(); pos += chunk) {
+            ring->push(hits.data() + pos, std::min(chunk, hits.size() - pos), discarded);
+        }
+        for (size_t c = 0; c < RAW_CURSOR_COUNT; ++c) {
+            const mode::pixel_type* data;
+            while (size_t n = ring->peek(c, data, MAX_BUFF_EL)) {
+                benchmark::DoNotOptimize(data);
+                ring->release(c, n);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+}
+BENCHMARK(BM_BroadcastRingPushPeek)->Arg(64)->Arg(1024)->Arg(MAX_BUFF_EL);
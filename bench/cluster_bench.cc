@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ClusterEngine.hpp"
+#include "DataProcessor.hpp"
+#include "bench_data.hpp"
+
+// full batch processing (sort, cluster, grade) with 1..N clustering threads
+static void BM_ProcessBatch(benchmark::State& state)
+{
+    const auto hits = makeToaBatch(MAX_BUFF_EL);
+    auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>();
+    auto speciesQ = std::make_shared<SafeQueue<SpeciesHit>>();
+    auto logger = std::make_shared<Logger>("bench_log.txt", false);
+    DataProcessor dataProc(ring, speciesQ, logger, state.range(0));
+
+    size_t species = 0;
+    for (auto _ : state) {
+        dataProc.doProcessing(hits.data(), hits.size(), false);
+
+        state.PauseTiming();
+        species += speciesQ->q_.size();
+        speciesQ->q_ = {};
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+    state.counters["species/batch"] = benchmark::Counter(
+        double(species) / state.iterations());
+}
+BENCHMARK(BM_ProcessBatch)
+    ->DenseRange(1, std::max(4u, std::thread::hardware_concurrency()))
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// full batch processing of particle showers; arg = particles per second
+static void BM_ProcessShowers(benchmark::State& state)
+{
+    const auto hits = makeShowerBatch(MAX_BUFF_EL, state.range(0));
+    auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>();
+    auto speciesQ = std::make_shared<SafeQueue<SpeciesHit>>();
+    auto logger = std::make_shared<Logger>("bench_log.txt", false);
+    DataProcessor dataProc(ring, speciesQ, logger, 1);
+
+    size_t species = 0;
+    for (auto _ : state) {
+        dataProc.doProcessing(hits.data(), hits.size(), false);
+
+        state.PauseTiming();
+        species += speciesQ->q_.size();
+        speciesQ->q_ = {};
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+    state.counters["species/batch"] = benchmark::Counter(
+        double(species) / state.iterations());
+}
+BENCHMARK(BM_ProcessShowers)->Arg(1e4)->Arg(1e5)->Arg(1e6)->Unit(benchmark::kMicrosecond);
+
+// clustering alone, of a time ordered batch of particle showers
+static void BM_ClusterEngine(benchmark::State& state)
+{
+    auto hits = makeShowerBatch(MAX_BUFF_EL, state.range(0));
+    std::stable_sort(hits.begin(), hits.end(),
+        [](const mode::pixel_type& a, const mode::pixel_type& b){ return a.toa < b.toa; });
+    std::vector<const mode::pixel_type*> sorted(hits.size());
+    for (size_t i = 0; i < hits.size(); ++i) { sorted[i] = &hits[i]; }
+
+    ClusterEngine engine;
+    size_t clusters = 0;
+    for (auto _ : state) {
+        engine.process(sorted.data(), sorted.size(), true,
+            [&](const mode::pixel_type* const*, size_t){ ++clusters; });
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+    state.counters["clusters/batch"] = benchmark::Counter(
+        double(clusters) / state.iterations());
+}
+BENCHMARK(BM_ClusterEngine)->Arg(1e4)->Arg(1e6)->Unit(benchmark::kMicrosecond);
+
+// grading of the clusters of a batch of particle showers
+static void BM_ClusterGrade(benchmark::State& state)
+{
+    auto hits = makeShowerBatch(MAX_BUFF_EL);
+    std::stable_sort(hits.begin(), hits.end(),
+        [](const mode::pixel_type& a, const mode::pixel_type& b){ return a.toa < b.toa; });
+    std::vector<const mode::pixel_type*> sorted(hits.size());
+    for (size_t i = 0; i < hits.size(); ++i) { sorted[i] = &hits[i]; }
+
+    // members of every cluster, and the index of its highest tot member
+    std::vector<const mode::pixel_type*> members;
+    std::vector<std::pair<size_t, size_t>> clusters;
+    std::vector<size_t> centers;
+    ClusterEngine engine;
+    engine.process(sorted.data(), sorted.size(), true,
+        [&](const mode::pixel_type* const* cluster, size_t count){
+            const size_t start = members.size();
+            members.insert(members.end(), cluster, cluster + count);
+            clusters.emplace_back(start, start + count - 1);
+            centers.push_back(start + (std::max_element(cluster, cluster + count,
+                [](const mode::pixel_type* a, const mode::pixel_type* b){ return a->tot < b->tot; }) - cluster));
+        });
+
+    for (auto _ : state) {
+        unsigned grades = 0;
+        for (size_t c = 0; c < clusters.size(); ++c) {
+            grades += getClusterGrade(clusters[c].first, clusters[c].second, centers[c], members.data());
+        }
+        benchmark::DoNotOptimize(grades);
+    }
+    state.SetItemsProcessed(state.iterations() * clusters.size());
+    state.SetBytesProcessed(state.iterations() * members.size() * sizeof(mode::pixel_type));
+    state.SetLabel("items = clusters");
+}
+BENCHMARK(BM_ClusterGrade);
@@ -0,0 +1,36 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <vector>
+#include <katherinexx/acquisition.hpp>
+#include "bench_data.hpp"
+
+// measurement data decoding (pmd_toa_tot_map and handlers) into pixels_received,
+// as the acquisition thread runs it; arg = MDs per datagram
+static void BM_DecodeMd(benchmark::State& state)
+{
+    const auto hits = makeShowerBatch(MAX_BUFF_EL);
+    const auto mds = makeMdStream(hits);
+    const size_t datagram = state.range(0) * KATHERINE_MD_SIZE;
+
+    katherine::acquisition<mode> acq{sizeof(mode::pixel_type) * MAX_BUFF_EL};
+    size_t received = 0;
+    acq.set_pixels_received_handler([&](const mode::pixel_type* px, size_t count){
+        benchmark::DoNotOptimize(px);
+        received += count;
+    });
+    acq.replay_begin();
+
+    for (auto _ : state) {
+        for (size_t pos = 0; pos < mds.size(); pos += datagram) {
+            acq.decode(reinterpret_cast<const char*>(mds.data()) + pos, std::min(datagram, mds.size() - pos));
+        }
+    }
+    acq.replay_end();
+
+    if (received != state.iterations() * hits.size()) {
+        state.SkipWithError("decoded hit count mismatch");
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * mds.size());
+}
+BENCHMARK(BM_DecodeMd)->Arg(64)->Arg(1000)->Arg(8192);
@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include "DataProcessor.hpp"
+#include "EnergyKernel.hpp"
+#include "bench_data.hpp"
+
+// energy of every hit of a batch; arg = tot values tabulated per pixel (0 = formula only)
+static void BM_EnergyLut(benchmark::State& state)
+{
+    const auto hits = makeToaBatch(MAX_BUFF_EL);
+    auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>();
+    auto speciesQ = std::make_shared<SafeQueue<SpeciesHit>>();
+    auto logger = std::make_shared<Logger>("bench_log.txt", false);
+    DataProcessor dataProc(ring, speciesQ, logger);
+    if (!dataProc.loadEnergyCalib(SOURCE_CALIB_DIR)) {
+        state.SkipWithError("could not load calibration from " SOURCE_CALIB_DIR);
+        return;
+    }
+    const auto totMax = static_cast<uint16_t>(state.range(0));
+    const size_t bytes = dataProc.buildEnergyLut(totMax);
+
+    for (auto _ : state) {
+        double sum = 0;
+        for (const auto& px : hits) { sum += dataProc.getEnergy(px); }
+        benchmark::DoNotOptimize(sum);
+    }
+
+    size_t tabulated = 0;
+    for (const auto& px : hits) { tabulated += px.tot < totMax; }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+    state.counters["lut_MB"] = bytes / (1024. * 1024.);
+    state.counters["lut_hits"] = double(tabulated) / hits.size();
+}
+BENCHMARK(BM_EnergyLut)->Arg(0)->Arg(64)->Arg(256)->Arg(1024);
+
+// batch kernel over a whole batch; arg = EnergyKernelIsa
+static void BM_EnergyKernel(benchmark::State& state)
+{
+    const auto isa = static_cast<EnergyKernelIsa>(state.range(0));
+    if (static_cast<int>(isa) > static_cast<int>(bestEnergyKernel())) {
+        state.SkipWithError("not supported by this cpu");
+        return;
+    }
+    const auto hits = makeToaBatch(MAX_BUFF_EL);
+    EnergyCalib calib;
+    for (size_t i = 0; i < CHIP_AREA; ++i) {
+        // a=0.7 b=3 c=60 t=2 for every pixel
+        calib.bat.push_back(3 + 0.7 * 2);
+        calib.ita.push_back(1 / (2 * 0.7));
+        calib.atb.push_back(0.7 * 2 - 3);
+        calib.fac.push_back(4 * 0.7 * 60);
+    }
+    std::vector<double> energies(hits.size());
+
+    for (auto _ : state) {
+        calibrateEnergies(hits.data(), hits.size(), calib, energies.data(), isa);
+        benchmark::DoNotOptimize(energies.data());
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * hits.size() * sizeof(mode::pixel_type));
+    state.SetLabel(energyKernelName(isa));
+}
+BENCHMARK(BM_EnergyKernel)->DenseRange(0, 2);
+
+// startup cost of the energy calibration; arg 0 = parse text files, 1 = binary cache
+static void BM_LoadEnergyCalib(benchmark::State& state)
+{
+    auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>();
+    auto speciesQ = std::make_shared<SafeQueue<SpeciesHit>>();
+    auto logger = std::make_shared<Logger>("bench_log.txt", false);
+    DataProcessor dataProc(ring, speciesQ, logger);
+    const std::string cachePath = state.range(0) ? "bench_calib_cache.bin" : "";
+
+    for (auto _ : state) {
+        if (!dataProc.loadEnergyCalib(SOURCE_CALIB_DIR, cachePath)) {
+            state.SkipWithError("could not load calibration from " SOURCE_CALIB_DIR);
+            return;
+        }
+    }
+    state.SetLabel(state.range(0) ? "cache" : "text");
+}
+BENCHMARK(BM_LoadEnergyCalib)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
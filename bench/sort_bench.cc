@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <vector>
+#include "AdaptiveSort.hpp"
+#include "RadixSort.hpp"
+#include "bench_data.hpp"
+
+// previous path: comparison sort of pointers with a lambda comparator
+static void BM_StdSortPtrs(benchmark::State& state)
+{
+    const auto hits = makeToaBatch(state.range(0));
+    std::vector<const mode::pixel_type*> sorted(hits.size());
+    for (auto _ : state) {
+        for (size_t i = 0; i < hits.size(); ++i) { sorted[i] = hits.data() + i; }
+        std::sort(sorted.begin(), sorted.end(),
+            [](const mode::pixel_type* a, const mode::pixel_type* b){ return a->toa < b->toa; });
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+}
+BENCHMARK(BM_StdSortPtrs)->RangeMultiplier(8)->Range(16, MAX_BUFF_EL);
+
+// original path: in place comparison sort of the 24 byte structs
+static void BM_StdSortStructs(benchmark::State& state)
+{
+    const auto hits = makeToaBatch(state.range(0));
+    std::vector<mode::pixel_type> work(hits.size());
+    for (auto _ : state) {
+        std::copy(hits.begin(), hits.end(), work.begin());
+        std::sort(work.begin(), work.end(),
+            [](const mode::pixel_type& a, const mode::pixel_type& b){ return a.toa < b.toa; });
+        benchmark::DoNotOptimize(work.data());
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+}
+BENCHMARK(BM_StdSortStructs)->RangeMultiplier(8)->Range(16, MAX_BUFF_EL);
+
+static void BM_RadixSortPtrs(benchmark::State& state)
+{
+    const auto hits = makeToaBatch(state.range(0));
+    std::vector<const mode::pixel_type*> sorted;
+    RadixScratch<mode::pixel_type> scratch;
+    for (auto _ : state) {
+        radixSortPtrs(hits.data(), hits.size(),
+            [](const mode::pixel_type& px){ return px.toa; }, sorted, scratch);
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+}
+BENCHMARK(BM_RadixSortPtrs)->RangeMultiplier(8)->Range(16, MAX_BUFF_EL);
+
+// second argument: largest displacement of a hit from its time ordered position
+static void BM_AdaptiveSortPtrs(benchmark::State& state)
+{
+    const auto hits = makeToaBatch(state.range(0), 1, state.range(1));
+    std::vector<const mode::pixel_type*> sorted;
+    RadixScratch<mode::pixel_type> scratch;
+    SortStats stats;
+    for (auto _ : state) {
+        stats = adaptiveSortPtrs(hits.data(), hits.size(),
+            [](const mode::pixel_type& px){ return px.toa; }, sorted, scratch);
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.counters["maxDisplacement"] = stats.maxDisplacement;
+    state.counters["fellBack"] = stats.fellBack;
+}
+BENCHMARK(BM_AdaptiveSortPtrs)->ArgsProduct({{16, 512, 4096, MAX_BUFF_EL}, {0, 4, 48, 512}});
@@ -0,0 +1,90 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "RawHitFormats.hpp"
+#include "StorageManager.hpp"
+#include "bench_data.hpp"
+
+//! @brief input bytes after which the bench output files are started over
+constexpr size_t BENCH_FILE_BYTES = 256 << 20;
+
+// raw hit writer of each format, batches of MAX_BUFF_EL hits as the raw
+// thread hands them over; arg = RawFormat
+static void BM_RawWriter(benchmark::State& state)
+{
+    const auto format = static_cast<RawFormat>(state.range(0));
+    const auto hits = makeShowerBatch(MAX_BUFF_EL);
+    const size_t batchBytes = hits.size() * sizeof(mode::pixel_type);
+    auto writer = makeRawHitWriter(format);
+    const std::string path = std::string("bench_raw") + writer->extension();
+
+    size_t sinceOpen = BENCH_FILE_BYTES;
+    uintmax_t fileBytes = 0;
+    size_t fileHits = 0;
+    for (auto _ : state) {
+        if (sinceOpen >= BENCH_FILE_BYTES) {
+            state.PauseTiming();
+            writer->close();
+            if (!writer->open(path, "# benchmark\n")) {
+                state.SkipWithError("could not create bench_raw file");
+                break;
+            }
+            sinceOpen = 0;
+            state.ResumeTiming();
+        }
+        writer->write(hits.data(), hits.size());
+        sinceOpen += batchBytes;
+    }
+    writer->close();
+
+    fileBytes = std::filesystem::file_size(path);
+    fileHits = sinceOpen / sizeof(mode::pixel_type);
+    std::remove(path.c_str());
+    std::remove((path + RAW_IDX_EXT).c_str());
+
+    state.SetItemsProcessed(state.iterations() * hits.size());
+    state.SetBytesProcessed(state.iterations() * batchBytes);
+    state.counters["file_B/hit"] = fileHits ? double(fileBytes) / fileHits : 0;
+    state.SetLabel(format == RawFormat::TEXT ? "text" : format == RawFormat::BINARY ? "binary" : "columnar");
+}
+BENCHMARK(BM_RawWriter)->DenseRange(0, 2)->Unit(benchmark::kMicrosecond);
+
+// species file lines as the species thread writes them
+static void BM_SpeciesWriter(benchmark::State& state)
+{
+    std::mt19937_64 rng(1);
+    std::uniform_int_distribution<int> grade(0, 7);
+    std::uniform_real_distribution<double> energy(1, 5000);
+    std::vector<SpeciesHit> species;
+    uint64_t toa = 1ull << 36;
+    for (size_t i = 0; i < 16384; ++i) {
+        toa += rng() % 400;
+        species.emplace_back(static_cast<uint8_t>(grade(rng)), toa, energy(rng));
+    }
+    const size_t batchBytes = species.size() * sizeof(SpeciesHit);
+    const std::string path = "bench_species.txt";
+
+    std::ofstream outFile;
+    size_t sinceOpen = BENCH_FILE_BYTES;
+    for (auto _ : state) {
+        if (sinceOpen >= BENCH_FILE_BYTES) {
+            state.PauseTiming();
+            outFile.close();
+            outFile.open(path, std::ios::trunc);
+            sinceOpen = 0;
+            state.ResumeTiming();
+        }
+        for (const auto& hit : species) { writeSpeciesHit(outFile, hit); }
+        sinceOpen += batchBytes;
+    }
+    outFile.close();
+    std::remove(path.c_str());
+
+    state.SetItemsProcessed(state.iterations() * species.size());
+    state.SetBytesProcessed(state.iterations() * batchBytes);
+}
+BENCHMARK(BM_SpeciesWriter)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,80 @@
+/**
+ * @file hpEmulator.cpp
+ * @brief serves an emulated Katherine readout on loopback, for running sprint
+ * and minEx without a hardpix
+ *
+ * usage: hpEmu [hits per second] [recorded measurement data file | --shower]
+ *
+ * Listens on EMU_ADDRESS until interrupted. Build sprint/minEx with
+ * -DHP_ADDRESS=127.0.0.2 to connect to it. A rate of 0 streams as fast as
+ * possible. Without a recording, single hits on random pixels are streamed,
+ * or particle showers (see ShowerGenerator.hpp) with --shower.
+ */
+
+#include "KatherineEmulator.hpp"
+#include "ShowerGenerator.hpp"
+#include "Logger.hpp"
+#include "globals.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+namespace {
+std::atomic<bool> interrupted = false;
+}
+
+int main(int argc, char* argv[])
+{
+    EmulatorSettings settings;
+    bool shower = false;
+    try{
+        if(argc > 3){ throw std::invalid_argument(""); }
+        if(argc > 1){ settings.hitRate = std::stod(argv[1]); }
+        if(argc > 2){
+            shower = std::string(argv[2]) == "--shower";
+            if(!shower){ settings.recordingPath = argv[2]; }
+        }
+    } catch(const std::exception&){
+        fprintf(stderr, "usage: %s [hits per second] [recorded measurement data file | --shower]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::create_directories(LOGS_DIR);
+    auto logger = std::make_shared<Logger>(LOGS_DIR + "/log_emulator.txt", LOG_ASYNC);
+
+    std::signal(SIGINT, [](int){ interrupted = true; });
+    std::signal(SIGTERM, [](int){ interrupted = true; });
+
+    // shower toa advance at the streamed hit rate (or the default flux)
+    EmulatorHitSource source = nullptr;
+    if(shower){
+        source = showerHitSource(
+            settings.hitRate > 0 ? matchHitRate(ShowerSettings(), settings.hitRate) : ShowerSettings());
+    }
+
+    KatherineEmulator emulator(logger, settings, source);
+    if(!emulator.start()){
+        fprintf(stderr, "cannot listen on %s:%u, see log\n", settings.address.c_str(), settings.controlPort);
+        return EXIT_FAILURE;
+    }
+    printf("Emulating hardpix %s on %s:%u, streaming %s at %.0f hits/s\n",
+        settings.chipId.c_str(), settings.address.c_str(), settings.controlPort,
+        !settings.recordingPath.empty() ? settings.recordingPath.c_str() :
+            shower ? "particle showers" : "synthetic hits",
+        settings.hitRate);
+
+    while(!interrupted){
+        std::this_thread::sleep_for(RING_IDLE_WAIT);
+    }
+
+    emulator.stop();
+    printf("\nServed %llu acquisitions, last sent %llu hits\n",
+        static_cast<unsigned long long>(emulator.acquisitions()),
+        static_cast<unsigned long long>(emulator.sentHits()));
+    return EXIT_SUCCESS;
+}
@@ -17,6 +17,7 @@
 #include <regex>
 #include <filesystem>
 #include <format>
+#include <future>
 
 /**
  * @fn void checkCreateDir(std::string& string)
@@ -47,7 +48,8 @@ void createReqPaths(){
         LOGS_DIR,
         DATA_DIR,
         RAW_DATA_DIR,
-        SPECIES_DATA_DIR
+        SPECIES_DATA_DIR,
+        CAPTURE_DATA_DIR
     };
 
     for (auto itr = dirs.begin(); itr != dirs.end(); itr++){
@@ -89,7 +91,7 @@ int getRunNum(){
 std::string parseForRunNum()
 {
     int maxNum = 0;
-    std::regex file_regex(R"(rawHits_RN-(\d+)_FN-\d+\.txt)");
+    std::regex file_regex(R"(rawHits_RN-(\d+)_FN-\d+\.(txt|bin))");
 
     for (const auto& entry : std::filesystem::directory_iterator(RAW_DATA_DIR))
     {
@@ -156,6 +158,18 @@ int powerCycle(uint16_t seconds){
     return system(command);
 }
 
+/**
+ * @fn bool taskFailed(const std::shared_future<bool>& task)
+ * @brief checks, without blocking, whether a startup task has finished unsuccessfully
+ * 
+ * @param[in] task startup task
+ * 
+ * @return true if task is done and returned false
+ */
+bool taskFailed(const std::shared_future<bool>& task){
+    return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready && !task.get();
+}
+
 /**
  * @fn int loop(size_t acqTime)
  * @brief superloop that gets re-run incase of failure to receive data from the hardpix
@@ -169,27 +183,38 @@ int loop(size_t acqTime){
 
     // start logging
     std::string logFileName = LOGS_DIR + "/log_run" + runNum + ".txt";
-    auto logger = std::make_shared<Logger>(logFileName);
+    auto logger = std::make_shared<Logger>(logFileName, LOG_ASYNC);
 
     // create data pipes
-    auto rawHitsBuff = std::make_shared<SafeBuff<mode::pixel_type>>();
-    auto rawHitsToWriteBuff = std::make_shared<SafeBuff<mode::pixel_type>>();
+    auto rawHitsRing = std::make_shared<BroadcastRing<mode::pixel_type>>(RAW_CURSOR_COUNT);
     auto speciesHitsQ = std::make_shared<SafeQueue<SpeciesHit>>();
 
     // initialize core classes
-    AcqController acqCtrl(rawHitsBuff, rawHitsToWriteBuff, logger);
-    StorageManager storageMngr(runNum, speciesHitsQ, rawHitsToWriteBuff, logger);
-    DataProcessor dataProc(rawHitsBuff, speciesHitsQ, logger);
-
-    printf("\nLoading energy calibration files...\n");
-    if(!dataProc.loadEnergyCalib(PATH_TO_CALIB)){return true;} // escape loop
+    AcqController acqCtrl(rawHitsRing, logger);
+    StorageManager storageMngr(runNum, speciesHitsQ, rawHitsRing, logger);
+    DataProcessor dataProc(rawHitsRing, speciesHitsQ, logger);
+    if(CAPTURE_RAW_MD){
+        acqCtrl.setCapturePath(
+            CAPTURE_DATA_DIR + "/" + CAPTURE_FILE_NAME + "_RN-" + runNum + ".mdc");
+    }
 
-    printf("\nLoading energy configuration files...\n");
-    if(!acqCtrl.loadConfig(acqTime)){return true;}; // escape loop
+    // calibration and configuration are loaded (and the processing thread
+    // launched) while the main thread connects to the hardpix; storage waits
+    // for the connection so the file header time is that of the acquisition
+    printf("\nLoading energy calibration and configuration files...\n");
+    std::shared_future<bool> calibTask = std::async(std::launch::async, [&]{
+        if(!dataProc.loadEnergyCalib(PATH_TO_CALIB)){ return false; }
+        dataProc.launch();
+        return true;
+    }).share();
+    std::shared_future<bool> configTask = std::async(std::launch::async, [&]{
+        return acqCtrl.loadConfig(acqTime);
+    }).share();
 
     printf("\nConecting to hardpix...\n");
     int16_t seconds = POWER_CYCLE_SECONDS_MIN;
     while(!acqCtrl.connectDevice()){
+        if(taskFailed(calibTask) || taskFailed(configTask)){ return true; } // escape loop
         logger->log(
             LogLevel::LL_INFO,
             std::format("power cycling hardpix for {} seconds", seconds));
@@ -198,12 +223,11 @@ int loop(size_t acqTime){
             seconds = seconds * 2;
         }
     }
-    
-    printf("\nLaunching threads...\n");
+
+    printf("\nWaiting for threads...\n");
+    if(!calibTask.get() || !configTask.get()){ return true; } // escape loop
     storageMngr.genHeader(time(NULL),acqCtrl.getConfig());
     storageMngr.launch();
-    dataProc.launch();
-    std::this_thread::sleep_for(std::chrono::seconds(1)); // give threads time to launch
 
     printf("\nLaunching acquisition...\n");
     bool goodAcq = true;
@@ -0,0 +1,72 @@
+/**
+ * @file mdReplay.cpp
+ * @brief replays a raw measurement data capture through the processing and
+ * storage pipeline, as sprint would have processed the live acquisition
+ *
+ * usage: mdReplay <capture file> [--paced]
+ *
+ * Captures are written by sprint when CAPTURE_RAW_MD is set. Output goes to
+ * the usual data directories under run number "replay-<capture name>". By
+ * default the capture is replayed as fast as possible; --paced hands each
+ * datagram over at its recorded receive time.
+ */
+
+#include "AcqController.hpp"
+#include "DataProcessor.hpp"
+#include "StorageManager.hpp"
+#include "Logger.hpp"
+#include "globals.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string>
+
+bool debugPrints = false;
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2 || argc > 3 || (argc == 3 && std::strcmp(argv[2], "--paced") != 0)){
+        fprintf(stderr, "usage: %s <capture file> [--paced]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::string path = argv[1];
+    const bool paced = argc == 3;
+
+    for(const auto& dir : {LOGS_DIR, RAW_DATA_DIR, SPECIES_DATA_DIR}){
+        std::filesystem::create_directories(dir);
+    }
+
+    const std::string runNum = "replay-" + std::filesystem::path(path).stem().string();
+    const std::string logFileName = LOGS_DIR + "/log_run" + runNum + ".txt";
+    auto logger = std::make_shared<Logger>(logFileName, LOG_ASYNC);
+
+    // wired as in sprint's loop()
+    auto rawHitsRing = std::make_shared<BroadcastRing<mode::pixel_type>>(RAW_CURSOR_COUNT);
+    auto speciesHitsQ = std::make_shared<SafeQueue<SpeciesHit>>();
+
+    AcqController acqCtrl(rawHitsRing, logger);
+    StorageManager storageMngr(runNum, speciesHitsQ, rawHitsRing, logger);
+    DataProcessor dataProc(rawHitsRing, speciesHitsQ, logger);
+
+    if(!dataProc.loadEnergyCalib(PATH_TO_CALIB)){
+        fprintf(stderr, "cannot load energy calibration, see %s\n", logFileName.c_str());
+        return EXIT_FAILURE;
+    }
+    if(!acqCtrl.loadConfig(0)){
+        printf("No chip configuration, file headers carry default values\n");
+    }
+    storageMngr.genHeader(time(NULL), acqCtrl.getConfig());
+    dataProc.launch();
+    storageMngr.launch();
+
+    printf("Replaying %s%s...\n", path.c_str(), paced ? " at recorded pace" : "");
+    if(!acqCtrl.replay(path, paced)){
+        fprintf(stderr, "cannot replay %s, see %s\n", path.c_str(), logFileName.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("Replay finished, see logfile %s for info\n", logFileName.c_str());
+    return EXIT_SUCCESS;
+    // destructors drain the pipeline, producer before storage writers
+}
@@ -8,6 +8,10 @@
 #include <fstream>
 #include <exception>
 
+#ifndef SPRINT_HP_ADDRESS
+#define SPRINT_HP_ADDRESS "192.168.1.157"
+#endif
+
 using mode = katherine::acq::f_toa_tot;
 size_t nHits = 0;
 auto outputFile = std::ofstream("output.txt");
@@ -94,7 +98,7 @@ int main()
         config.set_pixel_config(std::move(px_config));
 
         // Connect Device
-        katherine::device device("192.168.1.157");
+        katherine::device device(SPRINT_HP_ADDRESS);
         if(device.chip_id() != "J2-W00054") {throw std::runtime_error("Unable to get correct chip ID\n");}
 
         // Run Acquisition
@@ -0,0 +1,307 @@
+/**
+ * @file pipelineLoad.cpp
+ * @brief pushes generated particle showers through decoding, processing and
+ * storage at a controlled rate, and reports throughput, discards, queue depths
+ * and hit latencies
+ *
+ * usage: pipelineLoad [hits per second] [--hits <count>] [--find-max] [--keep]
+ *
+ * The pipeline is wired as in sprint's loop(), but AcqController decodes
+ * measurement data of generated showers (see ShowerGenerator.hpp) instead of
+ * receiving it from a hardpix, so no hardware is needed. The data of a run is
+ * generated up front and handed over datagram by datagram at the offered rate
+ * (0 for as fast as possible); a PipelineProbe follows the hits through the
+ * raw hit ring.
+ *
+ * --find-max doubles the rate until a run is not sustainable (hits discarded,
+ * or stored slower than LOAD_TEST_MIN_THROUGHPUT of the offered rate), then
+ * bisects to within 5%. Output files of the runs are removed unless --keep is
+ * given.
+ */
+
+#include "AcqController.hpp"
+#include "DataProcessor.hpp"
+#include "StorageManager.hpp"
+#include "PipelineProbe.hpp"
+#include "ShowerGenerator.hpp"
+#include "KatherineEmulator.hpp"
+#include "Logger.hpp"
+#include "globals.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <thread>
+#include <vector>
+
+bool debugPrints = false;
+
+namespace {
+
+//! @brief longest wait for the pipeline to catch up once all data is handed over
+constexpr std::chrono::seconds DRAIN_TIMEOUT{60};
+
+//! @brief relative accuracy --find-max bisects to
+constexpr double FIND_MAX_PRECISION = 0.05;
+
+/**
+ * @struct MdStream
+ * @brief measurement data of one run, cut into datagrams
+ */
+struct MdStream {
+    std::vector<char> bytes;
+    //! @brief end of each datagram in bytes
+    std::vector<size_t> ends;
+    //! @brief hits in all datagrams up to and including each one
+    std::vector<uint64_t> hits;
+};
+
+//! @brief appends md to buf as KATHERINE_MD_SIZE little endian bytes
+void appendMd(std::vector<char>& buf, uint64_t md){
+    for(size_t i = 0; i < KATHERINE_MD_SIZE; ++i){
+        buf.push_back(static_cast<char>(md >> (8 * i)));
+    }
+}
+
+/**
+ * @fn MdStream makeStream(double hitRate, size_t hitCount)
+ * @brief one frame of showers at hitRate hits per second, as the readout
+ * sends it: EMU_MDS_PER_DATAGRAM pixel MDs per datagram, time offset MDs
+ * whenever the upper toa bits change
+ */
+MdStream makeStream(double hitRate, size_t hitCount){
+    ShowerSettings settings;
+    if(hitRate > 0){ settings = matchHitRate(settings, hitRate); }
+    ShowerGenerator gen(settings);
+
+    MdStream stream;
+    stream.bytes.reserve((hitCount + hitCount / 8) * KATHERINE_MD_SIZE);
+    appendMd(stream.bytes, uint64_t(0x7) << 44);
+    stream.ends.push_back(stream.bytes.size());
+    stream.hits.push_back(0);
+
+    std::vector<mode::pixel_type> hits(EMU_MDS_PER_DATAGRAM);
+    uint64_t offset = UINT64_MAX;
+    for(size_t made = 0; made < hitCount; ){
+        const size_t n = gen.generate(hits.data(), std::min(hits.size(), hitCount - made));
+        for(size_t i = 0; i < n; ++i){
+            if(hits[i].toa >> 14 != offset){
+                offset = hits[i].toa >> 14;
+                appendMd(stream.bytes, uint64_t(0x5) << 44 | (offset & 0xFFFFFFFF));
+            }
+            appendMd(stream.bytes, encodePixelMd(hits[i]));
+        }
+        made += n;
+        stream.ends.push_back(stream.bytes.size());
+        stream.hits.push_back(made);
+    }
+
+    appendMd(stream.bytes, uint64_t(0xC) << 44 | hitCount);
+    stream.ends.push_back(stream.bytes.size());
+    stream.hits.push_back(hitCount);
+    return stream;
+}
+
+/**
+ * @struct LoadResult
+ * @brief outcome of one run
+ */
+struct LoadResult {
+    //! @brief hits per second fed
+    double offered = 0;
+    //! @brief seconds it took to hand all data over
+    double feedSeconds = 0;
+    //! @brief latest a datagram was handed over relative to its schedule
+    double maxLag = 0;
+    PipelineReport report;
+    //! @brief every stage caught up with the source before DRAIN_TIMEOUT
+    bool drained = false;
+
+    //! @return hits per second the pipeline stored
+    double throughput() const { return report.seconds > 0 ? report.fed / report.seconds : 0; }
+
+    //! @return true if nothing was lost and the pipeline kept up with the offered rate
+    bool sustainable() const {
+        return drained && !report.discarded &&
+            (offered <= 0 || throughput() >= LOAD_TEST_MIN_THROUGHPUT * offered);
+    }
+};
+
+/**
+ * @fn void removeRunFiles(const std::string& runNum)
+ * @brief deletes the raw and species files of run runNum
+ */
+void removeRunFiles(const std::string& runNum){
+    const std::string tag = "_RN-" + runNum + "_";
+    std::vector<std::filesystem::path> files;
+    for(const auto& dir : {RAW_DATA_DIR, SPECIES_DATA_DIR}){
+        for(const auto& entry : std::filesystem::directory_iterator(dir)){
+            if(entry.path().filename().string().find(tag) != std::string::npos){
+                files.push_back(entry.path());
+            }
+        }
+    }
+    for(const auto& file : files){ std::filesystem::remove(file); }
+}
+
+/**
+ * @fn bool runLoad(double hitRate, size_t hitCount, bool keep,
+ * std::shared_ptr<Logger> logger, LoadResult& result)
+ * @brief wires a pipeline as sprint's loop() does and pushes hitCount hits
+ * through it at hitRate hits per second
+ *
+ * @return false if the pipeline could not be set up
+ */
+bool runLoad(double hitRate, size_t hitCount, bool keep, std::shared_ptr<Logger> logger, LoadResult& result){
+    using namespace std::chrono;
+
+    const MdStream stream = makeStream(hitRate, hitCount);
+    const std::string runNum = std::format("load-{:.0f}", hitRate);
+    result = LoadResult();
+    result.offered = hitRate;
+
+    {
+        auto rawHitsRing = std::make_shared<BroadcastRing<mode::pixel_type>>(RAW_CURSOR_COUNT);
+        auto speciesHitsQ = std::make_shared<SafeQueue<SpeciesHit>>();
+
+        AcqController acqCtrl(rawHitsRing, logger);
+        StorageManager storageMngr(runNum, speciesHitsQ, rawHitsRing, logger);
+        DataProcessor dataProc(rawHitsRing, speciesHitsQ, logger);
+
+        if(!dataProc.loadEnergyCalib(PATH_TO_CALIB)){ return false; }
+        acqCtrl.loadConfig(0);
+        storageMngr.genHeader(time(NULL), acqCtrl.getConfig());
+        dataProc.launch();
+        storageMngr.launch();
+
+        // declared last: stops before the pipeline drains in the destructors
+        PipelineProbe probe(rawHitsRing, speciesHitsQ, acqCtrl.rawHitsOverflowStats());
+        probe.start();
+
+        size_t next = 0;
+        steady_clock::time_point start;
+        auto source = [&](MdDatagram& dgram){
+            if(next == stream.ends.size()){ return false; }
+            const size_t begin = next ? stream.ends[next - 1] : 0;
+            const uint64_t before = next ? stream.hits[next - 1] : 0;
+
+            if(!next){ start = steady_clock::now(); }
+            if(hitRate > 0){
+                const auto due = start + duration_cast<nanoseconds>(duration<double>(before / hitRate));
+                std::this_thread::sleep_until(due);
+                result.maxLag = std::max(result.maxLag,
+                    duration<double>(steady_clock::now() - due).count());
+            }
+
+            dgram = {0, stream.bytes.data() + begin, stream.ends[next] - begin};
+            probe.fed(stream.hits[next]);
+            ++next;
+            return true;
+        };
+        acqCtrl.replay(source, false, std::format("{} generated hits at {:.0f} hits/s", hitCount, hitRate));
+        result.feedSeconds = duration<double>(steady_clock::now() - start).count();
+
+        const auto deadline = steady_clock::now() + DRAIN_TIMEOUT;
+        while(!(result.drained = probe.drained()) && steady_clock::now() < deadline){
+            std::this_thread::sleep_for(PROBE_INTERVAL);
+        }
+        result.report = probe.stop();
+    }
+
+    if(!keep){ removeRunFiles(runNum); }
+    return true;
+}
+
+/**
+ * @fn void printResult(const LoadResult& result)
+ * @brief prints throughput, discards, queue depths and latency percentiles
+ */
+void printResult(const LoadResult& result){
+    const PipelineReport& r = result.report;
+    printf("\noffered %.0f hits/s: handed over %llu hits in %.3f s (max lag %.1f ms)\n",
+        result.offered, static_cast<unsigned long long>(r.fed), result.feedSeconds, result.maxLag * 1e3);
+    printf("  stored in %.3f s: %.0f hits/s, discarded %llu hits%s\n",
+        r.seconds, result.throughput(), static_cast<unsigned long long>(r.discarded),
+        result.drained ? "" : " (did not catch up, gave up waiting)");
+    printf("  queue depth mean/peak: processing %.0f/%llu hits, storage %.0f/%llu hits, species %.0f/%llu clusters\n",
+        r.processingDepth.mean, static_cast<unsigned long long>(r.processingDepth.peak),
+        r.storageDepth.mean, static_cast<unsigned long long>(r.storageDepth.peak),
+        r.speciesDepth.mean, static_cast<unsigned long long>(r.speciesDepth.peak));
+    printf("  latency p50/p90/p99/max ms:");
+    const char* names[PIPELINE_STAGES] = {"ring", "processed", "stored"};
+    for(size_t s = 0; s < PIPELINE_STAGES; ++s){
+        const auto stage = static_cast<PipelineStage>(s);
+        printf(" %s %.1f/%.1f/%.1f/%.1f%s", names[s],
+            r.percentile(stage, 0.5) * 1e3, r.percentile(stage, 0.9) * 1e3,
+            r.percentile(stage, 0.99) * 1e3, r.percentile(stage, 1) * 1e3,
+            s + 1 < PIPELINE_STAGES ? "," : "\n");
+    }
+    printf("  %s\n", result.sustainable() ? "sustainable" : "NOT sustainable");
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    double hitRate = LOAD_TEST_RATE;
+    size_t hitCount = LOAD_TEST_HITS;
+    bool findMax = false;
+    bool keep = false;
+    try{
+        for(int i = 1; i < argc; ++i){
+            if(!std::strcmp(argv[i], "--find-max")){ findMax = true; }
+            else if(!std::strcmp(argv[i], "--keep")){ keep = true; }
+            else if(!std::strcmp(argv[i], "--hits") && i + 1 < argc){ hitCount = std::stoull(argv[++i]); }
+            else if(i == 1){ hitRate = std::stod(argv[i]); }
+            else{ throw std::invalid_argument(argv[i]); }
+        }
+        if(!hitCount || hitRate < 0 || (findMax && hitRate <= 0)){ throw std::invalid_argument(""); }
+    } catch(const std::exception&){
+        fprintf(stderr, "usage: %s [hits per second] [--hits <count>] [--find-max] [--keep]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for(const auto& dir : {LOGS_DIR, RAW_DATA_DIR, SPECIES_DATA_DIR}){
+        std::filesystem::create_directories(dir);
+    }
+    const std::string logFileName = LOGS_DIR + "/log_pipelineLoad.txt";
+    auto logger = std::make_shared<Logger>(logFileName, LOG_ASYNC);
+
+    LoadResult result;
+    if(!findMax){
+        if(!runLoad(hitRate, hitCount, keep, logger, result)){
+            fprintf(stderr, "cannot set up the pipeline, see %s\n", logFileName.c_str());
+            return EXIT_FAILURE;
+        }
+        printResult(result);
+        return EXIT_SUCCESS;
+    }
+
+    // double until the pipeline falls behind, then bisect between the last
+    // sustainable and the first unsustainable rate
+    double good = 0, bad = 0;
+    while(!bad || !good || bad - good > FIND_MAX_PRECISION * good){
+        if(!runLoad(hitRate, hitCount, keep, logger, result)){
+            fprintf(stderr, "cannot set up the pipeline, see %s\n", logFileName.c_str());
+            return EXIT_FAILURE;
+        }
+        printResult(result);
+        if(result.sustainable()){ good = hitRate; }
+        else{ bad = hitRate; }
+
+        if(!bad){ hitRate *= 2; }
+        else if(!good){
+            hitRate /= 2;
+            if(hitRate < 1){ break; }
+        }
+        else{ hitRate = (good + bad) / 2; }
+    }
+
+    if(good){ printf("\nmax sustainable flux: %.0f hits/s (%.0f hits/s is not)\n", good, bad); }
+    else{ printf("\nno sustainable flux found\n"); }
+    printf("See logfile %s for info\n", logFileName.c_str());
+    return EXIT_SUCCESS;
+}
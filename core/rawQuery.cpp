@@ -0,0 +1,62 @@
+/**
+ * @file rawQuery.cpp
+ * @brief prints the raw hits of a run that fall into a time of arrival interval
+ *
+ * usage: rawQuery <run number> <toa from> <toa to> [raw data dir]
+ *
+ * Hits are printed in the text raw format ("x y toa tot"), file by file. Only
+ * blocks whose time range overlaps the interval are read, using the sidecar
+ * index written next to each raw file (text or binary).
+ */
+
+#include "RawHitFormats.hpp"
+#include "globals.h"
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    if(argc < 4 || argc > 5){
+        fprintf(stderr, "usage: %s <run number> <toa from> <toa to> [raw data dir]\n", argv[0]);
+        return 1;
+    }
+
+    try{
+        const std::string runNum = argv[1];
+        const uint64_t fromToa = std::stoull(argv[2]);
+        const uint64_t toToa = std::stoull(argv[3]);
+        const std::string dir = argc == 5 ? argv[4] : RAW_DATA_DIR;
+
+        const auto files = findRunFiles(dir, runNum);
+        if(files.empty()){
+            fprintf(stderr, "no raw files for run %s in %s\n", runNum.c_str(), dir.c_str());
+            return 1;
+        }
+
+        size_t total = 0;
+        std::vector<mode::pixel_type> hits;
+        for(const auto& file : files){
+            hits.clear();
+            bool truncated = false;
+            total += queryRawHits(file.string(), fromToa, toToa, hits, &truncated);
+            if(truncated){
+                fprintf(stderr, "warning: %s ends inside a block, queried up to it\n",
+                    file.string().c_str());
+            }
+            for(const auto& hit : hits){
+                printf("%u %u %llu %u\n",
+                    (unsigned) hit.coord.x, (unsigned) hit.coord.y,
+                    (unsigned long long) hit.toa, (unsigned) hit.tot);
+            }
+        }
+        fprintf(stderr, "%zu hits in [%llu, %llu] across %zu files\n", total,
+            (unsigned long long) fromToa, (unsigned long long) toToa, files.size());
+    }
+    catch(const std::exception& e){
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -7,9 +7,12 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "Logger.hpp"
 #include "CustomDataTypes.hpp"
+#include "OverflowReporter.hpp"
+#include "MdCapture.hpp"
 
 /**
  * @class AcqController
@@ -25,11 +28,11 @@ class AcqController final{
         //! @brief counter of number of hits received during an acquisition 
         uint64_t nHits = 0;
 
-        //! @brief buffer storing raw hits to be processed
-        std::shared_ptr<SafeBuff<mode::pixel_type>> rawHitsBuff;
+        //! @brief ring storing raw hits, shared by processing and storage
+        std::shared_ptr<BroadcastRing<mode::pixel_type>> rawHitsRing;
 
-        //! @brief buffer storing raw hits to be written to file
-        std::shared_ptr<SafeBuff<mode::pixel_type>> rawHitsToWriteBuff;
+        //! @brief discard/fill statistics of rawHitsRing, reported by runAcq
+        OverflowCounter rawHitsOverflow;
 
         //! @brief logger writes log statments to file
         std::shared_ptr<Logger> logger;
@@ -40,6 +43,12 @@ class AcqController final{
         //! @brief configuration for the hardpix device
         katherine::config config;
 
+        //! @brief file runAcq captures raw measurement data to, empty for none
+        std::string capturePath;
+
+        //! @brief capture of the running acquisition
+        MdCaptureWriter capture;
+
         /**
          * @fn void frame_started(int frame_idx)
          * @brief callback run when frame started message is received
@@ -63,6 +72,12 @@ class AcqController final{
          */
         void pixels_received(const mode::pixel_type *px, size_t count);
 
+        /**
+         * @fn void setHandlers(katherine::acquisition<mode>& acq)
+         * @brief routes frame and pixel callbacks of acq to this controller
+         */
+        void setHandlers(katherine::acquisition<mode>& acq);
+
         /**
          * @fn testConnection()
          * @brief tests the connection to hardpix by fetching chip id and
@@ -74,17 +89,15 @@ class AcqController final{
 
     public:
         /**
-         * @fn AcqController(std::shared_ptr<SafeBuff<mode::pixel_type>> rhq,
-         * std::shared_ptr<SafeBuff<mode::pixel_type>> rh2w)
+         * @fn AcqController(std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
+         * std::shared_ptr<Logger> logger)
          * @brief constructor for acq controller
          * 
-         * @param rhq buffer of raw hits to write into, buffer gets sent for processing
-         * @param rh2w buffer of raw hits to write into, buffer get sent for storing
+         * @param rhr ring of raw hits to write into, read by both processing and storage
          * @param logger logger instance to be used to log info/warnings
          */
         AcqController(
-            std::shared_ptr<SafeBuff<mode::pixel_type>> rhq,
-            std::shared_ptr<SafeBuff<mode::pixel_type>> rh2w,
+            std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
             std::shared_ptr<Logger> logger
         );
         
@@ -121,6 +134,40 @@ class AcqController final{
          */
         bool runAcq();
 
+        /**
+         * @fn void setCapturePath(const std::string& path)
+         * @brief makes following runAcq calls also write the undecoded
+         * measurement data they receive to path (see MdCapture.hpp)
+         * 
+         * @param[in] path capture file, empty to stop capturing
+         */
+        void setCapturePath(const std::string& path){ capturePath = path; }
+
+        /**
+         * @fn bool replay(const std::string& path, bool paced)
+         * @brief feeds a capture written by runAcq through the same decoding
+         * and callbacks as a live acquisition, without a device
+         * 
+         * @param[in] path capture file
+         * @param[in] paced true to replay at the recorded receive times,
+         * false to replay as fast as possible
+         * 
+         * @return false if the capture could not be read
+         */
+        bool replay(const std::string& path, bool paced);
+
+        /**
+         * @fn void replay(const MdSource& source, bool paced, const std::string& name)
+         * @brief feeds generated measurement data through the same decoding and
+         * callbacks as a live acquisition, without a device
+         * 
+         * @param[in] source datagrams to decode
+         * @param[in] paced true to hand datagrams over at their offsetNs,
+         * false to decode them as soon as source returns them
+         * @param[in] name description of source for the log
+         */
+        void replay(const MdSource& source, bool paced, const std::string& name);
+
         /**
          * @fn katherine::config getConfig()
          * @brief gets the config object
@@ -128,4 +175,10 @@ class AcqController final{
          * @return config object
          */
         katherine::config getConfig();
+
+        /**
+         * @fn const OverflowCounter& rawHitsOverflowStats() const
+         * @return discard/fill totals of the raw hit ring for the last acquisition
+         */
+        const OverflowCounter& rawHitsOverflowStats() const { return rawHitsOverflow; }
 };
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+ * @file AdaptiveSort.hpp
+ * @brief sorting of nearly sorted batches with disorder measurement
+ */
+
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "RadixSort.hpp"
+#include "globals.h"
+
+/**
+ * @struct SortStats
+ * @brief disorder measured while sorting one batch
+ */
+struct SortStats {
+    //! @brief number of elements in the batch
+    size_t n = 0;
+    //! @brief number of ascending runs in arrival order (1 = already sorted)
+    size_t runs = 0;
+    //! @brief largest distance an element had to move back (lower bound if fellBack)
+    size_t maxDisplacement = 0;
+    //! @brief total number of positions elements were moved back
+    size_t moves = 0;
+    //! @brief true if disorder exceeded the limits and the batch was radix sorted
+    bool fellBack = false;
+};
+
+/**
+ * @fn SortStats adaptiveSortPtrs(const T* items, size_t n, KeyFn key,
+ * std::vector<const T*>& out, RadixScratch<T>& scratch, size_t window, size_t moveBudget)
+ * @brief stable sort of pointers to items[0..n) by key(item), cheap for nearly
+ * sorted input
+ *
+ * Runs a bounded insertion sort over (key, pointer) pairs: each element is moved
+ * back past larger keys, at most window positions. Input with only small local
+ * inversions sorts in a single linear pass. As soon as an element would need to
+ * move further than window, or the batch needs more than moveBudget moves per
+ * element in total, the batch is handed to radixSortPtrs instead.
+ *
+ * @param[in] items elements to sort
+ * @param[in] n number of elements
+ * @param[in] key returns the uint64_t sort key of an element
+ * @param[out] out receives n pointers into items, in sorted order
+ * @param scratch working memory
+ * @param[in] window largest displacement handled by insertion
+ * @param[in] moveBudget average moves per element tolerated before falling back
+ *
+ * @return disorder measured in the batch
+ */
+template <typename T, typename KeyFn>
+SortStats adaptiveSortPtrs(
+    const T* items,
+    size_t n,
+    KeyFn key,
+    std::vector<const T*>& out,
+    RadixScratch<T>& scratch,
+    size_t window = SORT_WINDOW,
+    size_t moveBudget = SORT_MOVE_BUDGET
+){
+    SortStats stats;
+    stats.n = n;
+    out.resize(n);
+    if (!n) { return stats; }
+
+    auto& e = scratch.a;
+    e.resize(n);
+    const size_t maxMoves = n * moveBudget;
+    stats.runs = 1;
+
+    e[0] = {key(items[0]), items};
+    for (size_t i = 1; i < n; ++i) {
+        const RadixEntry<T> cur = {key(items[i]), items + i};
+        if (cur.key >= e[i-1].key) {
+            e[i] = cur;
+            continue;
+        }
+
+        ++stats.runs;
+        // keys equal to cur stay in front of it: keeps the sort stable
+        const size_t limit = i > window ? i - window : 0;
+        size_t j = i;
+        while (j > limit && e[j-1].key > cur.key) {
+            e[j] = e[j-1];
+            --j;
+        }
+        stats.moves += i - j;
+        stats.maxDisplacement = std::max(stats.maxDisplacement, i - j);
+
+        if ((j == limit && j > 0 && e[j-1].key > cur.key) || stats.moves > maxMoves) {
+            stats.fellBack = true;
+            radixSortPtrs(items, n, key, out, scratch);
+            return stats;
+        }
+        e[j] = cur;
+    }
+
+    for (size_t i = 0; i < n; ++i) { out[i] = e[i].item; }
+    return stats;
+}
+
+/**
+ * @class SortMetrics
+ * @brief aggregates SortStats over many batches
+ */
+class SortMetrics final {
+    public:
+        //! @brief number of buckets in displacementHist
+        static constexpr size_t HIST_BUCKETS = 17;
+
+        //! @brief number of batches sorted
+        uint64_t batches = 0;
+        //! @brief number of batches that needed the radix sort fallback
+        uint64_t fallbacks = 0;
+        //! @brief number of elements sorted
+        uint64_t elements = 0;
+        //! @brief number of ascending runs over all batches
+        uint64_t runs = 0;
+        //! @brief total insertion moves over all batches
+        uint64_t moves = 0;
+        //! @brief largest displacement seen in any batch
+        size_t maxDisplacement = 0;
+        //! @brief batches by max displacement: bucket 0 = sorted,
+        // bucket b = displacement in [2^(b-1), 2^b), last bucket open ended
+        uint64_t displacementHist[HIST_BUCKETS] = {};
+
+        /**
+         * @fn void add(const SortStats& s)
+         * @brief accounts for one sorted batch
+         */
+        void add(const SortStats& s)
+        {
+            ++batches;
+            fallbacks += s.fellBack;
+            elements += s.n;
+            runs += s.runs;
+            moves += s.moves;
+            maxDisplacement = std::max(maxDisplacement, s.maxDisplacement);
+
+            size_t bucket = 0;
+            for (size_t d = s.maxDisplacement; d && bucket < HIST_BUCKETS - 1; d >>= 1) { ++bucket; }
+            ++displacementHist[bucket];
+        }
+};
@@ -0,0 +1,76 @@
+/**
+ * @file CalibCache.hpp
+ * @brief binary cache of the derived energy calibration constants
+ *
+ * Cache file layout (host byte order, the cache is never moved between machines):
+ *
+ *     header:   magic[8] "SPR3CAL\0" | version u16 | double size u16 |
+ *               byte order tag u32 | pixel count u32 | reserved u32 |
+ *               source hash u64 | payload hash u64
+ *     payload:  bat[count] f64 | ita[count] f64 | atb[count] f64 | fac[count] f64
+ *
+ * The source hash covers the contents of the calibration text files the
+ * constants were derived from, so editing any of them invalidates the cache.
+ * The payload hash detects truncated or corrupted cache files.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "EnergyKernel.hpp"
+
+//! @brief identifies a calibration cache file
+constexpr char CALIB_CACHE_MAGIC[8] = {'S','P','R','3','C','A','L','\0'};
+//! @brief version of the calibration cache layout
+constexpr uint16_t CALIB_CACHE_VERSION = 1;
+//! @brief written as u32 so a cache from a host of other byte order is rejected
+constexpr uint32_t CALIB_CACHE_BYTE_ORDER = 0x01020304;
+//! @brief bytes in the cache header
+constexpr size_t CALIB_CACHE_HEADER_SIZE = 40;
+//! @brief calibration text files, in the order they are hashed
+const std::vector<std::string> CALIB_SOURCE_FILES = {"a.txt", "b.txt", "c.txt", "t.txt"};
+
+/**
+ * @fn uint64_t calibHash(const void* data, size_t len, uint64_t hash)
+ * @brief 64-bit FNV-1a style hash of data, continuing from hash
+ *
+ * Bulk data is hashed as 8-byte words in four interleaved lanes (not
+ * byte-compatible with plain FNV-1a), the tail byte by byte.
+ */
+uint64_t calibHash(const void* data, size_t len, uint64_t hash = 0xcbf29ce484222325ull);
+
+/**
+ * @fn bool hashCalibSources(const std::string& calibFolderPath, uint64_t& hash)
+ * @brief hashes the contents of all CALIB_SOURCE_FILES in calibFolderPath
+ *
+ * @param[in] calibFolderPath folder containing the calibration text files
+ * @param[out] hash hash of the files
+ *
+ * @return false if any file could not be read
+ */
+bool hashCalibSources(const std::string& calibFolderPath, uint64_t& hash);
+
+/**
+ * @fn bool readCalibCache(const std::string& path, uint64_t sourceHash, EnergyCalib& calib)
+ * @brief loads constants from a cache file with a single read
+ *
+ * @param[in] path cache file
+ * @param[in] sourceHash hash the cache must have been built from
+ * @param[out] calib receives the constants (unchanged on failure)
+ *
+ * @return false if the file is missing, stale, from another layout or corrupt
+ */
+bool readCalibCache(const std::string& path, uint64_t sourceHash, EnergyCalib& calib);
+
+/**
+ * @fn bool writeCalibCache(const std::string& path, uint64_t sourceHash, const EnergyCalib& calib)
+ * @brief writes constants to a cache file, replacing it atomically
+ *
+ * @param[in] path cache file
+ * @param[in] sourceHash hash of the text files calib was derived from
+ * @param[in] calib constants to cache (CHIP_AREA per array)
+ *
+ * @return false if the file could not be written
+ */
+bool writeCalibCache(const std::string& path, uint64_t sourceHash, const EnergyCalib& calib);
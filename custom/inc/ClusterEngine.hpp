@@ -0,0 +1,223 @@
+/**
+ * @file ClusterEngine.hpp
+ * @brief streaming spatio-temporal clustering of raw hits
+ */
+
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "CustomDataTypes.hpp"
+#include "globals.h"
+
+/**
+ * @class ClusterEngine
+ * @brief groups time ordered raw hits into clusters of 8-connected pixels
+ *
+ * Two hits belong to the same cluster if their pixels touch (including
+ * diagonally, or are the same pixel) and their toa differ by less than
+ * CLUSTER_TOA_WINDOW; clusters are the connected components of that relation,
+ * built with a union-find over the hits of a batch.
+ *
+ * Neighbours are found through a CHIP_AREA grid holding the last hit seen on
+ * each pixel, so each hit costs 9 O(1) lookups. Grid cells are never cleared:
+ * a cell only counts if it was written during the current batch and its toa is
+ * within the window of the hit looking at it.
+ *
+ * Batches are consecutive pieces of one hit stream. A cluster is complete once
+ * the latest toa seen (the watermark) is CLUSTER_TOA_WINDOW past its last hit;
+ * clusters are emitted in order of their first hit, and the first incomplete
+ * cluster and everything starting after it is carried over to the next batch.
+ */
+class ClusterEngine final {
+    private:
+        /**
+         * @struct GridCell
+         * @brief last hit seen on a pixel
+         */
+        struct GridCell {
+            uint64_t toa = 0;
+            //! @brief batch the cell was written in, cells of older batches are empty
+            uint32_t epoch = 0;
+            //! @brief index of the hit in the batch
+            uint32_t index = 0;
+        };
+
+        //! @brief last hit per pixel, indexed CHIP_WIDTH*y + x
+        std::vector<GridCell> grid;
+        //! @brief number of the current batch, 0 is never used
+        uint32_t epoch = 0;
+
+        //! @brief hits of clusters not emitted by the previous batch (copies, in time order)
+        std::vector<mode::pixel_type> carryHits;
+
+        // working memory, reused between batches
+        std::vector<mode::pixel_type> nextCarryHits;
+        std::vector<const mode::pixel_type*> carryPtrs;
+        std::vector<const mode::pixel_type*> hits;
+        std::vector<const mode::pixel_type*> members;
+        std::vector<uint32_t> parent;
+        std::vector<uint32_t> clusterOf;
+        std::vector<uint32_t> clusterBegin;
+        std::vector<uint32_t> clusterFill;
+        std::vector<uint64_t> clusterLastToa;
+
+        /**
+         * @fn uint32_t find(uint32_t i)
+         * @return root (earliest hit) of the cluster of hit i
+         */
+        uint32_t find(uint32_t i)
+        {
+            while (parent[i] != i) {
+                parent[i] = parent[parent[i]];
+                i = parent[i];
+            }
+            return i;
+        }
+
+        /**
+         * @fn void unite(uint32_t a, uint32_t b)
+         * @brief merges the clusters of hits a and b, keeping the earlier root
+         */
+        void unite(uint32_t a, uint32_t b)
+        {
+            a = find(a);
+            b = find(b);
+            if (a < b) { parent[b] = a; }
+            else if (b < a) { parent[a] = b; }
+        }
+
+        /**
+         * @fn size_t label()
+         * @brief assigns every hit in hits to a cluster, numbered in order of
+         * first hit, and groups the cluster members in members
+         *
+         * @return number of clusters
+         */
+        size_t label()
+        {
+            const size_t n = hits.size();
+            if (++epoch == 0) {
+                // wrapped: cells from 2^32 batches ago would look current
+                std::fill(grid.begin(), grid.end(), GridCell{});
+                epoch = 1;
+            }
+
+            parent.resize(n);
+            for (uint32_t i = 0; i < n; ++i) {
+                parent[i] = i;
+                const mode::pixel_type& px = *hits[i];
+                const int x = px.coord.x;
+                const int y = px.coord.y;
+
+                for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, int(CHIP_HEIGHT) - 1); ++ny) {
+                    for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, int(CHIP_WIDTH) - 1); ++nx) {
+                        const GridCell& cell = grid[CHIP_WIDTH * ny + nx];
+                        if (cell.epoch != epoch) { continue; }
+                        const uint64_t dt = px.toa > cell.toa ? px.toa - cell.toa : cell.toa - px.toa;
+                        if (dt < CLUSTER_TOA_WINDOW) { unite(i, cell.index); }
+                    }
+                }
+
+                GridCell& own = grid[CHIP_WIDTH * y + x];
+                if (own.epoch != epoch || px.toa >= own.toa) {
+                    own = {px.toa, epoch, i};
+                }
+            }
+
+            // roots are the earliest hit of their cluster, so clusters are
+            // numbered in order of first hit by a single forward pass
+            clusterOf.resize(n);
+            clusterBegin.clear();
+            clusterLastToa.clear();
+            for (uint32_t i = 0; i < n; ++i) {
+                const uint32_t root = find(i);
+                if (root == i) {
+                    clusterOf[i] = clusterBegin.size();
+                    clusterBegin.push_back(0);
+                    clusterLastToa.push_back(0);
+                } else {
+                    clusterOf[i] = clusterOf[root];
+                }
+                const uint32_t c = clusterOf[i];
+                ++clusterBegin[c];
+                clusterLastToa[c] = std::max(clusterLastToa[c], hits[i]->toa);
+            }
+
+            // counts to start offsets, then place members in time order
+            const size_t clusters = clusterBegin.size();
+            uint32_t offset = 0;
+            for (auto& b : clusterBegin) {
+                const uint32_t count = b;
+                b = offset;
+                offset += count;
+            }
+            clusterBegin.push_back(offset);
+
+            members.resize(n);
+            clusterFill.assign(clusterBegin.begin(), clusterBegin.end() - 1);
+            for (uint32_t i = 0; i < n; ++i) {
+                members[clusterFill[clusterOf[i]]++] = hits[i];
+            }
+            return clusters;
+        }
+
+    public:
+        ClusterEngine(): grid(CHIP_AREA) {}
+
+        /**
+         * @fn void process(const mode::pixel_type* const* batch, size_t n,
+         * bool flush, EmitFn emit)
+         * @brief clusters the next batch of the stream and emits completed clusters
+         *
+         * @param[in] batch pointers to the hits of the batch, in time order; only
+         * needs to stay valid during the call
+         * @param[in] n number of hits in batch (may be 0)
+         * @param[in] flush true if no more hits follow: all clusters are emitted
+         * @param emit called as emit(const mode::pixel_type* const* members, size_t count)
+         * for each cluster, with its members in time order
+         */
+        template <typename EmitFn>
+        void process(const mode::pixel_type* const* batch, size_t n, bool flush, EmitFn emit)
+        {
+            // clusters carried over from the previous batch continue in this one
+            hits.resize(carryHits.size() + n);
+            carryPtrs.resize(carryHits.size());
+            for (size_t i = 0; i < carryHits.size(); ++i) { carryPtrs[i] = &carryHits[i]; }
+            std::merge(
+                carryPtrs.begin(), carryPtrs.end(),
+                batch, batch + n,
+                hits.begin(),
+                [](const mode::pixel_type* l, const mode::pixel_type* r){ return l->toa < r->toa; }
+            );
+            if (hits.empty()) { return; }
+
+            const size_t clusters = label();
+            const uint64_t watermark = hits.back()->toa;
+
+            size_t complete = 0;
+            while (complete < clusters &&
+                   (flush || clusterLastToa[complete] + CLUSTER_TOA_WINDOW <= watermark)) {
+                ++complete;
+            }
+            // don't let one endless cluster hold back everything
+            if (hits.size() - clusterBegin[complete] > MAX_BUFF_EL) { complete = clusters; }
+
+            for (size_t c = 0; c < complete; ++c) {
+                emit(members.data() + clusterBegin[c], clusterBegin[c+1] - clusterBegin[c]);
+            }
+
+            // copy first: the hits may themselves have been carried over
+            nextCarryHits.clear();
+            for (size_t i = 0; i < hits.size(); ++i) {
+                if (clusterOf[i] >= complete) { nextCarryHits.push_back(*hits[i]); }
+            }
+            carryHits.swap(nextCarryHits);
+        }
+
+        /**
+         * @fn size_t carried() const
+         * @return number of hits held back for the next batch
+         */
+        size_t carried() const { return carryHits.size(); }
+};
@@ -5,6 +5,10 @@
 
 #pragma once
 #include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <queue>
 #include <condition_variable>
 #include <thread>
@@ -168,6 +172,435 @@ template <typename T> class SafeBuff : public ResourceGuard{
         }
 };
 
+/**
+ * @class SpscRing
+ * @brief templated single-producer/single-consumer ring buffer with wait-free
+ * push and pop of whole spans
+ *
+ * The producer only writes head_, the consumer only writes tail_; both live on
+ * their own cache line (as do the cached copies of the opposite index) so the
+ * two threads never contend on a line in the common case.
+ *
+ * The inherited condition variable is only used when the consumer runs dry:
+ * the consumer flags itself idle before waiting, and the producer only takes
+ * the mutex to notify when it sees that flag and the wake threshold is met.
+ *
+ * @note exactly one thread may push and exactly one (other) thread may
+ * peek/release/pop at any time
+ */
+template <typename T> class SpscRing : public ResourceGuard{
+    private:
+        //! @brief number of slots, always a power of two
+        const size_t capacity_;
+        //! @brief capacity_ - 1, maps a monotonic index onto a slot
+        const size_t mask_;
+        //! @brief slot storage
+        T* buf_;
+
+        //! @brief total number of elements ever pushed (written by producer)
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_ = 0;
+        //! @brief producer's last observed value of tail_
+        uint64_t cachedTail_ = 0;
+
+        //! @brief total number of elements ever released (written by consumer)
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail_ = 0;
+        //! @brief consumer's last observed value of head_
+        uint64_t cachedHead_ = 0;
+
+        //! @brief true while the consumer is (about to be) blocked on cv_
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> consumerIdle_ = false;
+        //! @brief fill level at which an idle consumer wants to be woken
+        std::atomic<size_t> wakeThreshold_ = 1;
+
+    public:
+        /**
+         * @fn SpscRing(size_t capacity)
+         * @brief constructor for SpscRing, dynamically allocates memory
+         *
+         * @param capacity minimum number of elements the ring can hold,
+         * rounded up to a power of two
+         */
+        explicit SpscRing(size_t capacity = RAW_RING_EL):
+            capacity_(std::bit_ceil(capacity)), mask_(capacity_ - 1),
+            buf_(new T [capacity_]) {}
+
+        /**
+         * @fn ~SpscRing()
+         * @brief destructor for SpscRing, releases allocated memory
+         */
+        ~SpscRing()
+        {
+            delete [] buf_;
+        }
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        /**
+         * @fn size_t capacity() const
+         * @return max number of elements the ring can hold
+         */
+        size_t capacity() const { return capacity_; }
+
+        /**
+         * @fn size_t size() const
+         * @return number of elements currently in the ring (approximate
+         * when called from a thread other than producer/consumer)
+         */
+        size_t size() const
+        {
+            return head_.load(std::memory_order_acquire)
+                - tail_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @fn uint64_t push(const T* src, size_t count, size_t& discarded)
+         * @brief (producer) copies as many of count elements as fit into the ring
+         *
+         * @param[in] src elements to add
+         * @param[in] count number of elements in src
+         * @param[out] discarded number of elements that did not fit, 0 if none
+         *
+         * @return number of elements in the ring after the push
+         *
+         * @note wait-free, never blocks; wakes the consumer only if it is idle
+         */
+        uint64_t push(const T* src, size_t count, size_t& discarded)
+        {
+            const uint64_t head = head_.load(std::memory_order_relaxed);
+            if (capacity_ - (head - cachedTail_) < count) {
+                cachedTail_ = tail_.load(std::memory_order_acquire);
+            }
+            const size_t space = capacity_ - (head - cachedTail_);
+            const size_t toAdd = std::min(count, space);
+            discarded = count - toAdd;
+
+            const size_t first = head & mask_;
+            const size_t firstPart = std::min(toAdd, capacity_ - first);
+            std::copy_n(src, firstPart, buf_ + first);
+            std::copy_n(src + firstPart, toAdd - firstPart, buf_);
+
+            const uint64_t newHead = head + toAdd;
+            head_.store(newHead, std::memory_order_seq_cst);
+
+            const uint64_t fill = newHead - cachedTail_;
+            if (consumerIdle_.load(std::memory_order_seq_cst)
+                && fill >= wakeThreshold_.load(std::memory_order_relaxed)){
+                std::lock_guard lk(mtx_);
+                cv_.notify_one();
+            }
+            return fill;
+        }
+
+        /**
+         * @fn size_t peek(const T*& data, size_t maxCount)
+         * @brief (consumer) exposes the oldest elements in place, without copying
+         *
+         * @param[out] data pointer to first readable element
+         * @param[in] maxCount max number of elements to expose
+         *
+         * @return number of contiguous elements readable at data; may be
+         * less than size() when the readable region wraps around
+         *
+         * @note elements stay valid until release() is called
+         */
+        size_t peek(const T*& data, size_t maxCount)
+        {
+            const uint64_t tail = tail_.load(std::memory_order_relaxed);
+            if (cachedHead_ == tail) {
+                cachedHead_ = head_.load(std::memory_order_acquire);
+            }
+            const size_t first = tail & mask_;
+            const size_t avail = std::min<size_t>(cachedHead_ - tail, capacity_ - first);
+            data = buf_ + first;
+            return std::min(avail, maxCount);
+        }
+
+        /**
+         * @fn void release(size_t count)
+         * @brief (consumer) hands count elements obtained by peek back to the producer
+         */
+        void release(size_t count)
+        {
+            tail_.store(tail_.load(std::memory_order_relaxed) + count,
+                std::memory_order_release);
+        }
+
+        /**
+         * @fn size_t pop(T* dst, size_t maxCount)
+         * @brief (consumer) copies up to maxCount of the oldest elements into dst
+         * and removes them from the ring
+         *
+         * @return number of elements copied into dst
+         */
+        size_t pop(T* dst, size_t maxCount)
+        {
+            size_t copied = 0;
+            const T* data;
+            size_t n;
+            while (copied < maxCount && (n = peek(data, maxCount - copied)) > 0){
+                std::copy_n(data, n, dst + copied);
+                release(n);
+                copied += n;
+            }
+            return copied;
+        }
+
+        /**
+         * @fn bool waitForData(std::stop_token stopToken, size_t minCount)
+         * @brief (consumer) blocks until at least minCount elements are available,
+         * stop is requested, or RING_IDLE_WAIT elapses
+         *
+         * @return true if any element is available
+         */
+        bool waitForData(std::stop_token stopToken, size_t minCount = 1)
+        {
+            if (size() >= minCount) { return true; }
+
+            wakeThreshold_.store(minCount, std::memory_order_relaxed);
+            consumerIdle_.store(true, std::memory_order_seq_cst);
+            {
+                std::unique_lock lk(mtx_);
+                cv_.wait_for(lk, RING_IDLE_WAIT, [&]{
+                    return stopToken.stop_requested() || size() >= minCount;
+                });
+            }
+            consumerIdle_.store(false, std::memory_order_relaxed);
+            return size() > 0;
+        }
+};
+
+/**
+ * @class BroadcastRing
+ * @brief templated single-producer/multi-consumer ring buffer in which every
+ * consumer sees every element
+ *
+ * Each consumer owns an independent read cursor and reads the shared slots in
+ * place (peek/release), so one copy of the data serves all consumers. The
+ * producer may only overwrite a slot once the slowest cursor has passed it.
+ *
+ * As with SpscRing, the inherited condition variable is only used by consumers
+ * that have run dry and flagged themselves idle.
+ *
+ * @note exactly one thread may push; each cursor must be driven by exactly
+ * one consumer thread
+ */
+template <typename T> class BroadcastRing : public ResourceGuard{
+    private:
+        /**
+         * @struct Cursor
+         * @brief per-consumer read state, padded onto its own cache line
+         */
+        struct alignas(CACHE_LINE_SIZE) Cursor {
+            //! @brief total number of elements released by this consumer
+            std::atomic<uint64_t> tail = 0;
+            //! @brief consumer's last observed value of head_
+            uint64_t cachedHead = 0;
+            //! @brief true while the consumer is (about to be) blocked on cv_
+            std::atomic<bool> idle = false;
+            //! @brief fill level at which the idle consumer wants to be woken
+            std::atomic<size_t> wakeThreshold = 1;
+        };
+
+        //! @brief number of slots, always a power of two
+        const size_t capacity_;
+        //! @brief capacity_ - 1, maps a monotonic index onto a slot
+        const size_t mask_;
+        //! @brief number of consumer cursors
+        const size_t numCursors_;
+        //! @brief slot storage
+        T* buf_;
+        //! @brief one read cursor per consumer
+        Cursor* cursors_;
+
+        //! @brief total number of elements ever pushed (written by producer)
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_ = 0;
+        //! @brief producer's last observed value of the slowest cursor
+        uint64_t cachedMinTail_ = 0;
+
+        /**
+         * @fn uint64_t minTail() const
+         * @brief position of the slowest cursor
+         */
+        uint64_t minTail() const
+        {
+            uint64_t minT = cursors_[0].tail.load(std::memory_order_acquire);
+            for (size_t c = 1; c < numCursors_; ++c){
+                minT = std::min(minT, cursors_[c].tail.load(std::memory_order_acquire));
+            }
+            return minT;
+        }
+
+    public:
+        /**
+         * @fn BroadcastRing(size_t numConsumers, size_t capacity)
+         * @brief constructor for BroadcastRing, dynamically allocates memory
+         *
+         * @param numConsumers number of independent read cursors
+         * @param capacity minimum number of elements the ring can hold,
+         * rounded up to a power of two
+         */
+        explicit BroadcastRing(
+            size_t numConsumers = RAW_CURSOR_COUNT,
+            size_t capacity = RAW_RING_EL
+        ):
+            capacity_(std::bit_ceil(capacity)), mask_(capacity_ - 1),
+            numCursors_(numConsumers), buf_(new T [capacity_]),
+            cursors_(new Cursor [numConsumers]) {}
+
+        /**
+         * @fn ~BroadcastRing()
+         * @brief destructor for BroadcastRing, releases allocated memory
+         */
+        ~BroadcastRing()
+        {
+            delete [] cursors_;
+            delete [] buf_;
+        }
+
+        BroadcastRing(const BroadcastRing&) = delete;
+        BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+        /**
+         * @fn size_t capacity() const
+         * @return max number of elements the ring can hold
+         */
+        size_t capacity() const { return capacity_; }
+
+        /**
+         * @fn size_t size(size_t cursor) const
+         * @return number of elements not yet released by the given cursor
+         */
+        size_t size(size_t cursor) const
+        {
+            return head_.load(std::memory_order_acquire)
+                - cursors_[cursor].tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @fn uint64_t pushed() const
+         * @return total number of elements ever pushed
+         */
+        uint64_t pushed() const { return head_.load(std::memory_order_acquire); }
+
+        /**
+         * @fn uint64_t released(size_t cursor) const
+         * @return total number of elements ever released by the given cursor
+         */
+        uint64_t released(size_t cursor) const
+        {
+            return cursors_[cursor].tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @fn uint64_t push(const T* src, size_t count, size_t& discarded)
+         * @brief (producer) copies as many of count elements as fit into the ring
+         *
+         * @param[in] src elements to add
+         * @param[in] count number of elements in src
+         * @param[out] discarded number of elements that did not fit (because the
+         * slowest consumer is too far behind), 0 if none
+         *
+         * @return number of elements held for the slowest consumer after the push
+         *
+         * @note wait-free, never blocks; wakes only consumers that are idle
+         */
+        uint64_t push(const T* src, size_t count, size_t& discarded)
+        {
+            const uint64_t head = head_.load(std::memory_order_relaxed);
+            if (capacity_ - (head - cachedMinTail_) < count) {
+                cachedMinTail_ = minTail();
+            }
+            const size_t space = capacity_ - (head - cachedMinTail_);
+            const size_t toAdd = std::min(count, space);
+            discarded = count - toAdd;
+
+            const size_t first = head & mask_;
+            const size_t firstPart = std::min(toAdd, capacity_ - first);
+            std::copy_n(src, firstPart, buf_ + first);
+            std::copy_n(src + firstPart, toAdd - firstPart, buf_);
+
+            const uint64_t newHead = head + toAdd;
+            head_.store(newHead, std::memory_order_seq_cst);
+
+            bool notify = false;
+            for (size_t c = 0; c < numCursors_; ++c){
+                Cursor& cur = cursors_[c];
+                if (cur.idle.load(std::memory_order_seq_cst)
+                    && newHead - cur.tail.load(std::memory_order_relaxed)
+                        >= cur.wakeThreshold.load(std::memory_order_relaxed)){
+                    notify = true;
+                }
+            }
+            if (notify){
+                std::lock_guard lk(mtx_);
+                cv_.notify_all();
+            }
+            return newHead - cachedMinTail_;
+        }
+
+        /**
+         * @fn size_t peek(size_t cursor, const T*& data, size_t maxCount)
+         * @brief (consumer) exposes the cursor's oldest unread elements in place
+         *
+         * @param[in] cursor read cursor of the calling consumer
+         * @param[out] data pointer to first readable element
+         * @param[in] maxCount max number of elements to expose
+         *
+         * @return number of contiguous elements readable at data; may be
+         * less than size() when the readable region wraps around
+         *
+         * @note elements stay valid until this cursor calls release()
+         */
+        size_t peek(size_t cursor, const T*& data, size_t maxCount)
+        {
+            Cursor& cur = cursors_[cursor];
+            const uint64_t tail = cur.tail.load(std::memory_order_relaxed);
+            if (cur.cachedHead == tail) {
+                cur.cachedHead = head_.load(std::memory_order_acquire);
+            }
+            const size_t first = tail & mask_;
+            const size_t avail = std::min<size_t>(cur.cachedHead - tail, capacity_ - first);
+            data = buf_ + first;
+            return std::min(avail, maxCount);
+        }
+
+        /**
+         * @fn void release(size_t cursor, size_t count)
+         * @brief (consumer) marks count elements obtained by peek as consumed
+         */
+        void release(size_t cursor, size_t count)
+        {
+            Cursor& cur = cursors_[cursor];
+            cur.tail.store(cur.tail.load(std::memory_order_relaxed) + count,
+                std::memory_order_release);
+        }
+
+        /**
+         * @fn bool waitForData(size_t cursor, std::stop_token stopToken, size_t minCount)
+         * @brief (consumer) blocks until at least minCount elements are unread by
+         * cursor, stop is requested, or RING_IDLE_WAIT elapses
+         *
+         * @return true if any element is available to cursor
+         */
+        bool waitForData(size_t cursor, std::stop_token stopToken, size_t minCount = 1)
+        {
+            if (size(cursor) >= minCount) { return true; }
+
+            Cursor& cur = cursors_[cursor];
+            cur.wakeThreshold.store(minCount, std::memory_order_relaxed);
+            cur.idle.store(true, std::memory_order_seq_cst);
+            {
+                std::unique_lock lk(mtx_);
+                cv_.wait_for(lk, RING_IDLE_WAIT, [&]{
+                    return stopToken.stop_requested() || size(cursor) >= minCount;
+                });
+            }
+            cur.idle.store(false, std::memory_order_relaxed);
+            return size(cursor) > 0;
+        }
+};
+
 /**
  * @fn inline void safe_finish(std::jthread& t, std::shared_ptr<ResourceGuard> guard)
  * @brief gracefully join thread that waits on a mutex and condition
@@ -9,13 +9,19 @@
 #include <vector>
 #include "CustomDataTypes.hpp"
 #include "Logger.hpp"
+#include "AdaptiveSort.hpp"
+#include "CalibCache.hpp"
+#include "EnergyKernel.hpp"
+#include "ClusterEngine.hpp"
+#include "WorkStealingPool.hpp"
 
 /**
  * @class DataProcessor
  * @brief converts raw (individual) hit into species (burst/cluster) hits
  * 
  * The DataProcessor has a thread responsible for converting raw, individual hits into
- * processed hit data by clustering in time and applying species detection algorithms.
+ * processed hit data by clustering in time and space and applying species detection
+ * algorithms.
  * 
  * The DataProcessor receives raw hits from the acquisition, processes them, and sends
  * information on processed data to be stored.
@@ -23,21 +29,8 @@
 class DataProcessor final{
     private:
 
-        /**
-         * @struct CalibConstants
-         * @brief holds calibration contants derived from a,b,c,t .txt files,
-         * used to calculate energy for a given pixel given time over threshold
-         */
-        struct CalibConstants
-        {
-            double bat;
-            double ita;
-            double atb;
-            double fac;
-        };
-
-        //! @brief buffer to read from, containing raw hits (pixels)
-        std::shared_ptr<SafeBuff<mode::pixel_type>> rawHitsBuff;
+        //! @brief ring to read from, containing raw hits (pixels)
+        std::shared_ptr<BroadcastRing<mode::pixel_type>> rawHitsRing;
 
         //! @brief butter to write to, containing species hit (cluster) data
         std::shared_ptr<SafeQueue<SpeciesHit>> speciesHitsQ;
@@ -45,17 +38,66 @@ class DataProcessor final{
         //! @brief logger writes log statments to file
         std::shared_ptr<Logger> logger;
 
-        //! @brief lookup calib constants based on x,y coords
-        std::vector<CalibConstants> lookupMatrix;
+        //! @brief calib constants of every pixel, indexed by x,y coords
+        EnergyCalib calib;
+
+        //! @brief kernel computing the energies of a batch
+        const EnergyKernelIsa energyIsa = bestEnergyKernel();
+
+        //! @brief energies of the hits of the batch being processed, in batch order
+        std::vector<double> batchEnergies;
+
+        //! @brief batch batchEnergies belongs to
+        const mode::pixel_type* batchBase = nullptr;
+
+        //! @brief marks pixels without a row in energyLut
+        static constexpr uint32_t NO_LUT_ROW = UINT32_MAX;
+
+        //! @brief precomputed energies: energyLutTotMax entries per tabulated pixel
+        std::vector<float> energyLut;
+
+        //! @brief row of each pixel (CHIP_WIDTH*y + x) in energyLut, or NO_LUT_ROW
+        std::vector<uint32_t> energyLutRow;
+
+        //! @brief tot values below this are looked up in energyLut
+        uint16_t energyLutTotMax = 0;
 
         //! @brief thread to run the data processor
         std::jthread dpThread;
 
+        //! @brief hits of the batch being processed, in order of time of arrival
+        // (the batch itself is read in place from rawHitsRing and not reordered)
+        std::vector<const mode::pixel_type*> sortedHits;
+
+        //! @brief groups sortedHits into clusters, keeps incomplete clusters between batches
+        ClusterEngine clusterEngine;
+
+        //! @brief threads clustering independent shards of a batch (null if single threaded)
+        std::unique_ptr<WorkStealingPool> clusterPool;
+
+        //! @brief per pool worker engine for shards that don't continue the stream
+        std::vector<ClusterEngine> shardEngines;
+
+        //! @brief shard boundaries (indices into sortedHits) of the batch being clustered
+        std::vector<size_t> shardCuts;
+
+        //! @brief species hits found per shard, queued in shard order once all are done
+        std::vector<std::vector<SpeciesHit>> shardHits;
+
+        //! @brief working memory for sorting sortedHits
+        RadixScratch<mode::pixel_type> sortScratch;
+
+        //! @brief disorder of the incoming batches, logged when the thread terminates
+        SortMetrics sortMetrics;
+
         /**
          * @fn DataProcessor::loadConstants(std::vector<double>& dst,
          * const std::string& path, size_t expectedCount)
          * @brief loads calibration constants from file into a vector
          * 
+         * The file is memory mapped and parsed with std::from_chars; numbers may be
+         * separated by any whitespace. Anything that is not a number is an error.
+         * 
          * @param[out] dst vector to load constants into
          * @param[in] path path of calibration file
          * @param[in] expectedCount experect amount of contants in file at path
@@ -70,21 +112,69 @@ class DataProcessor final{
 
         bool calibLoaded = false;
 
+        /**
+         * @fn bool parseEnergyCalib(const std::string& calibFolderPath)
+         * @brief derives calib from the a,b,c,t .txt files in calibFolderPath
+         * 
+         * @return true if successful, else false
+         */
+        bool parseEnergyCalib(const std::string& calibFolderPath);
+
+        /**
+         * @fn void calibrateBatch(const mode::pixel_type* workBuf, size_t workBufElements)
+         * @brief fills batchEnergies for a batch, with the vector kernel where possible
+         */
+        void calibrateBatch(const mode::pixel_type* workBuf, size_t workBufElements);
+
+        /**
+         * @fn double hitEnergy(const mode::pixel_type* px)
+         * @return energy of px, from batchEnergies if it belongs to the current batch
+         */
+        double hitEnergy(const mode::pixel_type* px);
+
+        /**
+         * @fn SpeciesHit toSpeciesHit(const mode::pixel_type* const* hits, size_t count)
+         * @brief grades a cluster and sums its energy
+         * 
+         * @param[in] hits members of the cluster in time order
+         * @param[in] count number of members
+         */
+        SpeciesHit toSpeciesHit(const mode::pixel_type* const* hits, size_t count);
+
+        /**
+         * @fn bool clusterSharded(bool flush)
+         * @brief clusters sortedHits in parallel on clusterPool
+         * 
+         * The batch is cut into shards at toa gaps of at least CLUSTER_TOA_WINDOW,
+         * which no cluster can span. The first and last shard continue the stream on
+         * clusterEngine, shards in between are clustered independently by the pool.
+         * 
+         * @param[in] flush see doProcessing
+         * 
+         * @return false if the batch has too few gaps to be worth splitting
+         * (nothing was done)
+         */
+        bool clusterSharded(bool flush);
+
     public:
         /**
-         * @fn DataProcessor(std::shared_ptr<SafeBuff<mode::pixel_type>> rhq,
-         * std::shared_ptr<SafeQueue<SpeciesHit>> shq, std::shared_ptr<Logger> log)
+         * @fn DataProcessor(std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
+         * std::shared_ptr<SafeQueue<SpeciesHit>> shq, std::shared_ptr<Logger> log,
+         * size_t clusterThreads)
          * @brief constructor for DataProcessor,
          * launch() must be called to start processing thread
          * 
-         * @param rhq raw hits queue to read from
+         * @param rhr raw hits ring to read from (via RAW_CURSOR_PROCESSING)
          * @param shq species hits queue to write to
          * @param log logger
+         * @param clusterThreads number of threads clustering a batch, including the
+         * processing thread itself
          */
         DataProcessor(
-            std::shared_ptr<SafeBuff<mode::pixel_type>> rhq,
+            std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
             std::shared_ptr<SafeQueue<SpeciesHit>> shq,
-            std::shared_ptr<Logger> log
+            std::shared_ptr<Logger> log,
+            size_t clusterThreads = CLUSTER_THREADS
         );
         
         /**
@@ -97,6 +187,8 @@ class DataProcessor final{
          * @fn launch()
          * @brief launches thread that performs data processing
          * 
+         * returns once the thread is running, so producers may start immediately
+         * 
          * @note thread is joined in the destructor
          */
         void launch();
@@ -104,24 +196,35 @@ class DataProcessor final{
         /**
          * @fn processingLoop(std::stop_token stopToken)
          * @brief defines processing thread loop behavior:
-         * acquires a copy of raw data, then calls doProcessing
+         * waits for raw data, then calls doProcessing on it in place
          * 
          * @param stopToken token used to request thread join
          */
         void processingLoop(std::stop_token stopToken);
 
         /**
-         * @fn doProcessing(mode::pixel_type* workBuf, size_t workBufElements)
+         * @fn doProcessing(const mode::pixel_type* workBuf, size_t workBufElements, bool flush)
          * @brief clusters raw hits and writes to species hit buffer
          * 
-         * @param[in] workBuf buffer containing raw hits to process
-         * @param[in] workBufElements number of raw hits in workBuf
+         * Hits are grouped by ClusterEngine: touching pixels hit within
+         * CLUSTER_TOA_WINDOW of each other form a cluster. Batches are treated as
+         * consecutive pieces of one hit stream: a cluster is only emitted once a later
+         * hit (the watermark) is at least CLUSTER_TOA_WINDOW past its last hit, so
+         * clusters spanning a batch boundary are not split.
+         * 
+         * @param[in] workBuf buffer containing raw hits to process (not modified)
+         * @param[in] workBufElements number of raw hits in workBuf (may be 0)
+         * @param[in] flush true if no more hits follow: open clusters are emitted too
          * 
          * @note
          * - loadEnergyCalib must be called before calling
          * - returns void, but pushes to species hit buffer
          */
-        void doProcessing(mode::pixel_type* workBuf, size_t workBufElements);
+        void doProcessing(
+            const mode::pixel_type* workBuf,
+            size_t workBufElements,
+            bool flush = true
+        );
 
         /**
          * @fn getEnergy(const mode::pixel_type& px)
@@ -133,16 +236,63 @@ class DataProcessor final{
          * if no energy calibration is loaded before hand, returns time over threshold
          * 
          * @note loadEnergyCalib must be called before calling getEnergy!
+         * @note hits covered by buildEnergyLut are looked up (single precision)
          */
         double getEnergy(const mode::pixel_type& px);
 
         /**
-         * @fn loadEnergyCalib(const std::string& calibFolderPath)
+         * @fn buildEnergyLut(uint16_t totMax, const std::vector<uint32_t>& pixels)
+         * @brief precomputes the energy of tot values [0, totMax) for the given pixels,
+         * replacing any previous tables
+         * 
+         * A full chip costs CHIP_AREA * totMax * 4 bytes (16MB for totMax 64),
+         * so large tot ranges should be limited to the pixels that need them.
+         * 
+         * @param[in] totMax number of tot values tabulated per pixel, 0 removes the tables
+         * @param[in] pixels pixel indices (CHIP_WIDTH*y + x) to tabulate, all if empty
+         * 
+         * @return bytes used by the tables, 0 if no energy calibration is loaded
+         * 
+         * @note must not be called while hits are being processed
+         */
+        size_t buildEnergyLut(uint16_t totMax, const std::vector<uint32_t>& pixels = {});
+
+        /**
+         * @fn loadEnergyCalib(const std::string& calibFolderPath, const std::string& cachePath)
          * @brief calculates calibration constants for pixel energy
          * 
+         * The derived constants are cached in a binary file keyed by a hash of the
+         * text files: as long as those are unchanged, later loads read the cache
+         * instead of parsing them. A stale or corrupt cache is rebuilt.
+         * 
          * @param[in] calibFolderPath path to folder containing a,b,c,t .txt files
+         * @param[in] cachePath binary cache file, empty to always parse the text files
          * 
          * @return true if succesful, else false
          */
-        bool loadEnergyCalib(const std::string& calibFolderPath);
-};
\ No newline at end of file
+        bool loadEnergyCalib(
+            const std::string& calibFolderPath,
+            const std::string& cachePath = PATH_TO_CALIB_CACHE
+        );
+
+        /**
+         * @fn const SortMetrics& getSortMetrics() const
+         * @return disorder measured over all batches processed so far
+         */
+        const SortMetrics& getSortMetrics() const { return sortMetrics; }
+};
+
+/**
+ * @fn uint8_t getClusterGrade(size_t startInd, size_t endInd, size_t maxEInd,
+ * const mode::pixel_type* const* buf)
+ * @brief grades the cluster buf[startInd..endInd] around its center buf[maxEInd]
+ * 
+ * @return ASCA grade 0-6 of the 3x3 pattern around the center, 7 (outlier) for
+ * clusters that do not fit in it
+ */
+uint8_t getClusterGrade(
+    size_t startInd,
+    size_t endInd,
+    size_t maxEInd,
+    const mode::pixel_type* const* buf
+);
@@ -0,0 +1,88 @@
+/**
+ * @file EnergyKernel.hpp
+ * @brief batch conversion of raw hit tot to calibrated energy
+ */
+
+#pragma once
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include "globals.h"
+
+/**
+ * @struct EnergyCalib
+ * @brief per pixel calibration constants derived from the a,b,c,t .txt files,
+ * one array per constant (indexed CHIP_WIDTH*y + x) so vector code can gather them
+ */
+struct EnergyCalib {
+    std::vector<double> bat;
+    std::vector<double> ita;
+    std::vector<double> atb;
+    std::vector<double> fac;
+};
+
+/**
+ * @enum EnergyKernelIsa
+ * @brief instruction set used by calibrateEnergies
+ */
+enum class EnergyKernelIsa {
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+/**
+ * @fn inline double calibratedEnergy(const EnergyCalib& calib, size_t pixel, uint16_t tot)
+ * @brief energy of a single hit; reference for the vector kernels, which
+ * produce bit-identical results
+ *
+ * @param[in] calib calibration constants
+ * @param[in] pixel pixel index (CHIP_WIDTH*y + x)
+ * @param[in] tot time over threshold of the hit
+ *
+ * @return energy in keV
+ */
+inline double calibratedEnergy(const EnergyCalib& calib, size_t pixel, uint16_t tot)
+{
+    const double k = calib.bat[pixel] - tot;
+    double energy = calib.ita[pixel] * (tot + calib.atb[pixel] + std::sqrt(k * k + calib.fac[pixel]));
+
+    if (energy > 918) {
+        // Distortion level reached - slightly depends on values used energy response
+        // completely breaks down above 1800 keV.
+        energy = energy - 0.888 * (energy - 918);
+    }
+
+    return energy;
+}
+
+/**
+ * @fn EnergyKernelIsa bestEnergyKernel()
+ * @return widest instruction set supported by both the build and the running cpu
+ */
+EnergyKernelIsa bestEnergyKernel();
+
+/**
+ * @fn const char* energyKernelName(EnergyKernelIsa isa)
+ * @return name of isa for log lines
+ */
+const char* energyKernelName(EnergyKernelIsa isa);
+
+/**
+ * @fn void calibrateEnergies(const mode::pixel_type* hits, size_t n,
+ * const EnergyCalib& calib, double* energies, EnergyKernelIsa isa)
+ * @brief computes energies[i] = calibratedEnergy of hits[i] for a whole batch
+ *
+ * @param[in] hits raw hits
+ * @param[in] n number of hits
+ * @param[in] calib calibration constants
+ * @param[out] energies receives n energies in keV
+ * @param[in] isa kernel to use, must be supported by the cpu
+ */
+void calibrateEnergies(
+    const mode::pixel_type* hits,
+    size_t n,
+    const EnergyCalib& calib,
+    double* energies,
+    EnergyKernelIsa isa = bestEnergyKernel()
+);
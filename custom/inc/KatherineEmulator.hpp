@@ -0,0 +1,192 @@
+/**
+ * @file KatherineEmulator.hpp
+ * @brief loopback stand-in for the Katherine readout, for runs without a hardpix
+ *
+ * Answers the control protocol of lib_katherine on EMU_CONTROL_PORT (an 8 byte
+ * command is answered by an 8 byte acknowledgement/command response datagram)
+ * and, once an acquisition is started, streams measurement data (6 byte MDs)
+ * to the client's data port until the configured acquisition time has passed
+ * or the acquisition is stopped.
+ *
+ * lib_katherine binds its control and data ports on all addresses, so the
+ * emulator must listen on a different loopback address (EMU_ADDRESS) than the
+ * one the client sends from; point HP_ADDRESS there to run sprint against it.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include "Logger.hpp"
+#include "globals.h"
+
+/**
+ * @typedef EmulatorHitSource
+ * @brief fills up to max hits (toa about nondecreasing across calls, each
+ * change of the upper toa bits costs a time offset MD), returns the number
+ * written; 0 ends the frame early
+ */
+using EmulatorHitSource = std::function<size_t(mode::pixel_type* hits, size_t max)>;
+
+/**
+ * @struct EmulatorSettings
+ * @brief what the emulator listens on and streams
+ */
+struct EmulatorSettings {
+    //! @brief address the emulator listens on
+    std::string address = EMU_ADDRESS;
+    //! @brief port the emulator receives commands on
+    uint16_t controlPort = EMU_CONTROL_PORT;
+    //! @brief port of the client measurement data is sent to
+    uint16_t dataPort = EMU_DATA_PORT;
+    //! @brief hits per second streamed, 0 streams as fast as possible
+    double hitRate = EMU_HIT_RATE;
+    //! @brief measurement data items per data datagram
+    size_t mdsPerDatagram = EMU_MDS_PER_DATAGRAM;
+    //! @brief file of raw measurement data (6 byte MDs) streamed as is instead of
+    // synthetic hits, regardless of acquisition time; empty for synthetic hits
+    std::string recordingPath;
+    //! @brief chip id reported to the client
+    std::string chipId = CHIP_ID;
+};
+
+/**
+ * @class KatherineEmulator
+ * @brief emulated Katherine readout serving one client at a time
+ */
+class KatherineEmulator final {
+    private:
+        //! @brief logger writes log statments to file
+        std::shared_ptr<Logger> logger;
+
+        //! @brief listening address, ports, rate and data source
+        const EmulatorSettings settings;
+
+        //! @brief produces synthetic hits when no recording is streamed
+        EmulatorHitSource hitSource;
+
+        //! @brief udp socket commands are received and all datagrams sent on
+        int sock = -1;
+
+        //! @brief where data datagrams go (client address, settings.dataPort)
+        sockaddr_in dataAddr{};
+
+        //! @brief acquisition time requested by the client (10ns units)
+        uint64_t acqTime = 0;
+
+        //! @brief pixel configuration datagrams still expected before acknowledging
+        size_t pendingPixelConfig = 0;
+
+        //! @brief hits sent in the current or last acquisition
+        std::atomic<uint64_t> sentHits_ = 0;
+
+        //! @brief acquisitions started so far
+        std::atomic<uint64_t> acquisitions_ = 0;
+
+        //! @brief serialises datagrams of the control and streaming threads
+        std::mutex sendMtx;
+
+        //! @brief receives and answers commands
+        std::jthread controlThread;
+
+        //! @brief streams measurement data of the current acquisition
+        std::jthread streamThread;
+
+        /**
+         * @fn void controlLoop(std::stop_token stopToken)
+         * @brief receives commands until stopped
+         */
+        void controlLoop(std::stop_token stopToken);
+
+        /**
+         * @fn void handleCommand(const uint8_t* cmd, const sockaddr_in& from)
+         * @brief updates emulator state from and answers one 8 byte command
+         *
+         * @param[in] cmd command
+         * @param[in] from client the command came from
+         */
+        void handleCommand(const uint8_t* cmd, const sockaddr_in& from);
+
+        /**
+         * @fn void streamLoop(std::stop_token stopToken)
+         * @brief streams one data driven frame: new frame MD, pixel MDs at
+         * settings.hitRate, then the frame finished MD
+         */
+        void streamLoop(std::stop_token stopToken);
+
+        /**
+         * @fn size_t streamRecording(std::stop_token stopToken, const std::vector<uint8_t>& mds)
+         * @brief streams recorded measurement data as is, paced by settings.hitRate
+         *
+         * @return number of pixel MDs in the recording that were sent
+         */
+        size_t streamRecording(std::stop_token stopToken, const std::vector<uint8_t>& mds);
+
+        /**
+         * @fn bool send(const void* data, size_t len, const sockaddr_in& to)
+         * @brief sends one datagram
+         */
+        bool send(const void* data, size_t len, const sockaddr_in& to);
+
+    public:
+        /**
+         * @fn KatherineEmulator(std::shared_ptr<Logger> log, const EmulatorSettings& settings,
+         * EmulatorHitSource source)
+         * @param log logger
+         * @param settings listening address, ports, rate and data source
+         * @param source synthetic hit source, default uniformly spread single hits
+         *
+         * start() must be called to begin serving
+         */
+        KatherineEmulator(
+            std::shared_ptr<Logger> log,
+            const EmulatorSettings& settings = EmulatorSettings(),
+            EmulatorHitSource source = nullptr
+        );
+
+        /**
+         * @fn ~KatherineEmulator()
+         * @brief stops serving (see stop())
+         */
+        ~KatherineEmulator();
+
+        /**
+         * @fn bool start()
+         * @brief binds the control socket and launches the control thread
+         *
+         * @return false if the socket could not be set up
+         */
+        bool start();
+
+        /**
+         * @fn void stop()
+         * @brief stops streaming and serving, closes the socket
+         */
+        void stop();
+
+        //! @return hits sent in the current or last acquisition
+        uint64_t sentHits() const { return sentHits_.load(std::memory_order_relaxed); }
+
+        //! @return acquisitions started so far
+        uint64_t acquisitions() const { return acquisitions_.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @fn uint64_t encodePixelMd(const mode::pixel_type& px)
+ * @brief data driven pixel MD (header 0x4) of px; only the low 14 toa bits are
+ * encoded, the rest is carried by time offset MDs
+ */
+uint64_t encodePixelMd(const mode::pixel_type& px);
+
+/**
+ * @fn EmulatorHitSource uniformHitSource(double hitRate, uint64_t seed)
+ * @brief single hits on uniformly random pixels with random tot, toa advancing
+ * by the mean spacing of hitRate hits per second
+ */
+EmulatorHitSource uniformHitSource(double hitRate, uint64_t seed = 1);
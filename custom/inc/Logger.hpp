@@ -4,9 +4,14 @@
  */
 
 #pragma once
+#include <ctime>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+#include "CustomDataTypes.hpp"
 
 /**
  * @enum LogLevel
@@ -32,17 +37,95 @@ const std::unordered_map<LogLevel, const std::string> logLevelMsgMap = {
  * @class Logger
  * @brief writes log messages to log file
  * 
- * @note logger is mutex protected
+ * In synchronous mode every message is written and flushed by the calling thread.
+ * 
+ * In asynchronous mode each logging thread gets its own lock-free queue; the
+ * message is stamped and queued, and a background thread formats queued records,
+ * writes them in batches and flushes every LOG_FLUSH_INTERVAL, or sooner once a
+ * queue holds LOG_FLUSH_RECORDS records. FATAL messages (and everything queued
+ * before them) are still written and flushed before log() returns.
+ * 
+ * @note logger is thread safe
  * 
  */
 class Logger final{
     private:
+        /**
+         * @struct Record
+         * @brief a log message waiting to be written (async mode)
+         */
+        struct Record {
+            time_t time;
+            LogLevel level;
+            std::string msg;
+        };
+
         //! @brief file handle for logfile
         std::ofstream logFile_;
 
-        //! @brief prevent garbeled output if multiple threads are tyring to write
+        //! @brief prevent garbeled output if multiple threads are tyring to write;
+        // in async mode also serializes consumers of the record queues
         std::mutex mtx_;
 
+        //! @brief true if messages are queued for the background thread
+        const bool async_;
+
+        //! @brief identifies this logger in the per-thread queue cache
+        const uint64_t id_;
+
+        //! @brief one record queue per logging thread
+        std::vector<std::pair<std::thread::id, std::unique_ptr<SpscRing<Record>>>> queues_;
+
+        //! @brief protects queues_ (taken when a thread logs for the first time)
+        std::mutex queuesMtx_;
+
+        //! @brief wakes the background thread early
+        ResourceGuard wake_;
+
+        //! @brief set by a producer whose queue reached LOG_FLUSH_RECORDS
+        bool wakeRequested_ = false;
+
+        //! @brief true while the background thread waits on wake_
+        std::atomic<bool> writerIdle_ = false;
+
+        //! @brief records lost because a thread's queue was full
+        std::atomic<size_t> dropped_ = 0;
+
+        //! @brief background thread writing queued records (async mode)
+        std::jthread writerThread_;
+
+        /**
+         * @fn SpscRing<Record>& threadQueue()
+         * @brief gets (creating on first use) the calling thread's record queue
+         */
+        SpscRing<Record>& threadQueue();
+
+        /**
+         * @fn void enqueue(LogLevel level, std::string&& msg)
+         * @brief stamps msg and queues it, or writes it synchronously if FATAL
+         */
+        void enqueue(const LogLevel level, std::string&& msg);
+
+        /**
+         * @fn void writeEntry(time_t time, LogLevel level, const std::string& msg)
+         * @brief formats and writes one entry (caller holds mtx_, no flush)
+         */
+        void writeEntry(time_t time, const LogLevel level, const std::string& msg);
+
+        /**
+         * @fn void drainQueues()
+         * @brief writes all queued records (caller holds mtx_, no flush)
+         * 
+         * @return true if anything was written
+         */
+        bool drainQueues();
+
+        /**
+         * @fn void writerLoop(std::stop_token stopToken)
+         * @brief background thread: drains the queues on the flush policy
+         */
+        void writerLoop(std::stop_token stopToken);
+
         /**
          * @fn getLogLevelMsg(const LogLevel levelEnum)
          * @brief gets a string descriptor of log level type
@@ -53,12 +136,23 @@ class Logger final{
 
     public:
         /**
-         * @fn Logger(const std::string& filename)
+         * @fn Logger(const std::string& filename, bool async)
          * @brief constructor for Logger
          * 
          * @param[in] filename name of log file
+         * @param[in] async queue messages for a background writer thread
+         * instead of writing them in the calling thread
          */
-        Logger(const std::string& filename);
+        Logger(const std::string& filename, bool async = false);
+
+        /**
+         * @fn ~Logger()
+         * @brief destructor for Logger, writes out any queued messages
+         */
+        ~Logger();
+
+        Logger(const Logger&) = delete;
+        Logger& operator=(const Logger&) = delete;
 
         /**
          * @fn void log(LogLevel level, const std::string& msg)
@@ -67,7 +161,7 @@ class Logger final{
          * @param[in] level type of message
          * @param[in] msg message to write
          * 
-         * @note mutex protected
+         * @note in async mode lock-free unless level is LL_FATAL
          */
         void log(const LogLevel level, const std::string& msg);
 
@@ -0,0 +1,217 @@
+/**
+ * @file MdCapture.hpp
+ * @brief capture files of undecoded measurement data datagrams, and their replay
+ *
+ * Capture file layout (all integers little-endian):
+ *
+ *     header:   magic[8] "SPR3MDC\0" | version u16 | md size u16 | reserved u32 |
+ *               capture start u64 (ns since unix epoch)
+ *     record:   receive time varint (ns since the previous record, the first
+ *               since capture start) | length varint | datagram[length]
+ *
+ * Varints are LEB128. A datagram costs 2-6 bytes of framing on top of its
+ * measurement data, so a capture is about the size of the received data.
+ */
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <katherinexx/acquisition.hpp>
+
+//! @brief identifies a measurement data capture file
+constexpr char MD_CAPTURE_MAGIC[8] = {'S','P','R','3','M','D','C','\0'};
+//! @brief version of the capture file layout
+constexpr uint16_t MD_CAPTURE_VERSION = 1;
+//! @brief bytes in the capture file header
+constexpr size_t MD_CAPTURE_HEADER_SIZE = 24;
+//! @brief records buffered by the writer before they are written out
+constexpr size_t MD_CAPTURE_BUFFER_BYTES = 1 << 20;
+
+/**
+ * @class MdCaptureWriter
+ * @brief appends received datagrams to a capture file
+ */
+class MdCaptureWriter final {
+    private:
+        //! @brief capture file
+        std::ofstream file;
+        //! @brief records not yet written to file
+        std::vector<uint8_t> buf;
+        //! @brief receive time of the previous record
+        std::chrono::steady_clock::time_point last;
+        //! @brief datagrams captured
+        uint64_t datagrams_ = 0;
+        //! @brief datagram bytes captured
+        uint64_t bytes_ = 0;
+        //! @brief a write to file failed
+        bool failed = false;
+
+    public:
+        /**
+         * @fn ~MdCaptureWriter()
+         * @brief closes the capture (see close())
+         */
+        ~MdCaptureWriter();
+
+        /**
+         * @fn bool open(const std::string& path)
+         * @brief creates (truncates) path and writes the header; capture
+         * start and the receive time base are now
+         *
+         * @return false if the file could not be created
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @fn void write(const char* data, size_t len, std::chrono::steady_clock::time_point received)
+         * @brief appends one datagram
+         *
+         * @param[in] data datagram
+         * @param[in] len bytes in datagram
+         * @param[in] received receive time of the datagram
+         */
+        void write(
+            const char* data,
+            size_t len,
+            std::chrono::steady_clock::time_point received = std::chrono::steady_clock::now()
+        );
+
+        /**
+         * @fn bool close()
+         * @brief writes buffered records and closes the file
+         *
+         * @return false if any write failed
+         */
+        bool close();
+
+        //! @return true while a capture file is open
+        bool isOpen() const { return file.is_open(); }
+        //! @return datagrams captured
+        uint64_t datagrams() const { return datagrams_; }
+        //! @return datagram bytes captured
+        uint64_t bytes() const { return bytes_; }
+};
+
+/**
+ * @struct MdDatagram
+ * @brief one captured datagram
+ */
+struct MdDatagram {
+    //! @brief receive time, ns since capture start
+    uint64_t offsetNs;
+    //! @brief datagram bytes (valid while the reader is)
+    const char* data;
+    //! @brief bytes in data
+    size_t len;
+};
+
+/**
+ * @class MdCaptureReader
+ * @brief maps a capture file read-only and iterates its datagrams
+ *
+ * Datagrams point into the mapping and stay valid until the reader is
+ * reopened or destroyed.
+ */
+class MdCaptureReader final {
+    private:
+        //! @brief mapped file contents, nullptr when closed
+        const char* contents = nullptr;
+        //! @brief size of the mapping in bytes
+        size_t size = 0;
+        //! @brief read position in contents
+        size_t pos = MD_CAPTURE_HEADER_SIZE;
+        //! @brief receive time of the previous datagram (ns since capture start)
+        uint64_t offsetNs = 0;
+        //! @brief capture start (ns since unix epoch)
+        uint64_t startNs_ = 0;
+        //! @brief the file ends inside a record
+        bool truncated_ = false;
+
+        /**
+         * @fn void unmap()
+         * @brief releases the mapping of the current file, if any
+         */
+        void unmap();
+
+    public:
+        MdCaptureReader() = default;
+        MdCaptureReader(const MdCaptureReader&) = delete;
+        MdCaptureReader& operator=(const MdCaptureReader&) = delete;
+
+        /**
+         * @fn ~MdCaptureReader()
+         * @brief unmaps the capture file
+         */
+        ~MdCaptureReader();
+
+        /**
+         * @fn bool open(const std::string& path)
+         * @brief maps and validates a capture file
+         *
+         * @return false if the file is missing or not a capture of this layout
+         */
+        bool open(const std::string& path);
+
+        /**
+         * @fn bool next(MdDatagram& dgram)
+         * @brief advances to the next datagram
+         *
+         * @param[out] dgram next datagram
+         * @return false at the end of the capture (see truncated())
+         */
+        bool next(MdDatagram& dgram);
+
+        /**
+         * @fn void rewind()
+         * @brief restarts iteration at the first datagram
+         */
+        void rewind();
+
+        //! @return capture start, ns since unix epoch
+        uint64_t startNs() const { return startNs_; }
+        //! @return true if the last record of the file is incomplete
+        bool truncated() const { return truncated_; }
+};
+
+/**
+ * @struct ReplayStats
+ * @brief outcome of replayCapture
+ */
+struct ReplayStats {
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    //! @brief wall time of the replay
+    double seconds = 0;
+};
+
+/**
+ * @brief source of datagrams to replay: writes the next datagram to its
+ * argument, returns false once there is none
+ */
+using MdSource = std::function<bool(MdDatagram&)>;
+
+/**
+ * @fn ReplayStats replayDatagrams(const MdSource& next, katherine::base_acquisition& acq, bool paced)
+ * @brief decodes every datagram of next through acq, running its handlers
+ * exactly as a live acquisition would
+ *
+ * @param[in] next datagram source, e.g. a generator (see replayCapture for files)
+ * @param[in] acq acquisition whose handlers receive the decoded data
+ * (e.g. constructed without a device)
+ * @param[in] paced true to hand datagrams over at their offsetNs (since the
+ * start of the replay), false to replay as fast as possible
+ *
+ * @return replay totals
+ */
+ReplayStats replayDatagrams(const MdSource& next, katherine::base_acquisition& acq, bool paced);
+
+/**
+ * @fn ReplayStats replayCapture(MdCaptureReader& reader, katherine::base_acquisition& acq, bool paced)
+ * @brief replayDatagrams over every datagram of reader, from its first one
+ * (paced replay follows the recorded receive times)
+ */
+ReplayStats replayCapture(MdCaptureReader& reader, katherine::base_acquisition& acq, bool paced);
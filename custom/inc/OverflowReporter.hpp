@@ -0,0 +1,211 @@
+/**
+ * @file OverflowReporter.hpp
+ * @brief rate-limited, aggregated reporting of buffer overflows
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CustomDataTypes.hpp"
+#include "Logger.hpp"
+
+/**
+ * @class OverflowCounter
+ * @brief lock-free discard/fill statistics of one buffer
+ *
+ * Updated by the buffer's producer on every push, read by an OverflowReporter.
+ * The hot path is a relaxed load and compare for the fill level; discards add
+ * a few relaxed atomic operations and one clock read.
+ */
+class OverflowCounter final {
+    private:
+        //! @brief name of the buffer used in log lines
+        const std::string name_;
+        //! @brief capacity of the buffer, for reporting fill levels
+        const size_t capacity_;
+
+        //! @brief elements discarded since reset
+        std::atomic<uint64_t> discarded_ = 0;
+        //! @brief number of pushes that discarded anything
+        std::atomic<uint64_t> events_ = 0;
+        //! @brief highest fill level since reset
+        std::atomic<uint64_t> peakFill_ = 0;
+        //! @brief highest fill level since the reporter last looked
+        std::atomic<uint64_t> intervalPeakFill_ = 0;
+        //! @brief time of the first discard of the current episode (ns, steady clock),
+        // 0 while no episode is ongoing
+        std::atomic<int64_t> episodeStartNs_ = 0;
+        //! @brief time of the most recent discard (ns, steady clock)
+        std::atomic<int64_t> lastDiscardNs_ = 0;
+
+        friend class OverflowReporter;
+
+        /**
+         * @fn static void atomicMax(std::atomic<uint64_t>& a, uint64_t v)
+         * @brief raises a to v if v is larger
+         */
+        static void atomicMax(std::atomic<uint64_t>& a, uint64_t v){
+            uint64_t cur = a.load(std::memory_order_relaxed);
+            while (v > cur && !a.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {}
+        }
+
+    public:
+        /**
+         * @fn OverflowCounter(const std::string& name, size_t capacity)
+         * @param name name of the buffer in log lines
+         * @param capacity capacity of the buffer (elements)
+         */
+        OverflowCounter(const std::string& name, size_t capacity):
+            name_(name), capacity_(capacity) {}
+
+        /**
+         * @fn void record(uint64_t fill, size_t discarded)
+         * @brief (producer) records the outcome of one push
+         *
+         * @param fill fill level of the buffer after the push
+         * @param discarded number of elements the push discarded
+         */
+        void record(uint64_t fill, size_t discarded)
+        {
+            if (fill > intervalPeakFill_.load(std::memory_order_relaxed)) {
+                atomicMax(intervalPeakFill_, fill);
+                atomicMax(peakFill_, fill);
+            }
+            if (!discarded) { return; }
+
+            const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+            int64_t noEpisode = 0;
+            episodeStartNs_.compare_exchange_strong(noEpisode, now, std::memory_order_relaxed);
+            lastDiscardNs_.store(now, std::memory_order_relaxed);
+            events_.fetch_add(1, std::memory_order_relaxed);
+            discarded_.fetch_add(discarded, std::memory_order_relaxed);
+        }
+
+        /**
+         * @fn void reset()
+         * @brief clears all statistics (call while the producer is idle)
+         */
+        void reset()
+        {
+            discarded_ = 0;
+            events_ = 0;
+            peakFill_ = 0;
+            intervalPeakFill_ = 0;
+            episodeStartNs_ = 0;
+            lastDiscardNs_ = 0;
+        }
+
+        //! @return name of the buffer
+        const std::string& name() const { return name_; }
+        //! @return capacity of the buffer
+        size_t capacity() const { return capacity_; }
+        //! @return elements discarded since reset
+        uint64_t discarded() const { return discarded_.load(std::memory_order_relaxed); }
+        //! @return number of pushes that discarded anything since reset
+        uint64_t events() const { return events_.load(std::memory_order_relaxed); }
+        //! @return highest fill level since reset
+        uint64_t peakFill() const { return peakFill_.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @class OverflowReporter
+ * @brief periodically logs one aggregated line per overflowing buffer
+ *
+ * Every interval, for each registered counter that discarded data, a single
+ * WARNING reports the discards of that interval, the interval's peak fill and
+ * the running totals of the overflow episode. Once an interval passes without
+ * discards the episode is closed with one summary line.
+ */
+class OverflowReporter final {
+    private:
+        /**
+         * @struct Tracked
+         * @brief reporter-side episode state of a counter
+         */
+        struct Tracked {
+            OverflowCounter* counter;
+            //! @brief counter's discard total at the previous report
+            uint64_t lastTotal = 0;
+            //! @brief discard total when the current episode started
+            uint64_t episodeBase = 0;
+            //! @brief peak fill seen during the current episode
+            uint64_t episodePeak = 0;
+            //! @brief number of episodes so far
+            uint64_t episodes = 0;
+            bool inEpisode = false;
+        };
+
+        //! @brief logger for the report lines
+        std::shared_ptr<Logger> logger;
+
+        //! @brief time between reports
+        const std::chrono::milliseconds interval;
+
+        //! @brief counters being reported on
+        std::vector<Tracked> tracked;
+
+        //! @brief wakes the reporting thread for shutdown
+        ResourceGuard wake;
+
+        //! @brief thread running report() every interval
+        std::jthread reportThread;
+
+        /**
+         * @fn void closeEpisode(Tracked& t)
+         * @brief logs the summary of t's finished overflow episode
+         */
+        void closeEpisode(Tracked& t);
+
+    public:
+        /**
+         * @fn OverflowReporter(std::shared_ptr<Logger> log, std::chrono::milliseconds interval)
+         * @param log logger to write report lines to
+         * @param interval time between reports
+         */
+        OverflowReporter(
+            std::shared_ptr<Logger> log,
+            std::chrono::milliseconds interval = OVERFLOW_REPORT_INTERVAL
+        );
+
+        /**
+         * @fn ~OverflowReporter()
+         * @brief stops the reporting thread (see stop())
+         */
+        ~OverflowReporter();
+
+        /**
+         * @fn void add(OverflowCounter& counter)
+         * @brief registers a counter; must be called before start()
+         */
+        void add(OverflowCounter& counter);
+
+        /**
+         * @fn void start()
+         * @brief launches the reporting thread
+         */
+        void start();
+
+        /**
+         * @fn void stop()
+         * @brief stops the reporting thread, then reports once more and closes
+         * any ongoing episode
+         */
+        void stop();
+
+        /**
+         * @fn void report()
+         * @brief one reporting pass over all counters (run by the reporting thread)
+         */
+        void report();
+
+        /**
+         * @fn std::string summary() const
+         * @return totals of all counters, e.g. for the end of acquisition log line
+         */
+        std::string summary() const;
+};
@@ -0,0 +1,201 @@
+/**
+ * @file PipelineProbe.hpp
+ * @brief samples queue depths and hit latencies of a running pipeline
+ *
+ * Hits are followed by count, not one by one: every interval the probe marks
+ * how many hits the source has handed over so far, and a stage has handled a
+ * mark once its own count reaches it. A stage's count is the raw hit ring's
+ * push (RING) or release (PROCESSED, STORED) total plus the hits the ring
+ * discarded, as discards happen at the head in stream order. The storage
+ * cursor releases hits only once they are written, so STORED latency is hit to
+ * raw file (written to the file stream, not synced).
+ *
+ * Latencies are accurate to one interval. While the ring discards, hits are
+ * counted as handled slightly early.
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "CustomDataTypes.hpp"
+#include "OverflowReporter.hpp"
+#include "globals.h"
+
+/**
+ * @enum PipelineStage
+ * @brief point of the pipeline a hit's latency is measured to
+ */
+enum class PipelineStage {
+    RING,      //!< pushed into the raw hit ring (decoded and out of lib_katherine's buffer)
+    PROCESSED, //!< released by the DataProcessor (its clusters are queued)
+    STORED,    //!< released by the StorageManager raw writer (written to file)
+};
+
+//! @brief number of PipelineStage values
+constexpr size_t PIPELINE_STAGES = 3;
+
+/**
+ * @struct DepthStats
+ * @brief fill level of a queue over the sampled period
+ */
+struct DepthStats {
+    double mean = 0;
+    uint64_t peak = 0;
+};
+
+/**
+ * @struct PipelineReport
+ * @brief what a PipelineProbe saw
+ */
+struct PipelineReport {
+    //! @brief hits handed over by the source
+    uint64_t fed = 0;
+    //! @brief hits discarded by the raw hit ring
+    uint64_t discarded = 0;
+    //! @brief hits each stage handled, indexed by PipelineStage (discards included)
+    std::array<uint64_t, PIPELINE_STAGES> handled{};
+    //! @brief latencies (seconds) from hand over to each stage, ascending,
+    // indexed by PipelineStage
+    std::array<std::vector<double>, PIPELINE_STAGES> latencies;
+    //! @brief unread hits of the processing and storage cursors
+    DepthStats processingDepth;
+    DepthStats storageDepth;
+    //! @brief species hits waiting to be written
+    DepthStats speciesDepth;
+    //! @brief seconds from the first hand over until every stage last caught up
+    // with the source
+    double seconds = 0;
+
+    /**
+     * @fn double percentile(PipelineStage stage, double p) const
+     * @return p-quantile (0..1) of the latencies to stage in seconds, 0 if none
+     */
+    double percentile(PipelineStage stage, double p) const;
+};
+
+/**
+ * @class PipelineProbe
+ * @brief thread sampling the progress of the raw hit ring's consumers against
+ * a hit source
+ */
+class PipelineProbe final {
+    private:
+        /**
+         * @struct Mark
+         * @brief hits handed over by a point in time
+         */
+        struct Mark {
+            uint64_t fed;
+            std::chrono::steady_clock::time_point time;
+        };
+
+        //! @brief ring whose producer and cursors are followed
+        std::shared_ptr<BroadcastRing<mode::pixel_type>> rawHitsRing;
+
+        //! @brief species hit queue whose length is sampled
+        std::shared_ptr<SafeQueue<SpeciesHit>> speciesHitsQ;
+
+        //! @brief discards of rawHitsRing (e.g. AcqController::rawHitsOverflowStats())
+        const OverflowCounter& ringOverflow;
+
+        //! @brief time between samples
+        const std::chrono::microseconds interval;
+
+        //! @brief hits handed over by the source so far
+        std::atomic<uint64_t> fed_ = 0;
+
+        //! @brief time of the first hand over (ns, steady clock), 0 before it
+        std::atomic<int64_t> firstFedNs_ = 0;
+
+        //! @brief marks not yet handled, per stage
+        std::array<std::deque<Mark>, PIPELINE_STAGES> pending;
+
+        //! @brief last mark taken
+        uint64_t lastMark = 0;
+
+        //! @brief sums of the sampled depths and number of samples
+        double processingSum = 0;
+        double storageSum = 0;
+        double speciesSum = 0;
+        uint64_t samples = 0;
+
+        //! @brief first time every stage had handled caughtUpFed hits
+        std::chrono::steady_clock::time_point caughtUp;
+        uint64_t caughtUpFed = 0;
+
+        //! @brief totals so far
+        PipelineReport report_;
+
+        //! @brief wakes the sampling thread for shutdown
+        ResourceGuard wake;
+
+        //! @brief thread running sample() every interval
+        std::jthread probeThread;
+
+        /**
+         * @fn uint64_t handled(PipelineStage stage, uint64_t discarded) const
+         * @return hits stage has handled, given the ring discarded that many
+         */
+        uint64_t handled(PipelineStage stage, uint64_t discarded) const;
+
+        /**
+         * @fn void sample()
+         * @brief one sampling pass (run by the sampling thread)
+         */
+        void sample();
+
+    public:
+        /**
+         * @fn PipelineProbe(std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
+         * std::shared_ptr<SafeQueue<SpeciesHit>> shq, const OverflowCounter& ringOverflow,
+         * std::chrono::microseconds interval)
+         * @param rhr raw hit ring (RAW_CURSOR_PROCESSING and RAW_CURSOR_STORAGE are followed)
+         * @param shq species hit queue
+         * @param ringOverflow discard statistics of rhr, must outlive the probe
+         * @param interval time between samples
+         */
+        PipelineProbe(
+            std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
+            std::shared_ptr<SafeQueue<SpeciesHit>> shq,
+            const OverflowCounter& ringOverflow,
+            std::chrono::microseconds interval = PROBE_INTERVAL
+        );
+
+        /**
+         * @fn ~PipelineProbe()
+         * @brief stops the sampling thread (see stop())
+         */
+        ~PipelineProbe();
+
+        /**
+         * @fn void fed(uint64_t total)
+         * @brief (source) records that total hits have been handed over so far
+         */
+        void fed(uint64_t total);
+
+        /**
+         * @fn void start()
+         * @brief launches the sampling thread
+         */
+        void start();
+
+        /**
+         * @fn bool drained() const
+         * @return true if every stage has handled every hit handed over
+         */
+        bool drained() const;
+
+        /**
+         * @fn PipelineReport stop()
+         * @brief stops the sampling thread, samples once more and sorts the latencies
+         *
+         * @return everything seen since start()
+         */
+        PipelineReport stop();
+};
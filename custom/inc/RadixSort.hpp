@@ -0,0 +1,114 @@
+/**
+ * @file RadixSort.hpp
+ * @brief LSD radix sort of element pointers by a 64-bit key
+ */
+
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "globals.h"
+
+/**
+ * @struct RadixEntry
+ * @brief sort key of an element with a pointer back to it
+ */
+template <typename T> struct RadixEntry {
+    uint64_t key;
+    const T* item;
+};
+
+/**
+ * @struct RadixScratch
+ * @brief working memory of radixSortPtrs, reused between calls to avoid allocations
+ */
+template <typename T> struct RadixScratch {
+    std::vector<RadixEntry<T>> a;
+    std::vector<RadixEntry<T>> b;
+};
+
+/**
+ * @fn void radixSortPtrs(const T* items, size_t n, KeyFn key,
+ * std::vector<const T*>& out, RadixScratch<T>& scratch)
+ * @brief stable sort of pointers to items[0..n) in ascending order of key(item)
+ *
+ * Sorts (key, pointer) pairs rather than the items themselves, so items are
+ * read once and never moved. Keys are rebased on the smallest key and only
+ * the bytes that actually differ within the batch get a counting pass: a batch
+ * of hits spanning 2^20 tics needs 3 passes regardless of the absolute toa.
+ * Batches below RADIX_SORT_MIN elements use a comparison sort instead.
+ *
+ * @param[in] items elements to sort
+ * @param[in] n number of elements
+ * @param[in] key returns the uint64_t sort key of an element
+ * @param[out] out receives n pointers into items, in sorted order
+ * @param scratch working memory
+ */
+template <typename T, typename KeyFn>
+void radixSortPtrs(
+    const T* items,
+    size_t n,
+    KeyFn key,
+    std::vector<const T*>& out,
+    RadixScratch<T>& scratch
+){
+    out.resize(n);
+    if (n < RADIX_SORT_MIN) {
+        for (size_t i = 0; i < n; ++i) { out[i] = items + i; }
+        // ties broken by position keep the result identical to the radix path
+        std::sort(out.begin(), out.end(), [&](const T* l, const T* r){
+            const uint64_t kl = key(*l);
+            const uint64_t kr = key(*r);
+            return kl < kr || (kl == kr && l < r);
+        });
+        return;
+    }
+
+    auto& src = scratch.a;
+    auto& dst = scratch.b;
+    src.resize(n);
+    dst.resize(n);
+
+    uint64_t minKey = UINT64_MAX;
+    uint64_t maxKey = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const uint64_t k = key(items[i]);
+        src[i] = {k, items + i};
+        minKey = std::min(minKey, k);
+        maxKey = std::max(maxKey, k);
+    }
+
+    size_t bytes = 0;
+    for (uint64_t range = maxKey - minKey; range; range >>= 8) { ++bytes; }
+
+    // one read to build the histograms of all needed digits
+    std::array<std::array<uint32_t, 256>, 8> counts{};
+    for (auto& e : src) {
+        e.key -= minKey;
+        for (size_t d = 0; d < bytes; ++d) {
+            ++counts[d][(e.key >> (8 * d)) & 0xff];
+        }
+    }
+
+    for (size_t d = 0; d < bytes; ++d) {
+        auto& cnt = counts[d];
+        const size_t shift = 8 * d;
+
+        // all keys share this digit: the pass would be a plain copy
+        if (cnt[(src[0].key >> shift) & 0xff] == n) { continue; }
+
+        uint32_t offset = 0;
+        for (auto& c : cnt) {
+            const uint32_t tmp = c;
+            c = offset;
+            offset += tmp;
+        }
+        for (const auto& e : src) {
+            dst[cnt[(e.key >> shift) & 0xff]++] = e;
+        }
+        src.swap(dst);
+    }
+
+    for (size_t i = 0; i < n; ++i) { out[i] = src[i].item; }
+}
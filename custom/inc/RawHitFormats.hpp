@@ -0,0 +1,543 @@
+/**
+ * @file RawHitFormats.hpp
+ * @brief on-disk formats for raw hit (pixel) data: writers and reader
+ *
+ * Binary raw file layout (all integers little-endian):
+ *
+ *     file header:  magic[8] "SPR3RAW\0" | version u16 | record size u16 |
+ *                   metadata length u32 | metadata (genHeader text)
+ *     block:        block magic u32 "RBLK" | encoding u16 | reserved u16 |
+ *                   record count u32 | payload length u32 |
+ *                   min toa u64 | max toa u64 | payload
+ *
+ * RAW_BLOCK_FIXED payload: one record per hit
+ *     record:       x u8 | y u8 | tot u16 | toa u64
+ *
+ * RAW_BLOCK_COLUMNAR payload: one column per field
+ *     x[count] u8 | y[count] u8 | tot column | toa column
+ * The toa column holds the difference of each toa to the previous one (the
+ * first to the block's min toa), zig-zag mapped so small negative steps stay
+ * small. The tot and toa columns start with a mode byte: RAW_COLUMN_VARINT
+ * (LEB128 varints follow) or RAW_COLUMN_BITPACK (a width byte follows, then
+ * count values of that many bits, LSB first); the writer picks whichever is
+ * smaller for the block.
+ *
+ * Blocks are self-describing so readers can skip or validate them without
+ * decoding the payload.
+ *
+ * Next to every raw file the writer keeps a sidecar index (<file>RAW_IDX_EXT)
+ * with one entry per block, appended as blocks are written. Text raw files have
+ * no blocks; there an entry covers RAW_BLOCK_RECORDS lines and its offset is
+ * that of the first of them.
+ *
+ *     index header: magic[8] "SPR3IDX\0" | version u16 | reserved u16 |
+ *                   records per block u32
+ *     entry:        block offset u64 | record count u32 | reserved u32 |
+ *                   min toa u64 | max toa u64
+ */
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "globals.h"
+
+//! @brief identifies a binary raw hit file
+constexpr char RAW_BIN_MAGIC[8] = {'S','P','R','3','R','A','W','\0'};
+//! @brief version of the binary raw hit file layout
+constexpr uint16_t RAW_BIN_VERSION = 1;
+//! @brief bytes per hit in a RAW_BLOCK_FIXED block
+constexpr uint16_t RAW_BIN_RECORD_SIZE = 12;
+//! @brief marks the start of every block ("RBLK" in file byte order)
+constexpr uint32_t RAW_BLOCK_MAGIC = 0x4B4C4252;
+//! @brief bytes in a block header
+constexpr size_t RAW_BLOCK_HEADER_SIZE = 32;
+//! @brief block encoding: payload is an array of fixed size records
+constexpr uint16_t RAW_BLOCK_FIXED = 0;
+//! @brief block encoding: payload is delta/varint compressed columns
+constexpr uint16_t RAW_BLOCK_COLUMNAR = 1;
+//! @brief columnar column mode: LEB128 varints
+constexpr uint8_t RAW_COLUMN_VARINT = 0;
+//! @brief columnar column mode: fixed bit width values
+constexpr uint8_t RAW_COLUMN_BITPACK = 1;
+
+//! @brief identifies a raw hit index file
+constexpr char RAW_IDX_MAGIC[8] = {'S','P','R','3','I','D','X','\0'};
+//! @brief version of the raw hit index layout
+constexpr uint16_t RAW_IDX_VERSION = 1;
+//! @brief bytes in the index header
+constexpr size_t RAW_IDX_HEADER_SIZE = 16;
+//! @brief bytes per index entry
+constexpr size_t RAW_IDX_ENTRY_SIZE = 32;
+//! @brief appended to a raw file name to get the name of its index
+const std::string RAW_IDX_EXT = ".idx";
+//! @brief extension of text raw files
+constexpr char RAW_TEXT_EXT[] = ".txt";
+//! @brief extension of binary raw files
+constexpr char RAW_BIN_EXT[] = ".bin";
+
+/**
+ * @struct RawBlockInfo
+ * @brief decoded block header
+ */
+struct RawBlockInfo {
+    uint16_t encoding;
+    uint32_t records;
+    uint32_t payloadLen;
+    uint64_t minToa;
+    uint64_t maxToa;
+};
+
+/**
+ * @fn void encodeRawBlock(uint16_t encoding, const mode::pixel_type* hits,
+ * size_t count, std::vector<uint8_t>& out)
+ * @brief appends a complete block (header + payload) holding count hits to out
+ */
+void encodeRawBlock(
+    uint16_t encoding,
+    const mode::pixel_type* hits,
+    size_t count,
+    std::vector<uint8_t>& out
+);
+
+/**
+ * @fn void decodeRawBlock(const RawBlockInfo& info, const uint8_t* payload,
+ * std::vector<mode::pixel_type>& hits)
+ * @brief decodes a block payload, replacing the contents of hits
+ *
+ * @note throws std::runtime_error if the payload is malformed
+ */
+void decodeRawBlock(
+    const RawBlockInfo& info,
+    const uint8_t* payload,
+    std::vector<mode::pixel_type>& hits
+);
+
+/**
+ * @class RawHitWriter
+ * @brief writes raw hits to a single output file in some RawFormat
+ */
+class RawHitWriter {
+    public:
+        virtual ~RawHitWriter() = default;
+
+        /**
+         * @fn bool open(const std::string& path, const std::string& header)
+         * @brief creates (truncates) path and writes the file header
+         *
+         * @param[in] path file to create
+         * @param[in] header acquisition metadata (see StorageManager::genHeader)
+         *
+         * @return false if the file could not be created
+         */
+        virtual bool open(const std::string& path, const std::string& header) = 0;
+
+        /**
+         * @fn void write(const mode::pixel_type* hits, size_t count)
+         * @brief appends count hits to the file (may be buffered)
+         */
+        virtual void write(const mode::pixel_type* hits, size_t count) = 0;
+
+        /**
+         * @fn void close()
+         * @brief writes out any buffered hits and closes the file
+         */
+        virtual void close() = 0;
+
+        /**
+         * @fn bool isOpen() const
+         * @return true while a file is open
+         */
+        virtual bool isOpen() const = 0;
+
+        /**
+         * @fn const char* extension() const
+         * @return file name extension for this format, including the dot
+         */
+        virtual const char* extension() const = 0;
+};
+
+/**
+ * @class TextRawHitWriter
+ * @brief writes raw hits as "x y toa tot" text lines, indexed every
+ * RAW_BLOCK_RECORDS lines
+ */
+class TextRawHitWriter final : public RawHitWriter {
+    private:
+        //! @brief output file
+        std::ofstream outFile;
+
+        //! @brief sidecar index of outFile
+        std::ofstream idxFile;
+
+        //! @brief number of bytes written to outFile
+        uint64_t fileOffset = 0;
+
+        //! @brief offset, line count and toa range of the lines not yet indexed
+        uint64_t blockOffset = 0;
+        uint32_t blockRecords = 0;
+        uint64_t blockMinToa = 0;
+        uint64_t blockMaxToa = 0;
+
+        /**
+         * @fn void flushEntry()
+         * @brief appends the index entry of the lines not yet indexed
+         */
+        void flushEntry();
+
+    public:
+        ~TextRawHitWriter() override { close(); }
+        bool open(const std::string& path, const std::string& header) override;
+        void write(const mode::pixel_type* hits, size_t count) override;
+        void close() override;
+        bool isOpen() const override { return outFile.is_open(); }
+        const char* extension() const override { return RAW_TEXT_EXT; }
+};
+
+/**
+ * @class BinaryRawHitWriter
+ * @brief writes raw hits in the binary layout described at the top of this file
+ *
+ * Hits are collected and encoded once RAW_BLOCK_RECORDS of them are pending
+ * (or on close), so the file sees a few large writes rather than one per hit.
+ */
+class BinaryRawHitWriter final : public RawHitWriter {
+    private:
+        //! @brief output file
+        std::ofstream outFile;
+
+        //! @brief block encoding (RAW_BLOCK_FIXED or RAW_BLOCK_COLUMNAR)
+        const uint16_t encoding;
+
+        //! @brief hits waiting to be encoded into the next block
+        std::vector<mode::pixel_type> pending;
+
+        //! @brief encoded block, reused between blocks
+        std::vector<uint8_t> block;
+
+        //! @brief sidecar index of outFile
+        std::ofstream idxFile;
+
+        //! @brief number of bytes written to outFile
+        uint64_t fileOffset = 0;
+
+        /**
+         * @fn void flushBlock()
+         * @brief encodes the pending hits as one block and writes it out
+         */
+        void flushBlock();
+
+    public:
+        /**
+         * @fn BinaryRawHitWriter(uint16_t encoding)
+         * @param encoding block encoding to write
+         */
+        explicit BinaryRawHitWriter(uint16_t encoding = RAW_BLOCK_FIXED);
+        ~BinaryRawHitWriter() override { close(); }
+        bool open(const std::string& path, const std::string& header) override;
+        void write(const mode::pixel_type* hits, size_t count) override;
+        void close() override;
+        bool isOpen() const override { return outFile.is_open(); }
+        const char* extension() const override { return RAW_BIN_EXT; }
+};
+
+/**
+ * @fn std::unique_ptr<RawHitWriter> makeRawHitWriter(RawFormat format)
+ * @brief creates a writer for the given raw format
+ */
+std::unique_ptr<RawHitWriter> makeRawHitWriter(RawFormat format);
+
+/**
+ * @struct RawIndexEntry
+ * @brief location and time range of one block of a raw file (RAW_BLOCK_RECORDS
+ * lines of a text raw file)
+ */
+struct RawIndexEntry {
+    uint64_t offset;
+    uint32_t records;
+    uint64_t minToa;
+    uint64_t maxToa;
+};
+
+/**
+ * @class RawHitReader
+ * @brief reads back raw hit files written by BinaryRawHitWriter, block by block
+ *
+ * A block cut short by the end of the file (the writer stopped while writing
+ * it) ends the data, see truncated().
+ *
+ * @note throws std::runtime_error on files that are not binary raw hit files,
+ * use an unsupported version, or contain malformed blocks
+ */
+class RawHitReader final {
+    private:
+        //! @brief input file
+        std::ifstream inFile;
+
+        //! @brief layout version read from the file header
+        uint16_t version_ = 0;
+
+        //! @brief acquisition metadata stored in the file header
+        std::string metadata_;
+
+        //! @brief raw bytes of the current block payload
+        std::vector<uint8_t> payload;
+
+        //! @brief header of the last block read
+        RawBlockInfo lastBlock_ = {};
+
+        //! @brief file offset of the first block
+        uint64_t dataOffset_ = 0;
+
+        //! @brief size of the file in bytes
+        uint64_t fileSize_ = 0;
+
+        //! @brief a block was found cut short by the end of the file
+        bool truncated_ = false;
+
+        /**
+         * @fn bool readBlockHeader()
+         * @brief reads the next block header into lastBlock_
+         * @return false at end of file or at a block the file ends inside of
+         */
+        bool readBlockHeader();
+
+    public:
+        /**
+         * @fn RawHitReader(const std::string& path)
+         * @brief opens path and parses the file header
+         */
+        explicit RawHitReader(const std::string& path);
+
+        /**
+         * @fn uint16_t version() const
+         * @return layout version of the file
+         */
+        uint16_t version() const { return version_; }
+
+        /**
+         * @fn const std::string& metadata() const
+         * @return acquisition metadata (genHeader text) stored in the file
+         */
+        const std::string& metadata() const { return metadata_; }
+
+        /**
+         * @fn bool readBlock(std::vector<mode::pixel_type>& hits)
+         * @brief decodes the next block, replacing the contents of hits
+         *
+         * @return false once the end of the file has been reached
+         */
+        bool readBlock(std::vector<mode::pixel_type>& hits);
+
+        /**
+         * @fn const RawBlockInfo& lastBlock() const
+         * @return header of the block last returned by readBlock
+         */
+        const RawBlockInfo& lastBlock() const { return lastBlock_; }
+
+        /**
+         * @fn uint64_t dataOffset() const
+         * @return file offset of the first block
+         */
+        uint64_t dataOffset() const { return dataOffset_; }
+
+        /**
+         * @fn void seek(uint64_t offset)
+         * @brief positions the reader at the block starting at offset
+         * (e.g. RawIndexEntry::offset)
+         */
+        void seek(uint64_t offset);
+
+        /**
+         * @fn bool skipBlock(uint64_t& offset)
+         * @brief reads only the header of the next block (see lastBlock())
+         * and moves past its payload
+         *
+         * @param[out] offset file offset of the skipped block
+         * @return false once the end of the file has been reached
+         */
+        bool skipBlock(uint64_t& offset);
+
+        /**
+         * @fn std::vector<mode::pixel_type> readAll()
+         * @brief decodes all remaining blocks
+         */
+        std::vector<mode::pixel_type> readAll();
+
+        /**
+         * @fn bool truncated() const
+         * @return true if reading stopped at a block the file ends inside of
+         */
+        bool truncated() const { return truncated_; }
+};
+
+/**
+ * @class TextRawHitReader
+ * @brief reads back raw hit files written by TextRawHitWriter, RAW_BLOCK_RECORDS
+ * lines at a time
+ *
+ * A last line without its newline (the writer stopped while writing it) ends
+ * the data, see truncated().
+ *
+ * @note throws std::runtime_error if the file cannot be opened or a complete
+ * line is not "x y toa tot"
+ */
+class TextRawHitReader final {
+    private:
+        //! @brief input file
+        std::ifstream inFile;
+
+        //! @brief line being parsed, reused between lines
+        std::string line;
+
+        //! @brief file offset of the first line after the header
+        uint64_t dataOffset_ = 0;
+
+        //! @brief the last line of the file is incomplete
+        bool truncated_ = false;
+
+    public:
+        /**
+         * @fn TextRawHitReader(const std::string& path)
+         * @brief opens path and skips the header ('#' lines)
+         */
+        explicit TextRawHitReader(const std::string& path);
+
+        /**
+         * @fn void seek(uint64_t offset)
+         * @brief positions the reader at the line starting at offset
+         * (e.g. RawIndexEntry::offset)
+         */
+        void seek(uint64_t offset);
+
+        /**
+         * @fn bool readBlock(std::vector<mode::pixel_type>& hits, uint64_t& offset)
+         * @brief reads up to RAW_BLOCK_RECORDS lines, replacing the contents of hits
+         *
+         * @param[out] offset file offset of the first line read
+         * @return false once the end of the data has been reached
+         */
+        bool readBlock(std::vector<mode::pixel_type>& hits, uint64_t& offset);
+
+        /**
+         * @fn uint64_t dataOffset() const
+         * @return file offset of the first line after the header
+         */
+        uint64_t dataOffset() const { return dataOffset_; }
+
+        /**
+         * @fn bool truncated() const
+         * @return true if reading stopped at an incomplete last line
+         */
+        bool truncated() const { return truncated_; }
+};
+
+/**
+ * @class RawHitIndex
+ * @brief time range index over the blocks of one raw file (binary or text)
+ */
+class RawHitIndex final {
+    private:
+        //! @brief one entry per block, in file order
+        std::vector<RawIndexEntry> entries_;
+
+        //! @brief the file ends inside a block
+        bool truncated_ = false;
+
+        /**
+         * @fn void scanRemaining(RawHitReader& reader)
+         * @brief appends entries for all blocks from the reader's position to
+         * the end of file
+         */
+        void scanRemaining(RawHitReader& reader);
+
+        /**
+         * @fn static std::vector<RawIndexEntry> readSidecar(const std::string& rawPath)
+         * @return entries of the sidecar index of rawPath, none if it is
+         * missing or of another layout
+         */
+        static std::vector<RawIndexEntry> readSidecar(const std::string& rawPath);
+
+        /**
+         * @fn static RawHitIndex forTextFile(const std::string& rawPath)
+         * @brief forFile for text raw files
+         */
+        static RawHitIndex forTextFile(const std::string& rawPath);
+
+    public:
+        /**
+         * @fn static RawHitIndex forFile(const std::string& rawPath)
+         * @brief loads the sidecar index of rawPath, indexing any blocks the
+         * sidecar does not cover (e.g. after a crash) by scanning block headers;
+         * without a sidecar the whole file is scanned. Sidecar entries of
+         * blocks not fully in the file are dropped, and a final block cut
+         * short is left out (see truncated()). Files ending in RAW_TEXT_EXT are
+         * read as text raw files, all others as binary ones.
+         *
+         * @note throws std::runtime_error on malformed files
+         */
+        static RawHitIndex forFile(const std::string& rawPath);
+
+        /**
+         * @fn const std::vector<RawIndexEntry>& entries() const
+         * @return one entry per block, in file order
+         */
+        const std::vector<RawIndexEntry>& entries() const { return entries_; }
+
+        /**
+         * @fn bool truncated() const
+         * @return true if the file ends inside a block, which is not indexed
+         */
+        bool truncated() const { return truncated_; }
+};
+
+/**
+ * @fn size_t queryRawHits(const std::string& rawPath, uint64_t fromToa,
+ * uint64_t toToa, std::vector<mode::pixel_type>& out, bool* truncated)
+ * @brief appends all hits of a raw file (binary or text, see RawHitIndex::forFile)
+ * with fromToa <= toa <= toToa to out, decoding only the blocks whose time
+ * range overlaps the interval
+ *
+ * @param[out] truncated if given, set to true when the file ends inside a
+ * block (e.g. after a crash); the hits of the blocks before it are still appended
+ * @return number of hits appended
+ */
+size_t queryRawHits(
+    const std::string& rawPath,
+    uint64_t fromToa,
+    uint64_t toToa,
+    std::vector<mode::pixel_type>& out,
+    bool* truncated = nullptr
+);
+
+/**
+ * @fn size_t queryRawRun(const std::string& dir, const std::string& runNum,
+ * uint64_t fromToa, uint64_t toToa, std::vector<mode::pixel_type>& out,
+ * bool* truncated)
+ * @brief queryRawHits over all raw files of a run, in file order
+ *
+ * @param[out] truncated if given, set to true when any of the files ends
+ * inside a block
+ * @return number of hits appended
+ */
+size_t queryRawRun(
+    const std::string& dir,
+    const std::string& runNum,
+    uint64_t fromToa,
+    uint64_t toToa,
+    std::vector<mode::pixel_type>& out,
+    bool* truncated = nullptr
+);
+
+/**
+ * @fn std::vector<std::filesystem::path> findRunFiles(const std::string& dir,
+ * const std::string& runNum)
+ * @brief lists the raw files (binary or text) of a run in dir, ordered by file number
+ */
+std::vector<std::filesystem::path> findRunFiles(
+    const std::string& dir,
+    const std::string& runNum
+);
@@ -0,0 +1,245 @@
+/**
+ * @file ShowerGenerator.hpp
+ * @brief synthetic particle shower hits for load testing and benchmarks
+ *
+ * Particles arrive as a poisson process at the configured flux and leave the
+ * cluster shapes the species grading sees in flight data: x-rays (1-4 pixel
+ * charge sharing clusters), minimum ionising particle tracks (straight lines
+ * across the chip with Landau-like ToT) and heavy ions (round blobs with a
+ * saturating core). A few noisy pixels fire on top. Hits within a cluster are
+ * delayed by timewalk, and the output is reordered the way the double column
+ * readout of the chip delivers it.
+ *
+ * Generation does not depend on the configured flux and runs at tens of
+ * Mhits/s, so it never limits the pipeline under test.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "CustomDataTypes.hpp"
+#include "KatherineEmulator.hpp"
+#include "globals.h"
+
+/**
+ * @enum ParticleKind
+ * @brief what produced a cluster of generated hits
+ */
+enum class ParticleKind {
+    XRAY,      //!< 1-4 pixel cluster
+    MIP,       //!< straight track of minimum ionising particle
+    HEAVY_ION, //!< round blob, saturating in its core
+    NOISE,     //!< single hit of a noisy pixel
+};
+
+//! @brief number of ParticleKind values
+constexpr size_t PARTICLE_KINDS = 4;
+
+/**
+ * @struct ShowerSettings
+ * @brief flux, species mix and spectra of generated hits
+ */
+struct ShowerSettings {
+    //! @brief particles per second hitting the chip (noise excluded)
+    double particleRate = 1e5;
+    //! @brief relative share of x-rays, MIPs and heavy ions among particles
+    double xrayWeight = 0.70;
+    double mipWeight = 0.27;
+    double heavyIonWeight = 0.03;
+
+    //! @brief relative share of 1, 2, 3 and 4 pixel x-ray clusters
+    std::array<double, 4> xraySizeWeights = {0.55, 0.25, 0.13, 0.07};
+    //! @brief x-ray cluster ToT (summed over its pixels), gaussian
+    double xrayTotMean = 120;
+    double xrayTotSigma = 12;
+
+    //! @brief longest MIP track, in pixels
+    uint16_t mipMaxLength = 40;
+    //! @brief ToT per MIP track pixel, Moyal (Landau approximation)
+    double mipTotMpv = 40;
+    double mipTotWidth = 6;
+
+    //! @brief heavy ion blob radius range, in pixels
+    uint16_t heavyIonMinRadius = 2;
+    uint16_t heavyIonMaxRadius = 6;
+    //! @brief ToT of the centre pixel of a heavy ion blob, before saturation
+    double heavyIonTotPeak = 900;
+
+    //! @brief number of noisy pixels, and hits per second each of them fires
+    size_t noisyPixels = 16;
+    double noiseRate = 1000;
+    //! @brief noise hits have ToT 1..noiseTotMax
+    uint16_t noiseTotMax = 8;
+
+    //! @brief hit delay (ticks) times ToT, limited to CLUSTER_TOA_WINDOW - 1 ticks
+    double timewalk = 40;
+
+    //! @brief span (ticks) within which the readout emits hits by double
+    // column instead of by time, 0 keeps hits in time order
+    uint64_t readoutWindow = 64;
+
+    //! @brief toa of the start of the generated stream
+    uint64_t startToa = 0;
+    //! @brief seed of the random stream; equal settings give equal hits
+    uint64_t seed = 1;
+};
+
+/**
+ * @struct ShowerStats
+ * @brief totals of a ShowerGenerator
+ */
+struct ShowerStats {
+    //! @brief particles generated, indexed by ParticleKind
+    std::array<uint64_t, PARTICLE_KINDS> particles{};
+    //! @brief hits handed out
+    uint64_t hits = 0;
+};
+
+/**
+ * @class ShowerGenerator
+ * @brief endless stream of synthetic hits, in readout order
+ */
+class ShowerGenerator final {
+    private:
+        /**
+         * @struct Rng
+         * @brief xoshiro256** generator, several times faster than mt19937_64
+         */
+        struct Rng {
+            uint64_t s[4];
+            explicit Rng(uint64_t seed);
+            uint64_t next();
+            //! @return uniform in [0, 1)
+            double uniform(){ return (next() >> 11) * 0x1.0p-53; }
+            //! @return uniform in [0, n)
+            uint32_t below(uint32_t n){ return static_cast<uint32_t>(((next() >> 32) * n) >> 32); }
+        };
+
+        //! @brief entries of a quantile table, sampled with a single random index
+        static constexpr size_t QUANTILES = 4096;
+
+        //! @brief flux, mix and spectra
+        const ShowerSettings settings;
+
+        //! @brief random stream
+        Rng rng;
+
+        //! @brief cumulative probability of each ParticleKind per event
+        std::array<double, PARTICLE_KINDS> kindCdf{};
+
+        //! @brief cumulative probability of each x-ray cluster size
+        std::array<double, 4> xraySizeCdf{};
+
+        //! @brief quantiles of the x-ray cluster ToT and MIP pixel ToT spectra
+        std::vector<uint16_t> xrayTot;
+        std::vector<uint16_t> mipTot;
+
+        //! @brief timewalk delay (ticks) by ToT
+        std::vector<uint8_t> walk;
+
+        //! @brief coordinates of the noisy pixels
+        std::vector<mode::pixel_type> noisy;
+
+        //! @brief mean ticks between events (particles and noise hits)
+        double meanSpacing;
+
+        //! @brief toa of the next event, ticks since settings.startToa
+        double nextToa = 0;
+
+        //! @brief hits of the current readout window, in readout order
+        std::vector<mode::pixel_type> out;
+
+        //! @brief hits of out already handed out
+        size_t outPos = 0;
+
+        //! @brief scratch space of the readout reordering
+        std::vector<mode::pixel_type> sorted;
+
+        //! @brief staging buffer of fill() and push()
+        std::vector<mode::pixel_type> scratch;
+
+        //! @brief totals so far
+        ShowerStats stats_;
+
+        /**
+         * @fn void addHit(int x, int y, uint64_t toa, double tot)
+         * @brief appends a hit to out if (x, y) is on the chip, delayed by timewalk
+         */
+        void addHit(int x, int y, uint64_t toa, double tot);
+
+        /**
+         * @fn void addParticle(uint64_t toa)
+         * @brief appends the hits of one random event at toa to out
+         */
+        void addParticle(uint64_t toa);
+
+        /**
+         * @fn void refill()
+         * @brief replaces out with the hits of the next readout window
+         */
+        void refill();
+
+    public:
+        /**
+         * @fn ShowerGenerator(const ShowerSettings& settings)
+         * @param settings flux, species mix and spectra
+         */
+        explicit ShowerGenerator(const ShowerSettings& settings = ShowerSettings());
+
+        /**
+         * @fn size_t generate(mode::pixel_type* hits, size_t max)
+         * @brief writes the next max hits of the stream
+         *
+         * @param[out] hits at least max elements
+         * @param[in] max number of hits to write
+         *
+         * @return max (the stream never ends)
+         */
+        size_t generate(mode::pixel_type* hits, size_t max);
+
+        /**
+         * @fn uint64_t fill(SafeBuff<mode::pixel_type>& buf, size_t count, size_t& discarded)
+         * @brief adds the next count hits to buf, as a pixels_received callback would
+         *
+         * @param[in] buf buffer to add to (locked while adding, then notified)
+         * @param[in] count number of hits
+         * @param[out] discarded hits that did not fit into buf
+         *
+         * @return number of elements in buf after the addition
+         */
+        uint64_t fill(SafeBuff<mode::pixel_type>& buf, size_t count, size_t& discarded);
+
+        /**
+         * @fn uint64_t push(BroadcastRing<mode::pixel_type>& ring, size_t count, size_t& discarded)
+         * @brief pushes the next count hits into ring, as AcqController does
+         *
+         * @param[in] ring ring to push to (this thread becomes its producer)
+         * @param[in] count number of hits
+         * @param[out] discarded hits that did not fit into ring
+         *
+         * @return number of elements in ring after the push
+         */
+        uint64_t push(BroadcastRing<mode::pixel_type>& ring, size_t count, size_t& discarded);
+
+        //! @return totals so far
+        const ShowerStats& stats() const { return stats_; }
+
+        //! @return settings of this generator
+        const ShowerSettings& getSettings() const { return settings; }
+};
+
+/**
+ * @fn ShowerSettings matchHitRate(ShowerSettings settings, double hitRate)
+ * @brief sets settings.particleRate so that the generated stream carries
+ * about hitRate hits per second (noise included)
+ *
+ * @note estimated from a sample of generated hits
+ */
+ShowerSettings matchHitRate(ShowerSettings settings, double hitRate);
+
+/**
+ * @fn EmulatorHitSource showerHitSource(const ShowerSettings& settings)
+ * @brief generated showers as a KatherineEmulator hit source
+ */
+EmulatorHitSource showerHitSource(const ShowerSettings& settings = ShowerSettings());
@@ -4,11 +4,14 @@
  */
 
 #pragma once
+#include <functional>
 #include <memory>
+#include <ostream>
 #include <thread>
 #include <string>
 #include "CustomDataTypes.hpp"
 #include "Logger.hpp"
+#include "RawHitFormats.hpp"
 
 /**
  * @class StorageManager
@@ -24,8 +27,8 @@ class StorageManager final {
         //! @brief species hit buffer, species hits get written to file
         std::shared_ptr<SafeQueue<SpeciesHit>> speciesHitsQ;
 
-        //! @brief raw hit buffer, raw hits get written to file
-        std::shared_ptr<SafeBuff<mode::pixel_type>> rawHitsToWriteBuff;
+        //! @brief raw hit ring (shared with processing), raw hits get written to file
+        std::shared_ptr<BroadcastRing<mode::pixel_type>> rawHitsRing;
         
         //! @brief logger writes log statments to file
         std::shared_ptr<Logger> logger;
@@ -40,6 +43,35 @@ class StorageManager final {
         // see genHeader function
         std::stringstream header;
 
+        /**
+         * @fn bool rollOverFile(size_t& count, size_t& fileNo, size_t softMax,
+         * const std::string& storagePath, const std::string& filename,
+         * const std::string& extension, const std::function<bool(const std::string&)>& openFile)
+         * @brief shared part of checkUpdateOutFile and checkUpdateRawFile: once
+         * count exceeds softMax, names the next file and has openFile replace
+         * the current one with it
+         *
+         * @param[inout] count lines/hits written to the current file
+         * @param[inout] fileNo output file number
+         * @param[in] softMax maximum number of lines/hits (soft, see checkUpdateOutFile)
+         * @param[in] storagePath path to folder new outfiles are created in
+         * @param[in] filename name describing outfile type e.g. "rawHits"
+         * @param[in] extension file name extension, including the dot
+         * @param[in] openFile closes the current file, creates the given one
+         * (with header) and returns true if it is open
+         *
+         * @return false (and logs FATAL) if the new file could not be created
+         */
+        bool rollOverFile(
+            size_t& count,
+            size_t& fileNo,
+            size_t softMax,
+            const std::string& storagePath,
+            const std::string& filename,
+            const std::string& extension,
+            const std::function<bool(const std::string&)>& openFile
+        );
+
         /**
          * @fn bool checkUpdateOutFile
          * @brief checks if output file is over it line max;
@@ -66,15 +98,26 @@ class StorageManager final {
             const size_t softMaxLines
         );
 
+        /**
+         * @fn bool checkUpdateRawFile(size_t& hitCount, RawHitWriter& writer, size_t& fileNo)
+         * @brief raw hit counterpart of checkUpdateOutFile: rolls writer over to a
+         * new file once hitCount exceeds MAX_RAW_FILE_LINES
+         * 
+         * @param[inout] hitCount number of hits written to the current file
+         * @param[inout] writer raw hit writer (in RAW_FILE_FORMAT)
+         * @param[inout] fileNo output file number
+         */
+        bool checkUpdateRawFile(size_t& hitCount, RawHitWriter& writer, size_t& fileNo);
+
     public:
         /**
          * @fn StorageManager(std::string runNum, std::shared_ptr<SafeQueue<SpeciesHit>>,
-         * std::shared_ptr<SafeBuff<mode::pixel_type>>,std::shared_ptr<Logger> log)
+         * std::shared_ptr<BroadcastRing<mode::pixel_type>>,std::shared_ptr<Logger> log)
          * @brief constructor for StorageManager
          * 
          * @param[in] runNum string describing run number (program run number)
          * @param shq species hit queue
-         * @param rh2w raw hit to write queue
+         * @param rhr raw hit ring to write from (via RAW_CURSOR_STORAGE)
          * @param log logger
          * 
          * @note after construction you must spawn the threads that write to file
@@ -83,7 +126,7 @@ class StorageManager final {
         StorageManager(
             const std::string& runNum,
             std::shared_ptr<SafeQueue<SpeciesHit>> shq,
-            std::shared_ptr<SafeBuff<mode::pixel_type>> rh2w,
+            std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
             std::shared_ptr<Logger> log
         );
 
@@ -99,6 +142,8 @@ class StorageManager final {
          * @fn launch()
          * @brief launches threads that consume data queues, writing to file
          * 
+         * returns once both threads are running, so producers may start immediately
+         * 
          * @note to have valid file headers, must call genHeader before calling launch
          */
         void launch();
@@ -129,4 +174,10 @@ class StorageManager final {
          * @param[in] config hardpix configuration (to be written in header)
          */
         void genHeader(const time_t& startTime, const katherine::config& config);
-};
\ No newline at end of file
+};
+
+/**
+ * @fn void writeSpeciesHit(std::ostream& out, const SpeciesHit& hit)
+ * @brief writes one line of a species file: "grade start_toa energy"
+ */
+void writeSpeciesHit(std::ostream& out, const SpeciesHit& hit);
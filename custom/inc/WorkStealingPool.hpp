@@ -0,0 +1,121 @@
+/**
+ * @file WorkStealingPool.hpp
+ * @brief fixed size thread pool running batches of independent tasks
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "globals.h"
+
+/**
+ * @class WorkStealingPool
+ * @brief runs a batch of tasks on a set of workers and waits for all of them
+ *
+ * Tasks of a batch are dealt out round-robin to per-worker queues. Each worker
+ * takes tasks from the back of its own queue and, once that is empty, steals
+ * from the front of the others, so uneven tasks still keep every worker busy.
+ * The thread calling run() is worker 0 and works on the batch as well.
+ */
+class WorkStealingPool final {
+    public:
+        //! @brief task function, called with the task number and the worker running it
+        using TaskFn = std::function<void(size_t task, size_t worker)>;
+
+    private:
+        /**
+         * @struct alignas(CACHE_LINE_SIZE) WorkerQueue
+         * @brief task numbers waiting for a worker
+         */
+        struct alignas(CACHE_LINE_SIZE) WorkerQueue {
+            std::mutex mtx;
+            std::deque<size_t> tasks;
+        };
+
+        //! @brief one queue per worker (including the caller of run())
+        std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+        //! @brief background workers 1..size()-1
+        std::vector<std::jthread> threads;
+
+        //! @brief task function of the current batch
+        const TaskFn* job = nullptr;
+
+        //! @brief tasks of the current batch not finished yet
+        std::atomic<size_t> remaining = 0;
+
+        //! @brief first exception thrown by a task of the current batch
+        std::exception_ptr failure;
+
+        //! @brief guards generation, failure and the wake/done signals
+        std::mutex mtx;
+        //! @brief wakes background workers when a batch starts
+        std::condition_variable wakeCv;
+        //! @brief wakes run() when the last task finished
+        std::condition_variable doneCv;
+        //! @brief number of batches started
+        uint64_t generation = 0;
+
+        /**
+         * @fn bool take(size_t worker, size_t& task)
+         * @brief gets the next task for worker: own queue first, then steal
+         *
+         * @return false if no task is left in any queue
+         */
+        bool take(size_t worker, size_t& task);
+
+        /**
+         * @fn void work(size_t worker)
+         * @brief runs tasks until all queues are empty
+         */
+        void work(size_t worker);
+
+        /**
+         * @fn void workerLoop(std::stop_token stopToken, size_t worker)
+         * @brief background worker: waits for a batch, works on it, repeat
+         */
+        void workerLoop(std::stop_token stopToken, size_t worker);
+
+    public:
+        /**
+         * @fn WorkStealingPool(size_t workers)
+         * @param workers number of workers including the caller of run(),
+         * so workers-1 threads are started (at least 1)
+         */
+        explicit WorkStealingPool(size_t workers);
+
+        /**
+         * @fn ~WorkStealingPool()
+         * @brief stops and joins the worker threads
+         */
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        /**
+         * @fn size_t size() const
+         * @return number of workers including the caller of run()
+         */
+        size_t size() const { return queues.size(); }
+
+        /**
+         * @fn void run(size_t count, const TaskFn& fn)
+         * @brief runs fn(task, worker) for every task in [0, count) and returns
+         * once all have finished
+         *
+         * A worker runs one task at a time, so per-worker state indexed by the
+         * worker argument needs no locking. Only one thread may call run() at a time.
+         *
+         * @throw rethrows the first exception thrown by a task, after all
+         * tasks have finished
+         */
+        void run(size_t count, const TaskFn& fn);
+};
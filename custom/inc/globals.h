@@ -5,6 +5,7 @@
 
 #pragma once
 #include <katherinexx/acquisition.hpp>
+#include <chrono>
 #include <string>
 
 // --------- \ Misc / -------------------------------------------------------------------
@@ -30,9 +31,28 @@ const std::string LOGS_DIR = OUTPUT_DIR + "/logs";
 const std::string DATA_DIR = OUTPUT_DIR + "/data";
 const std::string RAW_DATA_DIR = DATA_DIR + "/raw";
 const std::string SPECIES_DATA_DIR = DATA_DIR + "/species";
+//! @brief raw measurement data captures (see CAPTURE_RAW_MD)
+const std::string CAPTURE_DATA_DIR = DATA_DIR + "/capture";
+//! @brief binary cache of the constants derived from PATH_TO_CALIB (see CalibCache.hpp)
+const std::string PATH_TO_CALIB_CACHE = OUTPUT_DIR + "/calib_cache.bin";
 
 const std::string SPECIES_FILE_NAME = "speciesHits";
 const std::string RAW_FILE_NAME = "rawHits";
+const std::string CAPTURE_FILE_NAME = "mdCapture";
+
+/**
+ * @enum RawFormat
+ * @brief output format of raw hit files (see RawHitFormats.hpp)
+ */
+enum class RawFormat {
+    TEXT,   //!< one "x y toa tot" line per hit, '#' prefixed header
+    BINARY, //!< versioned header + framed blocks of fixed size records
+    COLUMNAR, //!< as BINARY, but blocks hold delta/varint compressed columns
+};
+
+//! @brief format raw hits are written in (all are indexed for rawQuery); BINARY
+// or COLUMNAR halve the raw data volume, but must be selected here explicitly
+constexpr RawFormat RAW_FILE_FORMAT = RawFormat::TEXT;
 
 // --------- / Path Settings \ ----------------------------------------------------------
 
@@ -44,7 +64,12 @@ const std::string RAW_FILE_NAME = "rawHits";
 // returned by lib_katherine  
 using mode = katherine::acq::toa_tot;
 //! @brief IP address of readout device in hardpix
+// (configure with -DHP_ADDRESS=... to override, e.g. EMU_ADDRESS for the emulator)
+#ifdef SPRINT_HP_ADDRESS
+const std::string HP_ADDRESS = SPRINT_HP_ADDRESS;
+#else
 const std::string HP_ADDRESS = "192.168.1.157";
+#endif
 //! @brief Chip ID of timepix sensor in hardpix
 const std::string CHIP_ID = "J2-W00054";
 
@@ -60,10 +85,38 @@ constexpr size_t CNXT_ATTEMPTS = 5;
 //! @brief seconds to wait between (non-powercycling) connection attempts
 constexpr size_t SEC_BTW_CNXT_ATTEMPTS = 3;
 
+//! @brief drain the UDP data socket on a dedicated receiver thread, decoupled from
+// measurement data decoding (falls back to inline receive where unsupported)
+constexpr bool UDP_RECV_THREAD = true;
+
+//! @brief also write the undecoded measurement data of each acquisition to
+// CAPTURE_DATA_DIR, for replay with mdReplay (about 6 bytes per hit)
+constexpr bool CAPTURE_RAW_MD = false;
+
 // --------- / Hardpix Settings \ -------------------------------------------------------
 
 
 
+// -------- \ Emulator Settings / --------------------------------------------------------
+
+//! @brief loopback address the Katherine emulator listens on; not 127.0.0.1 since
+// lib_katherine binds the same ports on all addresses (see KatherineEmulator.hpp)
+const std::string EMU_ADDRESS = "127.0.0.2";
+//! @brief port the Katherine readout receives commands on
+constexpr uint16_t EMU_CONTROL_PORT = 1555;
+//! @brief port lib_katherine receives measurement data on
+constexpr uint16_t EMU_DATA_PORT = 1556;
+//! @brief default hits per second streamed by the emulator
+constexpr double EMU_HIT_RATE = 1e6;
+//! @brief measurement data items per emulated data datagram
+constexpr size_t EMU_MDS_PER_DATAGRAM = 1000;
+//! @brief toa clock frequency (toa ticks per second)
+constexpr double TOA_TICKS_PER_SEC = 40e6;
+
+// -------- / Emulator Settings \ -------------------------------------------------------
+
+
+
 // -------- \ Power Cycle Settings / ----------------------------------------------------
 
 //! @brief gpio pin responsible for controlling the relay
@@ -91,10 +144,102 @@ constexpr size_t RAW_HIT_NOTIF_INC = 1000;
 //! @note must be at least as large as lib_katherine's internal pixel buffer
 constexpr size_t MAX_BUFF_EL = 65536;
 
+//! @brief batches smaller than this are sorted by comparison instead of radix sort
+// (crossover measured with bench/sort_bench.cc)
+constexpr size_t RADIX_SORT_MIN = 512;
+
+//! @brief largest distance a hit may be out of time order in a batch before the
+// batch is fully (radix) sorted instead of insertion sorted
+constexpr size_t SORT_WINDOW = 128;
+
+//! @brief average insertion moves per hit tolerated before a batch is fully sorted
+constexpr size_t SORT_MOVE_BUDGET = 8;
+
+//! @brief hits on touching pixels closer than this (ticks) belong to the same cluster;
+// a cluster is complete once a hit at least this far past its last hit arrives
+constexpr uint64_t CLUSTER_TOA_WINDOW = 5;
+
+//! @brief number of threads clustering a batch (including the DataProcessor thread);
+// 1 clusters every batch on the DataProcessor thread alone
+constexpr size_t CLUSTER_THREADS = 1;
+
+//! @brief smallest number of hits worth handing to another clustering thread
+constexpr size_t CLUSTER_SHARD_MIN_HITS = 2048;
+
+//! @brief hits with tot below this get their energy from precomputed per-pixel
+// tables instead of the calibration formula; costs CHIP_AREA * 4 bytes per tot
+// value (16MB for 64), 0 disables the tables
+//! @note off by default: with hits spread over the whole chip the table reads miss
+// cache and are slower than the formula (see bench/energy_bench.cc)
+constexpr uint16_t ENERGY_LUT_TOT_MAX = 0;
+
+//! @brief capacity (elements) of the lock-free raw hit ring between acquisition and
+// consumers; absorbs consumer stalls of ~1M hits before data is discarded
+constexpr size_t RAW_RING_EL = 1 << 20;
+
+//! @brief read cursor of the DataProcessor on the raw hit ring
+constexpr size_t RAW_CURSOR_PROCESSING = 0;
+//! @brief read cursor of the StorageManager raw writer on the raw hit ring
+constexpr size_t RAW_CURSOR_STORAGE = 1;
+//! @brief number of consumers sharing the raw hit ring
+constexpr size_t RAW_CURSOR_COUNT = 2;
+
+//! @brief interval of the aggregated buffer overflow log lines
+constexpr std::chrono::milliseconds OVERFLOW_REPORT_INTERVAL{1000};
+
+//! @brief longest time an idle ring consumer sleeps before re-checking for data/stop
+constexpr std::chrono::milliseconds RING_IDLE_WAIT{100};
+
+//! @brief assumed cache line size, used to keep producer/consumer state apart
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+//! @brief number of raw hits per block in binary raw files (~96KB per fixed block),
+// and per index entry of text raw files
+constexpr size_t RAW_BLOCK_RECORDS = 8192;
+
 // File Size (Soft) Limitations 
-//!@brief soft limit on max number of file lines for raw hit data (~5GB)
+//!@brief soft limit on max number of file lines (hits) for raw hit data
+// (~5GB as text, ~2.4GB as binary)
 constexpr size_t MAX_RAW_FILE_LINES = 203272823;
 //!@brief soft limit on max number of file lines for species hit data (~5GB)
 constexpr size_t MAX_SPECIES_FILE_LINES = 147058823;
 
 // -------- / Buffering Settings \ ------------------------------------------------------
+
+
+
+// -------- \ Logging Settings / --------------------------------------------------------
+
+//! @brief write log messages from a background thread instead of the calling thread;
+// queued messages other than FATAL are lost if the process crashes
+constexpr bool LOG_ASYNC = false;
+
+//! @brief longest time a queued log message waits before it is written and flushed
+constexpr std::chrono::milliseconds LOG_FLUSH_INTERVAL{250};
+
+//! @brief number of queued messages (in one thread's queue) that triggers an early flush
+constexpr size_t LOG_FLUSH_RECORDS = 256;
+
+//! @brief capacity of each thread's log message queue; messages beyond are dropped
+// (and counted in the log)
+constexpr size_t LOG_QUEUE_EL = 4096;
+
+// -------- / Logging Settings \ --------------------------------------------------------
+
+
+
+// -------- \ Load Test Settings / ------------------------------------------------------
+
+//! @brief hits pushed through the pipeline per pipelineLoad run; several ring
+// capacities, so that a pipeline slower than the offered rate overflows
+constexpr size_t LOAD_TEST_HITS = 10 * RAW_RING_EL;
+//! @brief default hits per second offered by pipelineLoad
+constexpr double LOAD_TEST_RATE = 1e6;
+//! @brief a run is sustainable if no hit is discarded and the pipeline stores
+// the hits at least this fraction of the offered rate
+constexpr double LOAD_TEST_MIN_THROUGHPUT = 0.95;
+//! @brief interval at which PipelineProbe samples queue depths and progress;
+// also the resolution of its latencies
+constexpr std::chrono::microseconds PROBE_INTERVAL{250};
+
+// -------- / Load Test Settings \ ------------------------------------------------------
@@ -5,10 +5,9 @@
 #include "globals.h"
 
 AcqController::AcqController(
-    std::shared_ptr<SafeBuff<mode::pixel_type>> rhq,
-    std::shared_ptr<SafeBuff<mode::pixel_type>> rh2w,
+    std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
     std::shared_ptr<Logger> log
-): rawHitsBuff(rhq), rawHitsToWriteBuff(rh2w), logger(log) {}
+): rawHitsRing(rhr), rawHitsOverflow("rawHitsRing", rhr->capacity()), logger(log) {}
 
 
 bool AcqController::testConnection(){
@@ -191,35 +190,21 @@ AcqController::pixels_received(const mode::pixel_type *px, size_t count)
         fflush(stdout);
     }
     
-    {
-        std::unique_lock lk(rawHitsBuff->mtx_);
-        rawHitsBuff->addElements(count,px,discarded);        
-    }
-    rawHitsBuff->cv_.notify_one();
-    if(discarded){
-        logger->log(
-            LogLevel::LL_WARNING,
-            std::format("buffer overflow in AcqController::pixels_received \
-- forced to discard {} elements from rawHitsBuff", discarded)
-        );
-    }
+    // discards are aggregated and logged by the OverflowReporter in runAcq
+    const uint64_t fill = rawHitsRing->push(px,count,discarded);
+    rawHitsOverflow.record(fill, discarded);
+}
 
-    bool notifyRaw = false;
-    {
-        std::unique_lock lk(rawHitsToWriteBuff->mtx_);
-        uint64_t total = rawHitsToWriteBuff->addElements(count,px,discarded);
-        notifyRaw = (total > RAW_HIT_NOTIF_INC);
-    }
-    if(notifyRaw){
-        rawHitsToWriteBuff->cv_.notify_one();
-    }
-    if(discarded){
-        logger->log(
-            LogLevel::LL_WARNING,
-            std::format("buffer overflow in AcqController::pixels_received \
-- forced to discard {} elements from rawHitsToWriteBuff", discarded)
-        );
-    }
+void AcqController::setHandlers(katherine::acquisition<mode>& acq){
+    acq.set_frame_started_handler(
+        std::bind_front(&AcqController::frame_started,this)
+    );
+    acq.set_frame_ended_handler(
+        std::bind_front(&AcqController::frame_ended,this)
+    );
+    acq.set_pixels_received_handler(
+        std::bind_front(&AcqController::pixels_received, this)
+    );
 }
 
 //! @todo - potential improvement: return an error code instead of a bool
@@ -237,18 +222,38 @@ bool AcqController::runAcq(){
         500ms,
         10s,
         HIT_TIMEOUT,
-        true
+        capturePath.empty()
     };
+    setHandlers(acq);
 
-    acq.set_frame_started_handler(
-        std::bind_front(&AcqController::frame_started,this)
-    );
-    acq.set_frame_ended_handler(
-        std::bind_front(&AcqController::frame_ended,this)
-    );
-    acq.set_pixels_received_handler(
-        std::bind_front(&AcqController::pixels_received, this)
-    );
+    // when capturing, datagrams are handed over undecoded, written out and
+    // then decoded as usual
+    if(!capturePath.empty()){
+        if(!capture.open(capturePath)){
+            logger->log(
+                LogLevel::LL_ERROR,
+                std::format("cannot create capture file {}, not capturing",capturePath)
+            );
+        }
+        acq.set_data_received_handler([this, &acq](const char* data, size_t count){
+            capture.write(data, count);
+            acq.decode(data, count);
+        });
+    }
+
+    try{
+        acq.set_recv_thread(UDP_RECV_THREAD);
+    } catch(const std::exception& e){
+        logger->log(
+            LogLevel::LL_WARNING,
+            std::format("receiver thread unavailable, receiving inline - {}",e.what())
+        );
+    }
+
+    rawHitsOverflow.reset();
+    OverflowReporter overflowReporter(logger);
+    overflowReporter.add(rawHitsOverflow);
+    overflowReporter.start();
 
     acq.begin(config, katherine::readout_type::data_driven);
 
@@ -256,13 +261,46 @@ bool AcqController::runAcq(){
     acq.read();
     auto toc = steady_clock::now();
 
+    overflowReporter.stop();
+
+    if(capture.isOpen()){
+        const uint64_t capturedBytes = capture.bytes();
+        const uint64_t capturedDatagrams = capture.datagrams();
+        if(capture.close()){
+            logger->log(
+                LogLevel::LL_INFO,
+                std::format("captured {} datagrams ({} bytes) to {}",
+                    capturedDatagrams, capturedBytes, capturePath)
+            );
+        } else{
+            logger->log(
+                LogLevel::LL_ERROR,
+                std::format("capture {} incomplete, writing failed",capturePath)
+            );
+        }
+    }
+
     double duration = duration_cast<milliseconds>(toc - tic).count() / 1000.;
+
+    // largest number of datagrams returned by a single batched recv call
+    const size_t* recvHist = acq.recv_batch_histogram();
+    size_t maxBatch = 0;
+    for(size_t i = 0; i <= KATHERINE_UDP_BATCH_MAX; ++i){
+        if(recvHist[i]) { maxBatch = i; }
+    }
+
     std::stringstream ss;
     ss << "Acquisition completed:" 
     << " [state: " << katherine::str_acq_state(acq.state()) << "]"
     << " [received " << acq.completed_frames() << " complete frames" << "]"
     << " [dropped " << acq.dropped_measurement_data() <<
         " measurement data items" << "]"
+    << " [received " << acq.recv_datagrams() << " datagrams in "
+        << acq.recv_calls() << " recv calls, max batch " << maxBatch
+        << ", " << acq.recv_truncated() << " truncated]"
+    << " [receiver ring peak " << acq.recv_ring_peak() << " datagrams, dropped "
+        << acq.recv_ring_dropped() << " datagrams]"
+    << " " << overflowReporter.summary()
     << " [total hits: " << nHits << "]"
     << " [total duration: " << duration << " s" << "]"
     << " [throughput: " << (nHits / duration) << " hits/s" << "]";
@@ -270,6 +308,53 @@ bool AcqController::runAcq(){
     return true;
 }
 
+bool AcqController::replay(const std::string& path, bool paced){
+    MdCaptureReader reader;
+    if(!reader.open(path)){
+        logger->log(
+            LogLevel::LL_ERROR,
+            std::format("cannot read capture file {}",path)
+        );
+        return false;
+    }
+
+    replay([&reader](MdDatagram& dgram){ return reader.next(dgram); }, paced, path);
+
+    if(reader.truncated()){
+        logger->log(
+            LogLevel::LL_WARNING,
+            std::format("capture {} ends inside a datagram, replayed up to it",path)
+        );
+    }
+    return true;
+}
+
+void AcqController::replay(const MdSource& source, bool paced, const std::string& name){
+    katherine::acquisition<mode> acq{sizeof(mode::pixel_type) * 65536};
+    setHandlers(acq);
+    nHits = 0;
+
+    rawHitsOverflow.reset();
+    OverflowReporter overflowReporter(logger);
+    overflowReporter.add(rawHitsOverflow);
+    overflowReporter.start();
+
+    const ReplayStats stats = replayDatagrams(source, acq, paced);
+
+    overflowReporter.stop();
+
+    std::stringstream ss;
+    ss << "Replay completed:"
+    << " [source: " << name << (paced ? ", paced" : ", unpaced") << "]"
+    << " [state: " << katherine::str_acq_state(acq.state()) << "]"
+    << " [replayed " << stats.datagrams << " datagrams, " << stats.bytes << " bytes]"
+    << " " << overflowReporter.summary()
+    << " [total hits: " << nHits << "]"
+    << " [total duration: " << stats.seconds << " s" << "]"
+    << " [throughput: " << (nHits / stats.seconds) << " hits/s" << "]";
+    logger->log(LogLevel::LL_INFO,ss.str());
+}
+
 katherine::config AcqController::getConfig(){
     return config;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "CalibCache.hpp"
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+//! @brief fields of the cache header, in file order
+struct CacheHeader {
+    char magic[8];
+    uint16_t version;
+    uint16_t doubleSize;
+    uint32_t byteOrder;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t sourceHash;
+    uint64_t payloadHash;
+};
+static_assert(sizeof(CacheHeader) == CALIB_CACHE_HEADER_SIZE);
+
+//! @brief the four constant arrays of calib, in file order
+template <typename Calib> auto payloadArrays(Calib& calib){
+    return std::array{&calib.bat, &calib.ita, &calib.atb, &calib.fac};
+}
+
+constexpr size_t PAYLOAD_SIZE = 4 * CHIP_AREA * sizeof(double);
+
+} // namespace
+
+uint64_t calibHash(const void* data, size_t len, uint64_t hash){
+    const auto* bytes = static_cast<const unsigned char*>(data);
+
+    // four independent lanes of 8-byte words keep the multiplier pipelined
+    uint64_t lanes[4] = {hash, hash ^ 1, hash ^ 2, hash ^ 3};
+    size_t i = 0;
+    for(; i + 32 <= len; i += 32){
+        for(size_t l = 0; l < 4; ++l){
+            uint64_t word;
+            std::memcpy(&word, bytes + i + 8 * l, sizeof(word));
+            lanes[l] = (lanes[l] ^ word) * 0x100000001b3ull;
+        }
+    }
+    if(i){
+        hash = lanes[0];
+        for(size_t l = 1; l < 4; ++l){ hash = (hash ^ lanes[l]) * 0x100000001b3ull; }
+    }
+    for(; i < len; ++i){
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool hashCalibSources(const std::string& calibFolderPath, uint64_t& hash){
+    hash = calibHash(nullptr, 0);
+    std::string contents;
+    for(const auto& name : CALIB_SOURCE_FILES){
+        std::ifstream file(calibFolderPath + "/" + name, std::ios::binary | std::ios::ate);
+        if(!file.is_open()){ return false; }
+        contents.resize(file.tellg());
+        file.seekg(0);
+        if(!file.read(contents.data(), contents.size())){ return false; }
+
+        // length first, so moving bytes between files changes the hash
+        const uint64_t len = contents.size();
+        hash = calibHash(&len, sizeof(len), hash);
+        hash = calibHash(contents.data(), contents.size(), hash);
+    }
+    return true;
+}
+
+bool readCalibCache(const std::string& path, uint64_t sourceHash, EnergyCalib& calib){
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file.is_open()){ return false; }
+    if(static_cast<size_t>(file.tellg()) != CALIB_CACHE_HEADER_SIZE + PAYLOAD_SIZE){ return false; }
+    file.seekg(0);
+
+    std::vector<char> buf(CALIB_CACHE_HEADER_SIZE + PAYLOAD_SIZE);
+    if(!file.read(buf.data(), buf.size())){ return false; }
+
+    CacheHeader hdr;
+    std::memcpy(&hdr, buf.data(), sizeof(hdr));
+    const char* payload = buf.data() + CALIB_CACHE_HEADER_SIZE;
+    if(std::memcmp(hdr.magic, CALIB_CACHE_MAGIC, sizeof(hdr.magic)) != 0 ||
+       hdr.version != CALIB_CACHE_VERSION ||
+       hdr.doubleSize != sizeof(double) ||
+       hdr.byteOrder != CALIB_CACHE_BYTE_ORDER ||
+       hdr.count != CHIP_AREA ||
+       hdr.sourceHash != sourceHash ||
+       hdr.payloadHash != calibHash(payload, PAYLOAD_SIZE)){
+        return false;
+    }
+
+    for(auto* dst : payloadArrays(calib)){
+        dst->resize(CHIP_AREA);
+        std::memcpy(dst->data(), payload, CHIP_AREA * sizeof(double));
+        payload += CHIP_AREA * sizeof(double);
+    }
+    return true;
+}
+
+bool writeCalibCache(const std::string& path, uint64_t sourceHash, const EnergyCalib& calib){
+    std::vector<char> buf(CALIB_CACHE_HEADER_SIZE + PAYLOAD_SIZE);
+    char* payload = buf.data() + CALIB_CACHE_HEADER_SIZE;
+    char* dst = payload;
+    for(const auto* src : payloadArrays(calib)){
+        if(src->size() != CHIP_AREA){ return false; }
+        std::memcpy(dst, src->data(), CHIP_AREA * sizeof(double));
+        dst += CHIP_AREA * sizeof(double);
+    }
+
+    CacheHeader hdr{};
+    std::memcpy(hdr.magic, CALIB_CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = CALIB_CACHE_VERSION;
+    hdr.doubleSize = sizeof(double);
+    hdr.byteOrder = CALIB_CACHE_BYTE_ORDER;
+    hdr.count = CHIP_AREA;
+    hdr.sourceHash = sourceHash;
+    hdr.payloadHash = calibHash(payload, PAYLOAD_SIZE);
+    std::memcpy(buf.data(), &hdr, sizeof(hdr));
+
+    // write next to the target and rename, so readers never see a partial cache
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()){ return false; }
+        if(!file.write(buf.data(), buf.size()) || !file.flush()){
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if(std::rename(tmpPath.c_str(), path.c_str()) != 0){
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
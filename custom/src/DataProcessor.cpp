@@ -4,9 +4,26 @@
 #include <iostream>
 #include <map>
 #include <cmath>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <functional>
+#include <future>
+#include <charconv>
+#include <cctype>
 
-//! @brief lookup of grade using grid sum
-std::unordered_map<uint8_t,uint8_t> gradeLookup =
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+//! @brief grade number assigned to clusters that don't have a valid grade
+constexpr uint8_t outlier = 7;
+
+//! @brief grid sums with a valid grade and their grade
+constexpr std::pair<uint8_t,uint8_t> gradeSums[] =
 {
     {0,0},
 
@@ -29,158 +46,236 @@ std::unordered_map<uint8_t,uint8_t> gradeLookup =
     {18,6}, {22,6}, {50,6}, {54,6}, {80,6},{81,6},{208,6},{209,6},
 };
 
+//! @brief lookup of grade using grid sum, every sum not in gradeSums is an outlier
+constexpr std::array<uint8_t,256> gradeTable = []{
+    std::array<uint8_t,256> table{};
+    table.fill(outlier);
+    for (const auto& [sum, grade] : gradeSums) { table[sum] = grade; }
+    return table;
+}();
+
+static_assert(gradeTable[0] == 0 && gradeTable[21] == 5 && gradeTable[255] == outlier);
+
 //! @brief grid values for x-ray grating algorithm
-uint8_t gridValue[3][3] =
+constexpr uint8_t gridValue[3][3] =
     {
         {32, 64, 128},
         {8,   0,  16},
         {1 ,  2,   4},
     };
 
-DataProcessor::DataProcessor(
-    std::shared_ptr<SafeBuff<mode::pixel_type>> rhq,
-    std::shared_ptr<SafeQueue<SpeciesHit>> shq,
-    std::shared_ptr<Logger> log
-): rawHitsBuff(rhq),speciesHitsQ(shq),logger(log){}
-
-void DataProcessor::launch(){
-    dpThread =  std::jthread([&](std::stop_token stoken){
-        this->processingLoop(stoken);
-    });
-}
-
-DataProcessor::~DataProcessor(){
-    safe_finish(dpThread,rawHitsBuff);
-}
+} // namespace
 
-//! @brief grade number assigned to clusters that don't have a valid grade
-constexpr uint8_t outlier = 7;
 uint8_t getClusterGrade(
     size_t startInd,
     size_t endInd,
     size_t maxEInd,
-    mode::pixel_type* buf
+    const mode::pixel_type* const* buf
 ){
     // too many hits to be an x-ray
     if (endInd - startInd + 1 > 9){return outlier;} 
 
+    const int centerX = buf[maxEInd]->coord.x;
+    const int centerY = buf[maxEInd]->coord.y;
+
+    // offsets are remapped to 0..2; anything else (negatives wrap) is out of bounds
     uint8_t sum = 0;
+    bool outOfBounds = false;
     for (size_t curInd = startInd; curInd <= endInd; ++curInd)
     {
-        int xOffset = buf[curInd].coord.x - buf[maxEInd].coord.x;
-        if (abs(xOffset) > 1) { return outlier; } // hit out of bounds
+        const unsigned col = buf[curInd]->coord.x - centerX + 1;
+        const unsigned row = buf[curInd]->coord.y - centerY + 1;
+        outOfBounds |= (col > 2) | (row > 2);
+        sum += gridValue[std::min(row, 2u)][std::min(col, 2u)];
+    }
 
-        int yOffset = buf[curInd].coord.y - buf[maxEInd].coord.y;
-        if (abs(yOffset) > 1) { return outlier; } // hit out of bounds
+    return outOfBounds ? outlier : gradeTable[sum];
+}
 
-        sum += gridValue[yOffset + 1][xOffset + 1]; // remap indice
+DataProcessor::DataProcessor(
+    std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
+    std::shared_ptr<SafeQueue<SpeciesHit>> shq,
+    std::shared_ptr<Logger> log,
+    size_t clusterThreads
+): rawHitsRing(rhr),speciesHitsQ(shq),logger(log){
+    sortedHits.reserve(MAX_BUFF_EL);
+    if(clusterThreads > 1){
+        clusterPool = std::make_unique<WorkStealingPool>(clusterThreads);
+        shardEngines.resize(clusterPool->size());
     }
+}
 
-    const auto itr = gradeLookup.find(sum);
-    if(itr == gradeLookup.end()) { return outlier; } // bad grade lookup
+void DataProcessor::launch(){
+    std::promise<void> started;
+    std::future<void> running = started.get_future();
+    dpThread = std::jthread([&, started = std::move(started)](std::stop_token stoken) mutable {
+        started.set_value();
+        this->processingLoop(stoken);
+    });
+    running.wait();
+}
 
-    return itr->second;
+DataProcessor::~DataProcessor(){
+    safe_finish(dpThread,rawHitsRing);
 }
 
-void DataProcessor::doProcessing(mode::pixel_type* workBuf, size_t workBufElements)
-{
-    if(!workBufElements) { return; }
-
-    std::sort(
-        workBuf,
-        workBuf+workBufElements,
-        [](const mode::pixel_type& a, const mode::pixel_type& b){ return a.toa < b.toa;}
-    );
-        
+void DataProcessor::doProcessing(
+    const mode::pixel_type* workBuf,
+    size_t workBufElements,
+    bool flush
+){
+    // order hits by time without moving them (workBuf may be shared with other readers)
+    // hits arrive nearly in time order, so this is usually a single linear pass
+    if(workBufElements){
+        sortMetrics.add(adaptiveSortPtrs(
+            workBuf,
+            workBufElements,
+            [](const mode::pixel_type& px){ return px.toa; },
+            sortedHits,
+            sortScratch
+        ));
+    } else {
+        sortedHits.clear();
+    }
+    calibrateBatch(workBuf, workBufElements);
+
+    // classify hits into clusters and process to find species hits
+    if(clusterPool && clusterSharded(flush)) { return; }
     { // scope of lock on speciesHits
         std::unique_lock lk(speciesHitsQ->mtx_);
-
-        // classify hits into "clusters" and process to find species hits
-        // {x}------{x-x-xx-x-x-x}----------{x-x-x}----
-        size_t clustStartInd = 0;
-        size_t maxEInd = 0;
-        auto clustTOAStart = workBuf[0].toa;
-        auto clustTOAMax = clustTOAStart + 5;
-        double maxEnergy = getEnergy(workBuf[0]);
-        double totEnergy = maxEnergy;
-
-        for(size_t  i = 1; i < workBufElements; i++)
-        {
-            const auto curHit = workBuf[i];
-            if(curHit.toa < clustTOAMax){
-                // hit belongs to cluster
-
-                // update cluster max time
-                clustTOAMax = curHit.toa + 5;
-
-                // update cluster energy
-                auto curE = getEnergy(curHit);
-                totEnergy += curE;
-
-                // if applicable, update cluster center
-                if (curE > maxEnergy) 
-                {
-                    maxEInd = i;
-                    maxEnergy = curE;
-                }
-
-            } else{
-                // end of cluster reached, (cur element i does not belong)
-
-                // perform analysis on this cluster and send its data to be saved
-                uint8_t grd = getClusterGrade(clustStartInd,i-1,maxEInd,workBuf);
-                speciesHitsQ->q_.emplace(grd,clustTOAStart,totEnergy);
-
-                // reset cluster stats
-                clustStartInd = i;
-                maxEInd = i;
-                clustTOAStart = curHit.toa;
-                clustTOAMax = clustTOAStart + 5;
-                maxEnergy = getEnergy(workBuf[i]);
-                totEnergy = maxEnergy;
+        clusterEngine.process(
+            sortedHits.data(),
+            sortedHits.size(),
+            flush,
+            [&](const mode::pixel_type* const* hits, size_t count){
+                speciesHitsQ->q_.push(toSpeciesHit(hits,count));
             }
-        }
+        );
+    }
+    speciesHitsQ->cv_.notify_one();
+}
 
-        // after exiting the loop we need to deal process the final cluster
-        uint8_t grd = getClusterGrade(clustStartInd,workBufElements-1,maxEInd,workBuf);
-        speciesHitsQ->q_.emplace(grd,clustTOAStart,totEnergy);
+bool DataProcessor::clusterSharded(bool flush){
+    const size_t n = sortedHits.size();
+    const mode::pixel_type* const* hits = sortedHits.data();
+
+    // a cut between i-1 and i is safe if no cluster can bridge the gap
+    const size_t target = std::max(CLUSTER_SHARD_MIN_HITS, n / (4 * clusterPool->size()));
+    shardCuts.clear();
+    shardCuts.push_back(0);
+    for(size_t i = 1; i < n; ++i){
+        if(i - shardCuts.back() >= target && hits[i]->toa - hits[i-1]->toa >= CLUSTER_TOA_WINDOW){
+            shardCuts.push_back(i);
+        }
+    }
+    shardCuts.push_back(n);
+
+    // first and last shard both go to clusterEngine: need one in between
+    const size_t shards = shardCuts.size() - 1;
+    if(shards < 3) { return false; }
+
+    shardHits.resize(shards);
+    for(auto& out : shardHits){ out.clear(); }
+
+    clusterPool->run(shards - 1, [&](size_t task, size_t worker){
+        auto collect = [&](std::vector<SpeciesHit>& out){
+            return [&](const mode::pixel_type* const* members, size_t count){
+                out.push_back(toSpeciesHit(members,count));
+            };
+        };
+        if(task == 0){
+            // the head completes the clusters carried over from the last batch,
+            // the tail leaves its open clusters for the next one
+            clusterEngine.process(hits, shardCuts[1], true, collect(shardHits[0]));
+            clusterEngine.process(
+                hits + shardCuts[shards-1],
+                n - shardCuts[shards-1],
+                flush,
+                collect(shardHits[shards-1])
+            );
+        } else {
+            shardEngines[worker].process(
+                hits + shardCuts[task],
+                shardCuts[task+1] - shardCuts[task],
+                true,
+                collect(shardHits[task])
+            );
+        }
+    });
 
+    { // scope of lock on speciesHits
+        std::unique_lock lk(speciesHitsQ->mtx_);
+        for(const auto& out : shardHits){
+            for(const auto& sh : out){ speciesHitsQ->q_.push(sh); }
+        }
     }
     speciesHitsQ->cv_.notify_one();
+    return true;
+}
+
+SpeciesHit DataProcessor::toSpeciesHit(const mode::pixel_type* const* hits, size_t count){
+    size_t maxEInd = 0;
+    double maxEnergy = hitEnergy(hits[0]);
+    double totEnergy = maxEnergy;
+    for(size_t i = 1; i < count; ++i){
+        auto curE = hitEnergy(hits[i]);
+        totEnergy += curE;
+
+        // if applicable, update cluster center
+        if (curE > maxEnergy){
+            maxEInd = i;
+            maxEnergy = curE;
+        }
+    }
+
+    uint8_t grd = getClusterGrade(0,count-1,maxEInd,hits);
+    return SpeciesHit(grd,hits[0]->toa,totEnergy);
 }
 
 void DataProcessor::processingLoop(std::stop_token stopToken){
     try{
-        logger->log(LogLevel::LL_INFO,"DataProcessor thread launched");
+        logger->log(
+            LogLevel::LL_INFO,
+            std::format("DataProcessor thread launched (energy kernel: {}, clustering threads: {})",
+                energyKernelName(energyIsa), clusterPool ? clusterPool->size() : 1)
+        );
 
-        mode::pixel_type* workBuf = new mode::pixel_type[MAX_BUFF_EL];
+        const mode::pixel_type* workBuf;
         size_t workBufElements = 0;
 
         // stop only when we've been requested to AND all the data has been processed
         while(!stopToken.stop_requested()){
-
-            { // scope of lock on rawHitsBuff
-                std::unique_lock lk(rawHitsBuff->mtx_);
-                if(!stopToken.stop_requested()){
-                    rawHitsBuff->cv_.wait(lk); 
-                }
-                // we have acquired lock and can do processing
-                if(!rawHitsBuff->numElements_) { continue ;} 
-                workBufElements = rawHitsBuff->copyClear(workBuf,MAX_BUFF_EL);
-            }
-            doProcessing(workBuf,workBufElements);
+            if(!rawHitsRing->waitForData(RAW_CURSOR_PROCESSING,stopToken)) { continue; }
+            workBufElements = rawHitsRing->peek(RAW_CURSOR_PROCESSING,workBuf,MAX_BUFF_EL);
+            doProcessing(workBuf,workBufElements,false);
+            rawHitsRing->release(RAW_CURSOR_PROCESSING,workBufElements);
         }
 
         // In case any data is left after we've been requested to terminate
-        { 
-            std::unique_lock lk(rawHitsBuff->mtx_);
-            workBufElements = rawHitsBuff->copyClear(workBuf,MAX_BUFF_EL);
+        while((workBufElements = rawHitsRing->peek(RAW_CURSOR_PROCESSING,workBuf,MAX_BUFF_EL))){
+            doProcessing(workBuf,workBufElements,false);
+            rawHitsRing->release(RAW_CURSOR_PROCESSING,workBufElements);
         }
-        doProcessing(workBuf,workBufElements);
 
-        logger->log(LogLevel::LL_INFO,"DataProcessor thread terminated");
+        // no more hits will come: emit the cluster still open at the end of the run
+        doProcessing(nullptr,0,true);
 
-        delete[] workBuf;
+        std::string hist;
+        for(auto count : sortMetrics.displacementHist){ hist += std::format(" {}", count); }
+        logger->log(
+            LogLevel::LL_INFO,
+            std::format("DataProcessor sort metrics: [batches: {}] [radix fallbacks: {}] \
+[runs/batch: {:.2f}] [moves/hit: {:.3f}] [max displacement: {}] \
+[batches by max displacement 0,1,2-3,4-7,...:{}]",
+                sortMetrics.batches,
+                sortMetrics.fallbacks,
+                sortMetrics.batches ? double(sortMetrics.runs) / sortMetrics.batches : 0.,
+                sortMetrics.elements ? double(sortMetrics.moves) / sortMetrics.elements : 0.,
+                sortMetrics.maxDisplacement,
+                hist
+            )
+        );
+        logger->log(LogLevel::LL_INFO,"DataProcessor thread terminated");
     }
     catch(const std::exception & e) {
         logger->logException(
@@ -200,17 +295,47 @@ double DataProcessor::getEnergy(const mode::pixel_type& px)
 
     size_t pixel_idx = CHIP_WIDTH*px.coord.y + px.coord.x; 
     uint16_t tot = px.tot;
-    const CalibConstants& lookup{ lookupMatrix[pixel_idx] };
-    const double k = lookup.bat - tot;
-    double energy = lookup.ita * (tot + lookup.atb + std::sqrt(k * k + lookup.fac));
-
-    if (energy > 918) {
-        // Distortion level reached - slightly depends on values used energy response
-        // completely breaks down above 1800 keV.
-        energy = energy - 0.888 * (energy - 918);
+    if(tot < energyLutTotMax){
+        const uint32_t row = energyLutRow[pixel_idx];
+        if(row != NO_LUT_ROW){
+            return energyLut[size_t(row) * energyLutTotMax + tot];
+        }
+    }
+    return calibratedEnergy(calib, pixel_idx, tot);
+}
+
+double DataProcessor::hitEnergy(const mode::pixel_type* px)
+{
+    // hits carried over from an earlier batch are not in batchEnergies
+    if(std::less_equal<>()(batchBase, px) && std::less<>()(px, batchBase + batchEnergies.size())){
+        return batchEnergies[px - batchBase];
+    }
+    return getEnergy(*px);
+}
+
+void DataProcessor::calibrateBatch(const mode::pixel_type* workBuf, size_t workBufElements)
+{
+    batchBase = workBuf;
+    batchEnergies.resize(workBufElements);
+    double* energies = batchEnergies.data();
+
+    // the kernel implements the calibration formula only
+    if(!calibLoaded || energyLutTotMax){
+        for(size_t i = 0; i < workBufElements; ++i){ energies[i] = getEnergy(workBuf[i]); }
+        return;
     }
 
-    return energy;
+    if(!clusterPool || workBufElements < 2 * CLUSTER_SHARD_MIN_HITS){
+        calibrateEnergies(workBuf, workBufElements, calib, energies, energyIsa);
+        return;
+    }
+
+    const size_t chunks = clusterPool->size();
+    clusterPool->run(chunks, [&](size_t task, size_t){
+        const size_t begin = workBufElements * task / chunks;
+        const size_t end = workBufElements * (task + 1) / chunks;
+        calibrateEnergies(workBuf + begin, end - begin, calib, energies + begin, energyIsa);
+    });
 }
 
 // true if successful, false if load failed for any reason
@@ -219,8 +344,10 @@ bool DataProcessor::loadConstants(
     const std::string& path,
     size_t expectedCount)
 {
-    std::ifstream file(path);
-    if(!file.is_open()){
+    const int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0){
+        if(fd >= 0){ close(fd); }
         logger->log(
             LogLevel::LL_FATAL,
             std::format("failed to open calibration file {}",path)
@@ -228,18 +355,44 @@ bool DataProcessor::loadConstants(
         return false;
     }
 
-    std::string line;
-    while(std::getline(file,line))
-    {
+    const size_t size = st.st_size;
+    void* map = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if(map == MAP_FAILED){
+        logger->log(
+            LogLevel::LL_FATAL,
+            std::format("failed to map calibration file {}",path)
+        );
+        return false;
+    }
+
+    // whitespace separated numbers, any line layout
+    dst.reserve(expectedCount);
+    const char* cur = static_cast<const char*>(map);
+    const char* end = cur + size;
+    bool badToken = false;
+    while(true){
+        while(cur != end && std::isspace(static_cast<unsigned char>(*cur))){ ++cur; }
+        if(cur == end){ break; }
+
         double val;
-        std::stringstream ss(line);
-        while (ss >> val)
-        {
-            dst.push_back(val);
+        const auto [next, ec] = std::from_chars(cur, end, val);
+        if(ec != std::errc()){
+            badToken = true;
+            break;
         }
+        dst.push_back(val);
+        cur = next;
     }
+    if(map){ munmap(map, size); }
 
-    file.close();
+    if(badToken){
+        logger->log(
+            LogLevel::LL_ERROR,
+            std::format("invalid number after {} contants in calibarion file {}",dst.size(),path)
+        );
+        return false;
+    }
 
     if(expectedCount != dst.size()){
         logger->log(
@@ -253,25 +406,99 @@ bool DataProcessor::loadConstants(
     return true;
 }
 
-bool DataProcessor::loadEnergyCalib(const std::string& calibFolderPath)
+bool DataProcessor::loadEnergyCalib(
+    const std::string& calibFolderPath,
+    const std::string& cachePath)
 {
     calibLoaded = false;
+    buildEnergyLut(0);
+
+    // a missing source file is reported by parseEnergyCalib
+    uint64_t sourceHash = 0;
+    const bool useCache = !cachePath.empty() && hashCalibSources(calibFolderPath, sourceHash);
+
+    if(useCache && readCalibCache(cachePath, sourceHash, calib)){
+        logger->log(
+            LogLevel::LL_INFO,
+            std::format("energy calibration loaded from cache {}", cachePath)
+        );
+    } else {
+        if(!parseEnergyCalib(calibFolderPath)){ return false; }
+        if(useCache && !writeCalibCache(cachePath, sourceHash, calib)){
+            logger->log(
+                LogLevel::LL_WARNING,
+                std::format("could not write calibration cache {}", cachePath)
+            );
+        }
+    }
+    calibLoaded = true;
+
+    if(ENERGY_LUT_TOT_MAX){
+        const size_t bytes = buildEnergyLut(ENERGY_LUT_TOT_MAX);
+        logger->log(
+            LogLevel::LL_INFO,
+            std::format("energy lookup tables built for tot < {} ({:.1f} MB)",
+                ENERGY_LUT_TOT_MAX, bytes / (1024. * 1024.))
+        );
+    }
+    return true;
+}
+
+bool DataProcessor::parseEnergyCalib(const std::string& calibFolderPath)
+{
     std::vector<double> a,b,c,t;
-    if (!loadConstants(a, calibFolderPath + "/a.txt",CHIP_AREA)){return false;}
-    if (!loadConstants(b, calibFolderPath + "/b.txt",CHIP_AREA)){return false;}
-    if (!loadConstants(c, calibFolderPath + "/c.txt",CHIP_AREA)){return false;}
-    if (!loadConstants(t, calibFolderPath + "/t.txt",CHIP_AREA)){return false;}
+    bool loaded[4];
+    { // the files are independent: parse them concurrently
+        std::jthread loadA([&]{ loaded[0] = loadConstants(a, calibFolderPath + "/a.txt",CHIP_AREA); });
+        std::jthread loadB([&]{ loaded[1] = loadConstants(b, calibFolderPath + "/b.txt",CHIP_AREA); });
+        std::jthread loadC([&]{ loaded[2] = loadConstants(c, calibFolderPath + "/c.txt",CHIP_AREA); });
+        loaded[3] = loadConstants(t, calibFolderPath + "/t.txt",CHIP_AREA);
+    }
+    for (bool ok : loaded) { if (!ok) { return false; } }
 
-    lookupMatrix.resize(CHIP_AREA);
+    calib.bat.resize(CHIP_AREA);
+    calib.ita.resize(CHIP_AREA);
+    calib.atb.resize(CHIP_AREA);
+    calib.fac.resize(CHIP_AREA);
     for (size_t i = 0; i < CHIP_AREA; ++i)
     {
-        CalibConstants& value{ lookupMatrix[i] };
-        value.bat = b[i] + a[i] * t[i];
-        value.ita = 1 / (2 * a[i]);
-        value.atb = a[i] * t[i] - b[i];
-        value.fac = 4 * a[i] * c[i];
+        calib.bat[i] = b[i] + a[i] * t[i];
+        calib.ita[i] = 1 / (2 * a[i]);
+        calib.atb[i] = a[i] * t[i] - b[i];
+        calib.fac[i] = 4 * a[i] * c[i];
     }
-    calibLoaded = true;
     return true;
 }
 
+size_t DataProcessor::buildEnergyLut(uint16_t totMax, const std::vector<uint32_t>& pixels)
+{
+    energyLutTotMax = 0;
+    energyLut.clear();
+    energyLut.shrink_to_fit();
+    energyLutRow.clear();
+    if(!calibLoaded || !totMax){ return 0; }
+
+    energyLutRow.assign(CHIP_AREA, NO_LUT_ROW);
+    uint32_t rows = 0;
+    if(pixels.empty()){
+        for(size_t i = 0; i < CHIP_AREA; ++i){ energyLutRow[i] = rows++; }
+    } else {
+        for(const uint32_t i : pixels){
+            if(i < CHIP_AREA && energyLutRow[i] == NO_LUT_ROW){ energyLutRow[i] = rows++; }
+        }
+    }
+
+    energyLut.resize(size_t(rows) * totMax);
+    for(size_t i = 0; i < CHIP_AREA; ++i){
+        const uint32_t row = energyLutRow[i];
+        if(row == NO_LUT_ROW){ continue; }
+        float* dst = energyLut.data() + size_t(row) * totMax;
+        for(uint16_t tot = 0; tot < totMax; ++tot){
+            dst[tot] = static_cast<float>(calibratedEnergy(calib, i, tot));
+        }
+    }
+    energyLutTotMax = totMax;
+
+    return energyLut.size() * sizeof(float) + energyLutRow.size() * sizeof(uint32_t);
+}
+
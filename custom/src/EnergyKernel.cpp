@@ -0,0 +1,142 @@
+#include "EnergyKernel.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ENERGY_KERNEL_X86 1
+#include <immintrin.h>
+#else
+#define ENERGY_KERNEL_X86 0
+#endif
+
+namespace {
+
+//! @brief pixel index of a hit in the calibration arrays
+inline int pixelIndex(const mode::pixel_type& px){
+    return CHIP_WIDTH * px.coord.y + px.coord.x;
+}
+
+void calibrateScalar(const mode::pixel_type* hits, size_t n, const EnergyCalib& calib, double* energies){
+    for (size_t i = 0; i < n; ++i) {
+        energies[i] = calibratedEnergy(calib, pixelIndex(hits[i]), hits[i].tot);
+    }
+}
+
+#if ENERGY_KERNEL_X86
+
+// the vector kernels evaluate calibratedEnergy in the same operation order and
+// without fused multiply-add, so each lane rounds exactly like the scalar code
+
+// GCC implements the unmasked gathers and the AVX-512 conversion and square
+// root on top of an undefined register and reports it as -Wmaybe-uninitialized;
+// the masked forms with all lanes enabled and a zeroed source do the same work
+
+__attribute__((target("avx2")))
+inline __m256d gather4(const double* base, __m128i idx){
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), base, idx, all, 8);
+}
+
+__attribute__((target("avx512f")))
+inline __m512d gather8(const double* base, __m256i idx){
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, idx, base, 8);
+}
+
+__attribute__((target("avx2")))
+void calibrateAvx2(const mode::pixel_type* hits, size_t n, const EnergyCalib& calib, double* energies){
+    const __m256d limit = _mm256_set1_pd(918.0);
+    const __m256d slope = _mm256_set1_pd(0.888);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const mode::pixel_type* px = hits + i;
+        const __m128i idx = _mm_setr_epi32(
+            pixelIndex(px[0]), pixelIndex(px[1]), pixelIndex(px[2]), pixelIndex(px[3]));
+        const __m256d tot = _mm256_cvtepi32_pd(_mm_setr_epi32(px[0].tot, px[1].tot, px[2].tot, px[3].tot));
+
+        const __m256d bat = gather4(calib.bat.data(), idx);
+        const __m256d ita = gather4(calib.ita.data(), idx);
+        const __m256d atb = gather4(calib.atb.data(), idx);
+        const __m256d fac = gather4(calib.fac.data(), idx);
+
+        const __m256d k = _mm256_sub_pd(bat, tot);
+        const __m256d root = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(k, k), fac));
+        __m256d energy = _mm256_mul_pd(ita, _mm256_add_pd(_mm256_add_pd(tot, atb), root));
+
+        const __m256d distorted = _mm256_sub_pd(energy, _mm256_mul_pd(slope, _mm256_sub_pd(energy, limit)));
+        energy = _mm256_blendv_pd(energy, distorted, _mm256_cmp_pd(energy, limit, _CMP_GT_OQ));
+        _mm256_storeu_pd(energies + i, energy);
+    }
+    calibrateScalar(hits + i, n - i, calib, energies + i);
+}
+
+__attribute__((target("avx512f")))
+void calibrateAvx512(const mode::pixel_type* hits, size_t n, const EnergyCalib& calib, double* energies){
+    const __m512d limit = _mm512_set1_pd(918.0);
+    const __m512d slope = _mm512_set1_pd(0.888);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const mode::pixel_type* px = hits + i;
+        const __m256i idx = _mm256_setr_epi32(
+            pixelIndex(px[0]), pixelIndex(px[1]), pixelIndex(px[2]), pixelIndex(px[3]),
+            pixelIndex(px[4]), pixelIndex(px[5]), pixelIndex(px[6]), pixelIndex(px[7]));
+        const __m512d tot = _mm512_maskz_cvtepi32_pd(0xFF, _mm256_setr_epi32(
+            px[0].tot, px[1].tot, px[2].tot, px[3].tot,
+            px[4].tot, px[5].tot, px[6].tot, px[7].tot));
+
+        const __m512d bat = gather8(calib.bat.data(), idx);
+        const __m512d ita = gather8(calib.ita.data(), idx);
+        const __m512d atb = gather8(calib.atb.data(), idx);
+        const __m512d fac = gather8(calib.fac.data(), idx);
+
+        const __m512d k = _mm512_sub_pd(bat, tot);
+        const __m512d root = _mm512_maskz_sqrt_pd(0xFF, _mm512_add_pd(_mm512_mul_pd(k, k), fac));
+        __m512d energy = _mm512_mul_pd(ita, _mm512_add_pd(_mm512_add_pd(tot, atb), root));
+
+        const __m512d distorted = _mm512_sub_pd(energy, _mm512_mul_pd(slope, _mm512_sub_pd(energy, limit)));
+        energy = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(energy, limit, _CMP_GT_OQ), energy, distorted);
+        _mm512_storeu_pd(energies + i, energy);
+    }
+    calibrateScalar(hits + i, n - i, calib, energies + i);
+}
+
+#endif
+
+} // namespace
+
+EnergyKernelIsa bestEnergyKernel(){
+#if ENERGY_KERNEL_X86
+    static const EnergyKernelIsa best = []{
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) { return EnergyKernelIsa::AVX512; }
+        if (__builtin_cpu_supports("avx2")) { return EnergyKernelIsa::AVX2; }
+        return EnergyKernelIsa::SCALAR;
+    }();
+    return best;
+#else
+    return EnergyKernelIsa::SCALAR;
+#endif
+}
+
+const char* energyKernelName(EnergyKernelIsa isa){
+    switch (isa) {
+        case EnergyKernelIsa::AVX512: return "avx512";
+        case EnergyKernelIsa::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+void calibrateEnergies(
+    const mode::pixel_type* hits,
+    size_t n,
+    const EnergyCalib& calib,
+    double* energies,
+    EnergyKernelIsa isa
+){
+    switch (isa) {
+#if ENERGY_KERNEL_X86
+        case EnergyKernelIsa::AVX512: calibrateAvx512(hits, n, calib, energies); return;
+        case EnergyKernelIsa::AVX2: calibrateAvx2(hits, n, calib, energies); return;
+#endif
+        default: calibrateScalar(hits, n, calib, energies); return;
+    }
+}
@@ -0,0 +1,326 @@
+#include "KatherineEmulator.hpp"
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <random>
+
+namespace {
+
+// command types and measurement data headers of the Katherine protocol
+// (see katherine/c/src/command_interface.h and md.h)
+constexpr uint8_t CMD_ACQUISITION_TIME_LSB = 0x01;
+constexpr uint8_t CMD_ACQUISITION_START = 0x03;
+constexpr uint8_t CMD_SEQ_READOUT_START = 0x05;
+constexpr uint8_t CMD_ACQUISITION_STOP = 0x06;
+constexpr uint8_t CMD_ACQUISITION_TIME_MSB = 0x0A;
+constexpr uint8_t CMD_ECHO_CHIP_ID = 0x0B;
+constexpr uint8_t CMD_GET_ADC_VOLTAGE = 0x0D;
+constexpr uint8_t CMD_SET_ALL_PIXEL_CONFIG = 0x12;
+constexpr uint8_t CMD_GET_HW_TEMPERATURE = 0x15;
+constexpr uint8_t CMD_GET_SENSOR_TEMPERATURE = 0x19;
+constexpr uint8_t CMD_DIGITAL_TEST = 0x20;
+
+constexpr uint64_t MD_PIXEL = 0x4;
+constexpr uint64_t MD_TIME_OFFSET = 0x5;
+constexpr uint64_t MD_NEW_FRAME = 0x7;
+constexpr uint64_t MD_FRAME_FINISHED = 0xC;
+
+//! @brief bit position of the header in a measurement data item
+constexpr unsigned MD_HEADER_SHIFT = 44;
+//! @brief toa bits carried by a pixel MD
+constexpr unsigned MD_TOA_BITS = 14;
+//! @brief 1024 byte datagrams following CMD_SET_ALL_PIXEL_CONFIG
+constexpr size_t PIXEL_CONFIG_DATAGRAMS = 64;
+
+//! @brief reported temperatures (C) and adc voltage (V)
+constexpr float EMU_TEMPERATURE = 30.0f;
+constexpr float EMU_ADC_VOLTAGE = 1.5f;
+
+//! @brief measurement data item with the given header
+inline uint64_t makeMd(uint64_t header, uint64_t payload){
+    return header << MD_HEADER_SHIFT | (payload & ((uint64_t(1) << MD_HEADER_SHIFT) - 1));
+}
+
+//! @brief appends md to buf as KATHERINE_MD_SIZE little endian bytes
+inline void appendMd(std::vector<uint8_t>& buf, uint64_t md){
+    for(size_t i = 0; i < KATHERINE_MD_SIZE; ++i){
+        buf.push_back(static_cast<uint8_t>(md >> (8 * i)));
+    }
+}
+
+//! @brief header of the measurement data item at md
+inline uint8_t mdHeader(const uint8_t* md){
+    return md[5] >> 4;
+}
+
+//! @brief little endian 32 bit argument of a command
+inline uint32_t cmdArg(const uint8_t* cmd){
+    return cmd[0] | cmd[1] << 8 | cmd[2] << 16 | uint32_t(cmd[3]) << 24;
+}
+
+/**
+ * @fn bool encodeChipId(const std::string& id, uint32_t& word)
+ * @brief inverse of the chip id formatting in katherine_get_chip_id
+ * ("J2-W00054" -> column J, row 2, wafer 54)
+ */
+bool encodeChipId(const std::string& id, uint32_t& word){
+    char column;
+    int row, wafer;
+    if(std::sscanf(id.c_str(), "%c%d-W%d", &column, &row, &wafer) != 3 || column < 'A' || column > 'O'){
+        return false;
+    }
+    word = uint32_t(column - 'A' + 1) | uint32_t(row & 0xF) << 4 | uint32_t(wafer & 0xFFF) << 8;
+    return true;
+}
+
+} // namespace
+
+uint64_t encodePixelMd(const mode::pixel_type& px){
+    return makeMd(MD_PIXEL,
+        uint64_t(px.coord.y) << 36 |
+        uint64_t(px.coord.x) << 28 |
+        (px.toa & ((uint64_t(1) << MD_TOA_BITS) - 1)) << 14 |
+        uint64_t(px.tot & 0x3FF) << 4 |
+        (px.hit_count & 0xF));
+}
+
+EmulatorHitSource uniformHitSource(double hitRate, uint64_t seed){
+    const double meanSpacing = hitRate > 0 ? TOA_TICKS_PER_SEC / hitRate : 1.0;
+    return [rng = std::mt19937_64(seed),
+            spacing = std::exponential_distribution<double>(1.0 / meanSpacing),
+            toa = 0.0](mode::pixel_type* hits, size_t max) mutable {
+        for(size_t i = 0; i < max; ++i){
+            const uint64_t r = rng();
+            toa += spacing(rng);
+            hits[i] = mode::pixel_type{};
+            hits[i].coord.x = static_cast<uint8_t>(r);
+            hits[i].coord.y = static_cast<uint8_t>(r >> 8);
+            hits[i].tot = static_cast<uint16_t>(1 + (r >> 16) % 200);
+            hits[i].toa = static_cast<uint64_t>(toa);
+        }
+        return max;
+    };
+}
+
+KatherineEmulator::KatherineEmulator(
+    std::shared_ptr<Logger> log,
+    const EmulatorSettings& set,
+    EmulatorHitSource source
+): logger(log), settings(set), hitSource(source ? std::move(source) : uniformHitSource(set.hitRate)) {}
+
+KatherineEmulator::~KatherineEmulator(){
+    stop();
+}
+
+bool KatherineEmulator::start(){
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(sock < 0){
+        logger->log(LogLevel::LL_ERROR, std::format("emulator socket: {}", std::strerror(errno)));
+        return false;
+    }
+
+    // lib_katherine's own sockets hold the same port on all addresses
+    const int reuse = 1;
+    timeval timeout{0, static_cast<suseconds_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(RING_IDLE_WAIT).count())};
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(settings.controlPort);
+    if(setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+       setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0 ||
+       inet_pton(AF_INET, settings.address.c_str(), &addr.sin_addr) != 1 ||
+       bind(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0){
+        logger->log(
+            LogLevel::LL_ERROR,
+            std::format("emulator cannot listen on {}:{}: {}",
+                settings.address, settings.controlPort, std::strerror(errno))
+        );
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    controlThread = std::jthread([&](std::stop_token stoken){
+        this->controlLoop(stoken);
+    });
+    logger->log(
+        LogLevel::LL_INFO,
+        std::format("emulator listening on {}:{}", settings.address, settings.controlPort)
+    );
+    return true;
+}
+
+void KatherineEmulator::stop(){
+    // the control thread launches streams, so it goes first
+    if(controlThread.joinable()){
+        controlThread.request_stop();
+        controlThread.join();
+    }
+    if(streamThread.joinable()){
+        streamThread.request_stop();
+        streamThread.join();
+    }
+    if(sock >= 0){
+        close(sock);
+        sock = -1;
+    }
+}
+
+bool KatherineEmulator::send(const void* data, size_t len, const sockaddr_in& to){
+    std::lock_guard lk(sendMtx);
+    const ssize_t sent = sendto(sock, data, len, 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+    return sent == static_cast<ssize_t>(len);
+}
+
+void KatherineEmulator::controlLoop(std::stop_token stopToken){
+    std::vector<uint8_t> buf(KATHERINE_UDP_DATAGRAM_MAX);
+    while(!stopToken.stop_requested()){
+        sockaddr_in from{};
+        socklen_t fromLen = sizeof(from);
+        const ssize_t n = recvfrom(sock, buf.data(), buf.size(), 0, reinterpret_cast<sockaddr*>(&from), &fromLen);
+        if(n < 0){ continue; } // timeout, re-check for stop
+
+        if(n == 8){
+            handleCommand(buf.data(), from);
+        } else if(pendingPixelConfig && --pendingPixelConfig == 0){
+            // the pixel configuration is acknowledged once, after its last datagram
+            const uint8_t ack[8] = {};
+            send(ack, sizeof(ack), from);
+        }
+    }
+}
+
+void KatherineEmulator::handleCommand(const uint8_t* cmd, const sockaddr_in& from){
+    uint8_t crd[8] = {};
+    switch(cmd[6]){
+        case CMD_ACQUISITION_TIME_LSB:
+            acqTime = (acqTime & 0xFFFFFFFF00000000ull) | cmdArg(cmd);
+            break;
+        case CMD_ACQUISITION_TIME_MSB:
+            acqTime = (acqTime & 0xFFFFFFFFull) | uint64_t(cmdArg(cmd)) << 32;
+            break;
+        case CMD_SET_ALL_PIXEL_CONFIG:
+            pendingPixelConfig = PIXEL_CONFIG_DATAGRAMS;
+            return;
+        case CMD_ACQUISITION_START:
+            if(streamThread.joinable()){
+                streamThread.request_stop();
+                streamThread.join();
+            }
+            dataAddr = from;
+            dataAddr.sin_port = htons(settings.dataPort);
+            streamThread = std::jthread([&](std::stop_token stoken){
+                this->streamLoop(stoken);
+            });
+            return; // not acknowledged
+        case CMD_SEQ_READOUT_START:
+            return; // not acknowledged
+        case CMD_ACQUISITION_STOP:
+            streamThread.request_stop();
+            return; // not acknowledged
+        case CMD_ECHO_CHIP_ID: {
+            uint32_t word = 0;
+            if(!encodeChipId(settings.chipId, word)){
+                logger->log(LogLevel::LL_ERROR, std::format("emulator cannot encode chip id {}", settings.chipId));
+            }
+            std::memcpy(crd, &word, sizeof(word));
+            break;
+        }
+        case CMD_GET_HW_TEMPERATURE:
+        case CMD_GET_SENSOR_TEMPERATURE:
+            std::memcpy(crd, &EMU_TEMPERATURE, sizeof(EMU_TEMPERATURE));
+            break;
+        case CMD_GET_ADC_VOLTAGE:
+            std::memcpy(crd, &EMU_ADC_VOLTAGE, sizeof(EMU_ADC_VOLTAGE));
+            break;
+        case CMD_DIGITAL_TEST:
+            crd[0] = 64; // passed
+            break;
+        default:
+            break;
+    }
+    send(crd, sizeof(crd), from);
+}
+
+void KatherineEmulator::streamLoop(std::stop_token stopToken){
+    using namespace std::chrono;
+
+    acquisitions_.fetch_add(1, std::memory_order_relaxed);
+    sentHits_.store(0, std::memory_order_relaxed);
+
+    std::vector<uint8_t> dgram;
+    dgram.reserve(2 * settings.mdsPerDatagram * KATHERINE_MD_SIZE);
+    appendMd(dgram, makeMd(MD_NEW_FRAME, 0));
+    send(dgram.data(), dgram.size(), dataAddr);
+
+    size_t sent = 0;
+    if(!settings.recordingPath.empty()){
+        std::ifstream file(settings.recordingPath, std::ios::binary);
+        if(!file.is_open()){
+            logger->log(LogLevel::LL_ERROR, std::format("emulator cannot read {}", settings.recordingPath));
+        }
+        const std::vector<uint8_t> mds((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        sent = streamRecording(stopToken, mds);
+    } else {
+        // acquisition time is set in 10ns units
+        const auto start = steady_clock::now();
+        const auto end = start + nanoseconds(acqTime * 10);
+        std::vector<mode::pixel_type> hits(settings.mdsPerDatagram);
+        uint64_t offset = UINT64_MAX;
+        while(!stopToken.stop_requested() && steady_clock::now() < end){
+            const size_t n = hitSource(hits.data(), hits.size());
+            if(!n){ break; }
+
+            dgram.clear();
+            for(size_t i = 0; i < n; ++i){
+                if(hits[i].toa >> MD_TOA_BITS != offset){
+                    offset = hits[i].toa >> MD_TOA_BITS;
+                    appendMd(dgram, makeMd(MD_TIME_OFFSET, offset & 0xFFFFFFFF));
+                }
+                appendMd(dgram, encodePixelMd(hits[i]));
+            }
+
+            if(settings.hitRate > 0){
+                std::this_thread::sleep_until(start + duration_cast<nanoseconds>(duration<double>(sent / settings.hitRate)));
+            }
+            if(!send(dgram.data(), dgram.size(), dataAddr)){
+                logger->log(LogLevel::LL_WARNING, std::format("emulator data send failed: {}", std::strerror(errno)));
+            }
+            sent += n;
+            sentHits_.store(sent, std::memory_order_relaxed);
+        }
+    }
+
+    dgram.clear();
+    appendMd(dgram, makeMd(MD_FRAME_FINISHED, sent));
+    send(dgram.data(), dgram.size(), dataAddr);
+    logger->log(LogLevel::LL_INFO, std::format("emulator finished frame, sent {} hits", sent));
+}
+
+size_t KatherineEmulator::streamRecording(std::stop_token stopToken, const std::vector<uint8_t>& mds){
+    using namespace std::chrono;
+
+    const size_t chunk = settings.mdsPerDatagram * KATHERINE_MD_SIZE;
+    const auto start = steady_clock::now();
+    size_t pixels = 0;
+    for(size_t pos = 0; pos + KATHERINE_MD_SIZE <= mds.size() && !stopToken.stop_requested(); pos += chunk){
+        const size_t len = std::min(chunk, mds.size() - pos) / KATHERINE_MD_SIZE * KATHERINE_MD_SIZE;
+        if(settings.hitRate > 0){
+            std::this_thread::sleep_until(start + duration_cast<nanoseconds>(duration<double>(pixels / settings.hitRate)));
+        }
+        send(mds.data() + pos, len, dataAddr);
+        for(size_t i = 0; i < len; i += KATHERINE_MD_SIZE){
+            pixels += mdHeader(mds.data() + pos + i) == MD_PIXEL;
+        }
+        sentHits_.store(pixels, std::memory_order_relaxed);
+    }
+    return pixels;
+}
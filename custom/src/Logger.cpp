@@ -4,36 +4,180 @@
 
 #include <time.h>
 
-Logger::Logger(const std::string& filename):logFile_(std::ofstream(filename)){
+namespace {
+
+//! @brief source of Logger::id_
+std::atomic<uint64_t> nextLoggerId = 1;
+
+/**
+ * @struct QueueCache
+ * @brief the calling thread's queue for the logger it used last, so the
+ * common case needs no lookup
+ */
+struct QueueCache {
+    uint64_t loggerId = 0;
+    void* queue = nullptr;
+};
+
+thread_local QueueCache queueCache;
+
+} // namespace
+
+Logger::Logger(const std::string& filename, bool async):
+    logFile_(std::ofstream(filename)), async_(async), id_(nextLoggerId++){
     if (!logFile_.is_open()) {
         throw std::runtime_error("Could not open log file");
     }
 
     logFile_ << "# format is: timestamp [LogLevel] \"message\"" <<  std::endl;
+
+    if(async_){
+        writerThread_ = std::jthread([&](std::stop_token stoken){
+            this->writerLoop(stoken);
+        });
+    }
     log(LogLevel::LL_INFO, "logfile created");
 }
 
+Logger::~Logger(){
+    if(writerThread_.joinable()){
+        writerThread_.request_stop();
+        {
+            std::lock_guard lk(wake_.mtx_);
+            wake_.cv_.notify_all();
+        }
+        writerThread_.join();
+    }
+}
+
 void Logger::log(LogLevel level, const std::string& msg){
+    if(async_){
+        enqueue(level, std::string(msg));
+        return;
+    }
+
     std::unique_lock lk(mtx_);
-    std::string entry = std::format("{} {} \"{}\"",
-        time(NULL),
-        getLogLevelMsg(level),
-        msg
-    );
-    logFile_ << entry << std::endl;
+    writeEntry(time(NULL), level, msg);
     logFile_.flush();
 }
 
 void Logger::logException(const LogLevel level, const std::string& msg, const std::exception& e){
-    std::unique_lock lk(mtx_);
-    std::string entry = std::format("{} {} \"{}: type-[{}] what-[{}]\"",
-        time(NULL),
-        getLogLevelMsg(level),
+    std::string text = std::format("{}: type-[{}] what-[{}]",
         msg,
         typeid(e).name(),
         e.what()
     );
-    logFile_ << entry << std::endl;
+    if(async_){
+        enqueue(level, std::move(text));
+        return;
+    }
+
+    std::unique_lock lk(mtx_);
+    writeEntry(time(NULL), level, text);
+    logFile_.flush();
+}
+
+void Logger::writeEntry(time_t time, const LogLevel level, const std::string& msg){
+    logFile_ << std::format("{} {} \"{}\"\n",
+        time,
+        getLogLevelMsg(level),
+        msg
+    );
+}
+
+SpscRing<Logger::Record>& Logger::threadQueue(){
+    if(queueCache.loggerId == id_){
+        return *static_cast<SpscRing<Record>*>(queueCache.queue);
+    }
+
+    std::lock_guard lk(queuesMtx_);
+    const auto self = std::this_thread::get_id();
+    SpscRing<Record>* queue = nullptr;
+    for(auto& [tid, q] : queues_){
+        if(tid == self){ queue = q.get(); }
+    }
+    if(!queue){
+        queues_.emplace_back(self, std::make_unique<SpscRing<Record>>(LOG_QUEUE_EL));
+        queue = queues_.back().second.get();
+    }
+    queueCache = {id_, queue};
+    return *queue;
+}
+
+void Logger::enqueue(const LogLevel level, std::string&& msg){
+    Record rec{time(NULL), level, std::move(msg)};
+
+    if(level == LogLevel::LL_FATAL){
+        // keep ordering: everything queued so far goes out first
+        std::unique_lock lk(mtx_);
+        drainQueues();
+        writeEntry(rec.time, rec.level, rec.msg);
+        logFile_.flush();
+        return;
+    }
+
+    size_t discarded;
+    const size_t fill = threadQueue().push(&rec, 1, discarded);
+    if(discarded){
+        dropped_.fetch_add(discarded, std::memory_order_relaxed);
+    }
+
+    if(fill >= LOG_FLUSH_RECORDS && writerIdle_.load(std::memory_order_seq_cst)){
+        std::lock_guard lk(wake_.mtx_);
+        wakeRequested_ = true;
+        wake_.cv_.notify_one();
+    }
+}
+
+bool Logger::drainQueues(){
+    std::vector<SpscRing<Record>*> queues;
+    {
+        std::lock_guard lk(queuesMtx_);
+        for(auto& [tid, q] : queues_){ queues.push_back(q.get()); }
+    }
+
+    bool wrote = false;
+    for(auto* queue : queues){
+        const Record* recs;
+        size_t n;
+        while((n = queue->peek(recs, LOG_QUEUE_EL))){
+            for(size_t i = 0; i < n; ++i){
+                writeEntry(recs[i].time, recs[i].level, recs[i].msg);
+            }
+            queue->release(n);
+            wrote = true;
+        }
+    }
+
+    const size_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+    if(dropped){
+        writeEntry(time(NULL), LogLevel::LL_WARNING,
+            std::format("log queue full - dropped {} messages", dropped));
+        wrote = true;
+    }
+    return wrote;
+}
+
+void Logger::writerLoop(std::stop_token stopToken){
+    while(!stopToken.stop_requested()){
+        {
+            std::unique_lock lk(wake_.mtx_);
+            writerIdle_.store(true, std::memory_order_seq_cst);
+            wake_.cv_.wait_for(lk, LOG_FLUSH_INTERVAL, [&]{
+                return stopToken.stop_requested() || wakeRequested_;
+            });
+            wakeRequested_ = false;
+            writerIdle_.store(false, std::memory_order_relaxed);
+        }
+
+        std::unique_lock lk(mtx_);
+        if(drainQueues()){
+            logFile_.flush();
+        }
+    }
+
+    std::unique_lock lk(mtx_);
+    drainQueues();
     logFile_.flush();
 }
 
@@ -44,4 +188,4 @@ std::string Logger::getLogLevelMsg(const LogLevel levelEnum){
         return "[UNKNOWN]";
     }
     return itr->second;
-}
\ No newline at end of file
+}
@@ -0,0 +1,194 @@
+#include "MdCapture.hpp"
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// capture header field offsets; fields are encoded little endian explicitly,
+// as captures are replayed on other machines than the one that recorded them
+constexpr size_t HDR_VERSION = 8;
+constexpr size_t HDR_MD_SIZE = 10;
+constexpr size_t HDR_START_NS = 16;
+
+//! @brief writes the low bytes of v to dst, little endian
+void putLE(uint8_t* dst, uint64_t v, size_t bytes){
+    for(size_t i = 0; i < bytes; ++i){ dst[i] = static_cast<uint8_t>(v >> (8 * i)); }
+}
+
+//! @brief reads bytes little endian bytes at src
+uint64_t getLE(const uint8_t* src, size_t bytes){
+    uint64_t v = 0;
+    for(size_t i = 0; i < bytes; ++i){ v |= uint64_t(src[i]) << (8 * i); }
+    return v;
+}
+
+//! @brief appends v as a LEB128 varint
+void putVarint(std::vector<uint8_t>& out, uint64_t v){
+    while(v >= 0x80){
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+//! @brief reads a LEB128 varint at pos, false if it runs past len
+bool getVarint(const char* data, size_t len, size_t& pos, uint64_t& v){
+    v = 0;
+    for(unsigned shift = 0; pos < len && shift < 64; shift += 7){
+        const uint8_t byte = static_cast<uint8_t>(data[pos++]);
+        v |= uint64_t(byte & 0x7F) << shift;
+        if(!(byte & 0x80)){ return true; }
+    }
+    return false;
+}
+
+} // namespace
+
+MdCaptureWriter::~MdCaptureWriter(){
+    close();
+}
+
+bool MdCaptureWriter::open(const std::string& path){
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open()){ return false; }
+
+    uint8_t hdr[MD_CAPTURE_HEADER_SIZE] = {};
+    std::memcpy(hdr, MD_CAPTURE_MAGIC, sizeof(MD_CAPTURE_MAGIC));
+    putLE(hdr + HDR_VERSION, MD_CAPTURE_VERSION, 2);
+    putLE(hdr + HDR_MD_SIZE, KATHERINE_MD_SIZE, 2);
+    putLE(hdr + HDR_START_NS, std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count(), 8);
+    file.write(reinterpret_cast<const char*>(hdr), sizeof(hdr));
+
+    buf.clear();
+    buf.reserve(MD_CAPTURE_BUFFER_BYTES + KATHERINE_UDP_DATAGRAM_MAX);
+    last = std::chrono::steady_clock::now();
+    datagrams_ = 0;
+    bytes_ = 0;
+    failed = !file;
+    return !failed;
+}
+
+void MdCaptureWriter::write(const char* data, size_t len, std::chrono::steady_clock::time_point received){
+    if(!file.is_open()){ return; }
+
+    const auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(received - last).count();
+    last = received;
+    putVarint(buf, delta > 0 ? delta : 0);
+    putVarint(buf, len);
+    buf.insert(buf.end(), data, data + len);
+    ++datagrams_;
+    bytes_ += len;
+
+    if(buf.size() >= MD_CAPTURE_BUFFER_BYTES){
+        failed |= !file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+        buf.clear();
+    }
+}
+
+bool MdCaptureWriter::close(){
+    if(!file.is_open()){ return !failed; }
+    failed |= !file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+    buf.clear();
+    file.close();
+    failed |= file.fail();
+    return !failed;
+}
+
+MdCaptureReader::~MdCaptureReader(){
+    unmap();
+}
+
+void MdCaptureReader::unmap(){
+    if(contents){
+        munmap(const_cast<char*>(contents), size);
+        contents = nullptr;
+        size = 0;
+    }
+}
+
+bool MdCaptureReader::open(const std::string& path){
+    unmap();
+
+    // a flight capture runs to tens of GB, so it is mapped rather than read in
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < MD_CAPTURE_HEADER_SIZE){
+        if(fd >= 0){ ::close(fd); }
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED){ return false; }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    contents = static_cast<const char*>(map);
+    size = st.st_size;
+
+    const uint8_t* hdr = reinterpret_cast<const uint8_t*>(contents);
+    if(std::memcmp(hdr, MD_CAPTURE_MAGIC, sizeof(MD_CAPTURE_MAGIC)) != 0 ||
+       getLE(hdr + HDR_VERSION, 2) != MD_CAPTURE_VERSION ||
+       getLE(hdr + HDR_MD_SIZE, 2) != KATHERINE_MD_SIZE){
+        unmap();
+        return false;
+    }
+    startNs_ = getLE(hdr + HDR_START_NS, 8);
+    rewind();
+    return true;
+}
+
+bool MdCaptureReader::next(MdDatagram& dgram){
+    if(pos >= size){ return false; }
+
+    size_t p = pos;
+    uint64_t delta, len;
+    if(!getVarint(contents, size, p, delta) ||
+       !getVarint(contents, size, p, len) ||
+       len > size - p){
+        truncated_ = true;
+        return false;
+    }
+
+    offsetNs += delta;
+    dgram = {offsetNs, contents + p, static_cast<size_t>(len)};
+    pos = p + len;
+    return true;
+}
+
+void MdCaptureReader::rewind(){
+    pos = MD_CAPTURE_HEADER_SIZE;
+    offsetNs = 0;
+    truncated_ = false;
+}
+
+ReplayStats replayDatagrams(const MdSource& next, katherine::base_acquisition& acq, bool paced){
+    using namespace std::chrono;
+
+    ReplayStats stats;
+    acq.replay_begin();
+
+    const auto start = steady_clock::now();
+    MdDatagram dgram;
+    while(next(dgram)){
+        if(paced){
+            std::this_thread::sleep_until(start + nanoseconds(dgram.offsetNs));
+        }
+        acq.decode(dgram.data, dgram.len);
+        ++stats.datagrams;
+        stats.bytes += dgram.len;
+    }
+    acq.replay_end();
+
+    stats.seconds = duration<double>(steady_clock::now() - start).count();
+    return stats;
+}
+
+ReplayStats replayCapture(MdCaptureReader& reader, katherine::base_acquisition& acq, bool paced){
+    reader.rewind();
+    return replayDatagrams(
+        [&reader](MdDatagram& dgram){ return reader.next(dgram); }, acq, paced);
+}
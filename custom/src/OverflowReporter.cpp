@@ -0,0 +1,119 @@
+#include "OverflowReporter.hpp"
+#include <algorithm>
+#include <format>
+
+namespace {
+
+//! @brief seconds between two steady clock timestamps in ns
+double secondsBetween(int64_t fromNs, int64_t toNs){
+    return (toNs > fromNs ? toNs - fromNs : 0) / 1e9;
+}
+
+} // namespace
+
+OverflowReporter::OverflowReporter(
+    std::shared_ptr<Logger> log,
+    std::chrono::milliseconds interv
+): logger(log), interval(interv) {}
+
+OverflowReporter::~OverflowReporter(){
+    stop();
+}
+
+void OverflowReporter::add(OverflowCounter& counter){
+    tracked.push_back({&counter});
+    tracked.back().lastTotal = counter.discarded();
+}
+
+void OverflowReporter::start(){
+    reportThread = std::jthread([&](std::stop_token stoken){
+        while(!stoken.stop_requested()){
+            {
+                std::unique_lock lk(wake.mtx_);
+                wake.cv_.wait_for(lk, interval, [&]{ return stoken.stop_requested(); });
+            }
+            report();
+        }
+    });
+}
+
+void OverflowReporter::stop(){
+    if(!reportThread.joinable()){ return; }
+    reportThread.request_stop();
+    {
+        std::lock_guard lk(wake.mtx_);
+        wake.cv_.notify_all();
+    }
+    reportThread.join();
+
+    report();
+    for(auto& t : tracked){
+        if(t.inEpisode){ closeEpisode(t); }
+    }
+}
+
+void OverflowReporter::report(){
+    for(auto& t : tracked){
+        OverflowCounter& c = *t.counter;
+        const uint64_t total = c.discarded();
+        const uint64_t delta = total - t.lastTotal;
+        const uint64_t intervalPeak = c.intervalPeakFill_.exchange(0, std::memory_order_relaxed);
+        t.lastTotal = total;
+
+        if(!delta){
+            if(t.inEpisode){ closeEpisode(t); }
+            continue;
+        }
+
+        if(!t.inEpisode){
+            t.inEpisode = true;
+            t.episodeBase = total - delta;
+            t.episodePeak = 0;
+            ++t.episodes;
+        }
+        t.episodePeak = std::max(t.episodePeak, intervalPeak);
+
+        logger->log(
+            LogLevel::LL_WARNING,
+            std::format("{} overflow: discarded {} elements in last {} ms (peak fill {}/{}); \
+episode so far: {} elements over {:.3f} s",
+                c.name(), delta, interval.count(), intervalPeak, c.capacity(),
+                total - t.episodeBase,
+                secondsBetween(
+                    c.episodeStartNs_.load(std::memory_order_relaxed),
+                    c.lastDiscardNs_.load(std::memory_order_relaxed)
+                )
+            )
+        );
+    }
+}
+
+void OverflowReporter::closeEpisode(Tracked& t){
+    OverflowCounter& c = *t.counter;
+    logger->log(
+        LogLevel::LL_WARNING,
+        std::format("{} overflow episode ended: discarded {} elements over {:.3f} s, \
+peak fill {}/{}",
+            c.name(), t.lastTotal - t.episodeBase,
+            secondsBetween(
+                c.episodeStartNs_.load(std::memory_order_relaxed),
+                c.lastDiscardNs_.load(std::memory_order_relaxed)
+            ),
+            t.episodePeak, c.capacity()
+        )
+    );
+    c.episodeStartNs_.store(0, std::memory_order_relaxed);
+    t.inEpisode = false;
+}
+
+std::string OverflowReporter::summary() const{
+    std::string out;
+    for(const auto& t : tracked){
+        const OverflowCounter& c = *t.counter;
+        if(!out.empty()){ out += " "; }
+        out += std::format("[{}: discarded {} elements in {} pushes, {} overflow episodes, \
+peak fill {}/{}]",
+            c.name(), c.discarded(), c.events(), t.episodes, c.peakFill(), c.capacity());
+    }
+    return out;
+}
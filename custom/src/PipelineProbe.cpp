@@ -0,0 +1,137 @@
+#include "PipelineProbe.hpp"
+#include <algorithm>
+#include <mutex>
+
+double PipelineReport::percentile(PipelineStage stage, double p) const {
+    const auto& lat = latencies[static_cast<size_t>(stage)];
+    if(lat.empty()){ return 0; }
+    const size_t i = static_cast<size_t>(p * lat.size());
+    return lat[std::min(i, lat.size() - 1)];
+}
+
+PipelineProbe::PipelineProbe(
+    std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
+    std::shared_ptr<SafeQueue<SpeciesHit>> shq,
+    const OverflowCounter& overflow,
+    std::chrono::microseconds interv
+): rawHitsRing(rhr), speciesHitsQ(shq), ringOverflow(overflow), interval(interv) {}
+
+PipelineProbe::~PipelineProbe(){
+    stop();
+}
+
+void PipelineProbe::fed(uint64_t total){
+    int64_t notYet = 0;
+    if(!firstFedNs_.load(std::memory_order_relaxed)){
+        firstFedNs_.compare_exchange_strong(notYet,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count(),
+            std::memory_order_relaxed);
+    }
+    fed_.store(total, std::memory_order_release);
+}
+
+uint64_t PipelineProbe::handled(PipelineStage stage, uint64_t discarded) const {
+    switch(stage){
+        case PipelineStage::RING:
+            return rawHitsRing->pushed() + discarded;
+        case PipelineStage::PROCESSED:
+            return rawHitsRing->released(RAW_CURSOR_PROCESSING) + discarded;
+        case PipelineStage::STORED:
+            return rawHitsRing->released(RAW_CURSOR_STORAGE) + discarded;
+    }
+    return 0;
+}
+
+bool PipelineProbe::drained() const {
+    const uint64_t fed = fed_.load(std::memory_order_acquire);
+    const uint64_t discarded = ringOverflow.discarded();
+    for(size_t s = 0; s < PIPELINE_STAGES; ++s){
+        if(handled(static_cast<PipelineStage>(s), discarded) < fed){ return false; }
+    }
+    return true;
+}
+
+void PipelineProbe::start(){
+    probeThread = std::jthread([&](std::stop_token stoken){
+        while(!stoken.stop_requested()){
+            {
+                std::unique_lock lk(wake.mtx_);
+                wake.cv_.wait_for(lk, interval, [&]{ return stoken.stop_requested(); });
+            }
+            sample();
+        }
+    });
+}
+
+void PipelineProbe::sample(){
+    const auto now = std::chrono::steady_clock::now();
+    const uint64_t fed = fed_.load(std::memory_order_acquire);
+    const uint64_t discarded = ringOverflow.discarded();
+
+    if(fed > lastMark){
+        for(auto& marks : pending){ marks.push_back({fed, now}); }
+        lastMark = fed;
+    }
+
+    bool caughtUpNow = true;
+    for(size_t s = 0; s < PIPELINE_STAGES; ++s){
+        const uint64_t done = handled(static_cast<PipelineStage>(s), discarded);
+        auto& marks = pending[s];
+        while(!marks.empty() && marks.front().fed <= done){
+            report_.latencies[s].push_back(
+                std::chrono::duration<double>(now - marks.front().time).count());
+            marks.pop_front();
+        }
+        report_.handled[s] = done;
+        caughtUpNow = caughtUpNow && done >= fed;
+    }
+
+    if(fed && caughtUpNow && fed != caughtUpFed){
+        caughtUp = now;
+        caughtUpFed = fed;
+    }
+
+    const uint64_t processingDepth = rawHitsRing->size(RAW_CURSOR_PROCESSING);
+    const uint64_t storageDepth = rawHitsRing->size(RAW_CURSOR_STORAGE);
+    uint64_t speciesDepth;
+    {
+        std::lock_guard lk(speciesHitsQ->mtx_);
+        speciesDepth = speciesHitsQ->q_.size();
+    }
+    processingSum += processingDepth;
+    storageSum += storageDepth;
+    speciesSum += speciesDepth;
+    ++samples;
+    report_.processingDepth.peak = std::max(report_.processingDepth.peak, processingDepth);
+    report_.storageDepth.peak = std::max(report_.storageDepth.peak, storageDepth);
+    report_.speciesDepth.peak = std::max(report_.speciesDepth.peak, speciesDepth);
+
+    report_.fed = fed;
+    report_.discarded = discarded;
+}
+
+PipelineReport PipelineProbe::stop(){
+    if(probeThread.joinable()){
+        probeThread.request_stop();
+        {
+            std::lock_guard lk(wake.mtx_);
+            wake.cv_.notify_all();
+        }
+        probeThread.join();
+        sample();
+
+        for(auto& lat : report_.latencies){ std::sort(lat.begin(), lat.end()); }
+        if(samples){
+            report_.processingDepth.mean = processingSum / samples;
+            report_.storageDepth.mean = storageSum / samples;
+            report_.speciesDepth.mean = speciesSum / samples;
+        }
+        const int64_t firstNs = firstFedNs_.load(std::memory_order_relaxed);
+        if(firstNs && caughtUp.time_since_epoch().count()){
+            report_.seconds = std::max(0.,
+                std::chrono::duration<double>(caughtUp.time_since_epoch()).count() - firstNs / 1e9);
+        }
+    }
+    return report_;
+}
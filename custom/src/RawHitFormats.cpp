@@ -0,0 +1,776 @@
+#include "RawHitFormats.hpp"
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <cstring>
+#include <format>
+#include <regex>
+#include <stdexcept>
+
+namespace {
+
+// explicit little-endian (de)serialization, independent of host byte order
+
+void putLE16(uint8_t* dst, uint16_t v){
+    dst[0] = static_cast<uint8_t>(v);
+    dst[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void putLE32(uint8_t* dst, uint32_t v){
+    for(size_t i = 0; i < 4; ++i){ dst[i] = static_cast<uint8_t>(v >> (8*i)); }
+}
+
+void putLE64(uint8_t* dst, uint64_t v){
+    for(size_t i = 0; i < 8; ++i){ dst[i] = static_cast<uint8_t>(v >> (8*i)); }
+}
+
+uint16_t getLE16(const uint8_t* src){
+    return static_cast<uint16_t>(src[0] | (src[1] << 8));
+}
+
+uint32_t getLE32(const uint8_t* src){
+    uint32_t v = 0;
+    for(size_t i = 0; i < 4; ++i){ v |= static_cast<uint32_t>(src[i]) << (8*i); }
+    return v;
+}
+
+uint64_t getLE64(const uint8_t* src){
+    uint64_t v = 0;
+    for(size_t i = 0; i < 8; ++i){ v |= static_cast<uint64_t>(src[i]) << (8*i); }
+    return v;
+}
+
+//! @brief writes the header of a sidecar index
+void writeIdxHeader(std::ofstream& idxFile){
+    uint8_t idxHeader[RAW_IDX_HEADER_SIZE] = {};
+    std::memcpy(idxHeader, RAW_IDX_MAGIC, sizeof(RAW_IDX_MAGIC));
+    putLE16(idxHeader + 8, RAW_IDX_VERSION);
+    putLE32(idxHeader + 12, static_cast<uint32_t>(RAW_BLOCK_RECORDS));
+    idxFile.write(reinterpret_cast<const char*>(idxHeader), sizeof(idxHeader));
+}
+
+//! @brief appends one entry to a sidecar index
+void writeIdxEntry(std::ofstream& idxFile, const RawIndexEntry& e){
+    uint8_t entry[RAW_IDX_ENTRY_SIZE] = {};
+    putLE64(entry, e.offset);
+    putLE32(entry + 8, e.records);
+    putLE64(entry + 16, e.minToa);
+    putLE64(entry + 24, e.maxToa);
+    idxFile.write(reinterpret_cast<const char*>(entry), sizeof(entry));
+}
+
+//! @brief true if path names a text raw file (by its extension)
+bool isTextRawFile(const std::string& path){
+    return std::filesystem::path(path).extension() == RAW_TEXT_EXT;
+}
+
+//! @brief writes v in decimal at dst (room for 20 digits), returns the end
+char* putDecimal(char* dst, uint64_t v){
+    return std::to_chars(dst, dst + 20, v).ptr;
+}
+
+//! @brief parses a "x y toa tot" line, false if it is anything else
+bool parseTextHit(const std::string& line, mode::pixel_type& hit){
+    const char* cur = line.data();
+    const char* end = cur + line.size();
+    if(cur != end && end[-1] == '\r'){ --end; }
+
+    uint64_t values[4];
+    for(auto& v : values){
+        while(cur != end && *cur == ' '){ ++cur; }
+        const auto [next, ec] = std::from_chars(cur, end, v);
+        if(ec != std::errc()){ return false; }
+        cur = next;
+    }
+    if(cur != end || values[0] > UINT8_MAX || values[1] > UINT8_MAX || values[3] > UINT16_MAX){
+        return false;
+    }
+    hit = {};
+    hit.coord.x = static_cast<uint8_t>(values[0]);
+    hit.coord.y = static_cast<uint8_t>(values[1]);
+    hit.toa = values[2];
+    hit.tot = static_cast<uint16_t>(values[3]);
+    return true;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v){
+    while(v >= 0x80){
+        out.push_back(static_cast<uint8_t>(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+size_t varintSize(uint64_t v){
+    size_t n = 1;
+    while(v >= 0x80){ v >>= 7; ++n; }
+    return n;
+}
+
+uint64_t zigzag(int64_t v){
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v){
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+/**
+ * @brief appends values as a column in whichever of the two column modes is
+ * smaller
+ */
+void putColumn(std::vector<uint8_t>& out, const std::vector<uint64_t>& values){
+    size_t varintBytes = 0;
+    uint64_t all = 0;
+    for(uint64_t v : values){
+        varintBytes += varintSize(v);
+        all |= v;
+    }
+    size_t width = 0;
+    while(width < 64 && (all >> width)){ ++width; }
+    const size_t packedBytes = 1 + (values.size() * width + 7) / 8;
+
+    if(varintBytes <= packedBytes){
+        out.push_back(RAW_COLUMN_VARINT);
+        for(uint64_t v : values){ putVarint(out, v); }
+        return;
+    }
+
+    out.push_back(RAW_COLUMN_BITPACK);
+    out.push_back(static_cast<uint8_t>(width));
+    const size_t off = out.size();
+    out.resize(off + packedBytes - 1, 0);
+    uint8_t* dst = out.data() + off;
+    size_t bit = 0;
+    for(uint64_t v : values){
+        for(size_t done = 0; done < width; ){
+            const size_t shift = bit & 7;
+            const size_t take = std::min(width - done, 8 - shift);
+            dst[bit >> 3] |= static_cast<uint8_t>(((v >> done) & ((1u << take) - 1)) << shift);
+            done += take;
+            bit += take;
+        }
+    }
+}
+
+/**
+ * @class ColumnReader
+ * @brief bounds checked cursor over a block payload
+ */
+class ColumnReader {
+    private:
+        const uint8_t* cur;
+        const uint8_t* end;
+
+        void need(size_t n) const {
+            if(static_cast<size_t>(end - cur) < n){
+                throw std::runtime_error("truncated raw hit column");
+            }
+        }
+
+    public:
+        ColumnReader(const uint8_t* data, size_t len): cur(data), end(data + len) {}
+
+        const uint8_t* bytes(size_t n){
+            need(n);
+            const uint8_t* p = cur;
+            cur += n;
+            return p;
+        }
+
+        bool atEnd() const { return cur == end; }
+
+        //! @brief decodes count values of a column written by putColumn
+        void column(size_t count, std::vector<uint64_t>& values){
+            values.resize(count);
+            const uint8_t colMode = *bytes(1);
+            if(colMode == RAW_COLUMN_VARINT){
+                for(auto& v : values){
+                    v = 0;
+                    for(size_t shift = 0; ; shift += 7){
+                        if(shift > 63){ throw std::runtime_error("malformed raw hit varint"); }
+                        const uint8_t b = *bytes(1);
+                        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+                        if(!(b & 0x80)){ break; }
+                    }
+                }
+            }
+            else if(colMode == RAW_COLUMN_BITPACK){
+                const size_t width = *bytes(1);
+                if(width > 64){ throw std::runtime_error("malformed raw hit column width"); }
+                const uint8_t* src = bytes((count * width + 7) / 8);
+                size_t bit = 0;
+                for(auto& v : values){
+                    v = 0;
+                    for(size_t done = 0; done < width; ){
+                        const size_t shift = bit & 7;
+                        const size_t take = std::min(width - done, 8 - shift);
+                        v |= static_cast<uint64_t>((src[bit >> 3] >> shift) & ((1u << take) - 1)) << done;
+                        done += take;
+                        bit += take;
+                    }
+                }
+            }
+            else{
+                throw std::runtime_error(std::format("unknown raw hit column mode {}", colMode));
+            }
+        }
+};
+
+} // namespace
+
+
+void encodeRawBlock(
+    uint16_t encoding,
+    const mode::pixel_type* hits,
+    size_t count,
+    std::vector<uint8_t>& out
+){
+    uint64_t minToa = count ? hits[0].toa : 0;
+    uint64_t maxToa = minToa;
+    for(size_t i = 1; i < count; ++i){
+        minToa = std::min(minToa, hits[i].toa);
+        maxToa = std::max(maxToa, hits[i].toa);
+    }
+
+    const size_t hdrOff = out.size();
+    out.resize(hdrOff + RAW_BLOCK_HEADER_SIZE);
+
+    if(encoding == RAW_BLOCK_FIXED){
+        const size_t off = out.size();
+        out.resize(off + count * RAW_BIN_RECORD_SIZE);
+        uint8_t* rec = out.data() + off;
+        for(size_t i = 0; i < count; ++i){
+            rec[0] = hits[i].coord.x;
+            rec[1] = hits[i].coord.y;
+            putLE16(rec + 2, hits[i].tot);
+            putLE64(rec + 4, hits[i].toa);
+            rec += RAW_BIN_RECORD_SIZE;
+        }
+    }
+    else if(encoding == RAW_BLOCK_COLUMNAR){
+        const size_t off = out.size();
+        out.resize(off + 2 * count);
+        for(size_t i = 0; i < count; ++i){
+            out[off + i] = hits[i].coord.x;
+            out[off + count + i] = hits[i].coord.y;
+        }
+
+        std::vector<uint64_t> values(count);
+        for(size_t i = 0; i < count; ++i){ values[i] = hits[i].tot; }
+        putColumn(out, values);
+
+        uint64_t prev = minToa;
+        for(size_t i = 0; i < count; ++i){
+            values[i] = zigzag(static_cast<int64_t>(hits[i].toa - prev));
+            prev = hits[i].toa;
+        }
+        putColumn(out, values);
+    }
+    else{
+        throw std::invalid_argument(std::format("unknown raw hit block encoding {}", encoding));
+    }
+
+    uint8_t* hdr = out.data() + hdrOff;
+    putLE32(hdr, RAW_BLOCK_MAGIC);
+    putLE16(hdr + 4, encoding);
+    putLE16(hdr + 6, 0);
+    putLE32(hdr + 8, static_cast<uint32_t>(count));
+    putLE32(hdr + 12, static_cast<uint32_t>(out.size() - hdrOff - RAW_BLOCK_HEADER_SIZE));
+    putLE64(hdr + 16, minToa);
+    putLE64(hdr + 24, maxToa);
+}
+
+void decodeRawBlock(
+    const RawBlockInfo& info,
+    const uint8_t* payload,
+    std::vector<mode::pixel_type>& hits
+){
+    const size_t count = info.records;
+
+    // a corrupt header must not size the allocation below: writers never put
+    // more than RAW_BLOCK_RECORDS hits in a block, and every encoding stores at
+    // least x and y of each hit verbatim
+    if(count > RAW_BLOCK_RECORDS){
+        throw std::runtime_error(std::format("raw hit block claims {} records", count));
+    }
+    if(info.encoding == RAW_BLOCK_FIXED
+        && info.payloadLen != static_cast<uint64_t>(count) * RAW_BIN_RECORD_SIZE){
+        throw std::runtime_error("raw hit block length does not match record count");
+    }
+    if(info.payloadLen < 2 * static_cast<uint64_t>(count)){
+        throw std::runtime_error("raw hit block too short for its record count");
+    }
+    hits.assign(count, mode::pixel_type{});
+
+    if(info.encoding == RAW_BLOCK_FIXED){
+        const uint8_t* rec = payload;
+        for(auto& hit : hits){
+            hit.coord.x = rec[0];
+            hit.coord.y = rec[1];
+            hit.tot = getLE16(rec + 2);
+            hit.toa = getLE64(rec + 4);
+            rec += RAW_BIN_RECORD_SIZE;
+        }
+    }
+    else if(info.encoding == RAW_BLOCK_COLUMNAR){
+        ColumnReader rd(payload, info.payloadLen);
+        const uint8_t* xs = rd.bytes(count);
+        const uint8_t* ys = rd.bytes(count);
+        std::vector<uint64_t> values;
+
+        rd.column(count, values);
+        for(size_t i = 0; i < count; ++i){
+            hits[i].coord.x = xs[i];
+            hits[i].coord.y = ys[i];
+            hits[i].tot = static_cast<uint16_t>(values[i]);
+        }
+
+        rd.column(count, values);
+        uint64_t prev = info.minToa;
+        for(size_t i = 0; i < count; ++i){
+            prev += static_cast<uint64_t>(unzigzag(values[i]));
+            hits[i].toa = prev;
+        }
+        if(!rd.atEnd()){ throw std::runtime_error("trailing bytes in raw hit block"); }
+    }
+    else{
+        throw std::runtime_error(std::format("unknown raw hit block encoding {}", info.encoding));
+    }
+}
+
+
+bool TextRawHitWriter::open(const std::string& path, const std::string& header){
+    close();
+    // binary mode: index offsets count the bytes exactly as written
+    outFile = std::ofstream(path, std::ios::binary);
+    if(!outFile.is_open()){ return false; }
+    outFile << header;
+    fileOffset = header.size();
+
+    idxFile = std::ofstream(path + RAW_IDX_EXT, std::ios::binary);
+    if(!idxFile.is_open()){
+        outFile.close();
+        return false;
+    }
+    writeIdxHeader(idxFile);
+    blockRecords = 0;
+    return true;
+}
+
+void TextRawHitWriter::write(const mode::pixel_type* hits, size_t count){
+    // lines are formatted here rather than streamed, so their length is known
+    // for the index; the stream still buffers them
+    char line[4 * 21];
+    for(size_t i = 0; i < count; i++)
+    {
+        const mode::pixel_type& hit = hits[i];
+        char* end = putDecimal(line, hit.coord.x);
+        *end++ = ' ';
+        end = putDecimal(end, hit.coord.y);
+        *end++ = ' ';
+        end = putDecimal(end, hit.toa);
+        *end++ = ' ';
+        end = putDecimal(end, hit.tot);
+        *end++ = '\n';
+        outFile.write(line, end - line);
+
+        if(blockRecords == 0){
+            blockOffset = fileOffset;
+            blockMinToa = blockMaxToa = hit.toa;
+        }
+        blockMinToa = std::min(blockMinToa, hit.toa);
+        blockMaxToa = std::max(blockMaxToa, hit.toa);
+        fileOffset += end - line;
+        if(++blockRecords == RAW_BLOCK_RECORDS){ flushEntry(); }
+    }
+}
+
+void TextRawHitWriter::flushEntry(){
+    if(blockRecords == 0){ return; }
+    // written through its own stream, see BinaryRawHitWriter::flushBlock
+    writeIdxEntry(idxFile, {blockOffset, blockRecords, blockMinToa, blockMaxToa});
+    blockRecords = 0;
+}
+
+void TextRawHitWriter::close(){
+    if(outFile.is_open()){
+        flushEntry();
+        outFile.flush();
+        outFile.close();
+        idxFile.close();
+    }
+}
+
+
+BinaryRawHitWriter::BinaryRawHitWriter(uint16_t enc): encoding(enc){
+    pending.reserve(RAW_BLOCK_RECORDS);
+    block.reserve(RAW_BLOCK_HEADER_SIZE + RAW_BLOCK_RECORDS * RAW_BIN_RECORD_SIZE);
+}
+
+bool BinaryRawHitWriter::open(const std::string& path, const std::string& header){
+    close();
+    outFile = std::ofstream(path, std::ios::binary);
+    if(!outFile.is_open()){ return false; }
+
+    uint8_t fileHeader[sizeof(RAW_BIN_MAGIC) + 8];
+    std::memcpy(fileHeader, RAW_BIN_MAGIC, sizeof(RAW_BIN_MAGIC));
+    putLE16(fileHeader + 8, RAW_BIN_VERSION);
+    putLE16(fileHeader + 10, RAW_BIN_RECORD_SIZE);
+    putLE32(fileHeader + 12, static_cast<uint32_t>(header.size()));
+    outFile.write(reinterpret_cast<const char*>(fileHeader), sizeof(fileHeader));
+    outFile.write(header.data(), header.size());
+    fileOffset = sizeof(fileHeader) + header.size();
+
+    idxFile = std::ofstream(path + RAW_IDX_EXT, std::ios::binary);
+    if(!idxFile.is_open()){
+        outFile.close();
+        return false;
+    }
+    writeIdxHeader(idxFile);
+
+    pending.clear();
+    return true;
+}
+
+void BinaryRawHitWriter::write(const mode::pixel_type* hits, size_t count){
+    while(count){
+        const size_t n = std::min(count, RAW_BLOCK_RECORDS - pending.size());
+        pending.insert(pending.end(), hits, hits + n);
+        hits += n;
+        count -= n;
+        if(pending.size() == RAW_BLOCK_RECORDS){ flushBlock(); }
+    }
+}
+
+void BinaryRawHitWriter::flushBlock(){
+    if(pending.empty()){ return; }
+
+    block.clear();
+    encodeRawBlock(encoding, pending.data(), pending.size(), block);
+    outFile.write(reinterpret_cast<const char*>(block.data()), block.size());
+
+    // the index has its own stream buffer and may reach the disk before the
+    // block does, RawHitIndex::forFile drops entries past the end of the data
+    writeIdxEntry(idxFile, {
+        fileOffset, static_cast<uint32_t>(pending.size()),
+        getLE64(block.data() + 16), getLE64(block.data() + 24)
+    });
+
+    fileOffset += block.size();
+    pending.clear();
+}
+
+void BinaryRawHitWriter::close(){
+    if(outFile.is_open()){
+        flushBlock();
+        outFile.flush();
+        outFile.close();
+        idxFile.close();
+    }
+}
+
+
+std::unique_ptr<RawHitWriter> makeRawHitWriter(RawFormat format){
+    switch (format)
+    {
+    case RawFormat::TEXT:
+        return std::make_unique<TextRawHitWriter>();
+    case RawFormat::BINARY:
+        return std::make_unique<BinaryRawHitWriter>(RAW_BLOCK_FIXED);
+    case RawFormat::COLUMNAR:
+        return std::make_unique<BinaryRawHitWriter>(RAW_BLOCK_COLUMNAR);
+    }
+    throw std::invalid_argument("unknown raw format");
+}
+
+
+RawHitReader::RawHitReader(const std::string& path):
+    inFile(path, std::ios::binary)
+{
+    if(!inFile.is_open()){
+        throw std::runtime_error(std::format("cant open raw hit file {}", path));
+    }
+
+    uint8_t fileHeader[sizeof(RAW_BIN_MAGIC) + 8];
+    if(!inFile.read(reinterpret_cast<char*>(fileHeader), sizeof(fileHeader))
+        || std::memcmp(fileHeader, RAW_BIN_MAGIC, sizeof(RAW_BIN_MAGIC)) != 0){
+        throw std::runtime_error(std::format("{} is not a binary raw hit file", path));
+    }
+
+    version_ = getLE16(fileHeader + 8);
+    if(version_ != RAW_BIN_VERSION){
+        throw std::runtime_error(
+            std::format("{}: unsupported raw hit file version {}", path, version_)
+        );
+    }
+    if(getLE16(fileHeader + 10) != RAW_BIN_RECORD_SIZE){
+        throw std::runtime_error(std::format("{}: unexpected record size", path));
+    }
+
+    metadata_.resize(getLE32(fileHeader + 12));
+    if(!inFile.read(metadata_.data(), metadata_.size())){
+        throw std::runtime_error(std::format("{}: truncated file header", path));
+    }
+    dataOffset_ = sizeof(fileHeader) + metadata_.size();
+    fileSize_ = std::filesystem::file_size(path);
+}
+
+bool RawHitReader::readBlockHeader(){
+    uint8_t hdr[RAW_BLOCK_HEADER_SIZE];
+    inFile.read(reinterpret_cast<char*>(hdr), sizeof(hdr));
+    const size_t got = static_cast<size_t>(inFile.gcount());
+    if(got == 0){ return false; }
+    if(got != sizeof(hdr)){
+        // the writer stopped (e.g. crashed) while writing the header
+        truncated_ = true;
+        return false;
+    }
+    if(getLE32(hdr) != RAW_BLOCK_MAGIC){
+        throw std::runtime_error("malformed raw hit block header");
+    }
+
+    lastBlock_.encoding = getLE16(hdr + 4);
+    lastBlock_.records = getLE32(hdr + 8);
+    lastBlock_.payloadLen = getLE32(hdr + 12);
+    lastBlock_.minToa = getLE64(hdr + 16);
+    lastBlock_.maxToa = getLE64(hdr + 24);
+
+    if(static_cast<uint64_t>(inFile.tellg()) + lastBlock_.payloadLen > fileSize_){
+        truncated_ = true;
+        return false;
+    }
+    return true;
+}
+
+void RawHitReader::seek(uint64_t offset){
+    inFile.clear();
+    inFile.seekg(static_cast<std::streamoff>(offset));
+}
+
+bool RawHitReader::skipBlock(uint64_t& offset){
+    inFile.clear();
+    offset = static_cast<uint64_t>(inFile.tellg());
+    if(!readBlockHeader()){ return false; }
+    inFile.seekg(lastBlock_.payloadLen, std::ios::cur);
+    return true;
+}
+
+bool RawHitReader::readBlock(std::vector<mode::pixel_type>& hits){
+    hits.clear();
+    if(!readBlockHeader()){ return false; }
+
+    payload.resize(lastBlock_.payloadLen);
+    if(!inFile.read(reinterpret_cast<char*>(payload.data()), lastBlock_.payloadLen)){
+        throw std::runtime_error("truncated raw hit block");
+    }
+
+    decodeRawBlock(lastBlock_, payload.data(), hits);
+    return true;
+}
+
+std::vector<mode::pixel_type> RawHitReader::readAll(){
+    std::vector<mode::pixel_type> all;
+    std::vector<mode::pixel_type> hits;
+    while(readBlock(hits)){
+        all.insert(all.end(), hits.begin(), hits.end());
+    }
+    return all;
+}
+
+
+TextRawHitReader::TextRawHitReader(const std::string& path):
+    inFile(path, std::ios::binary)
+{
+    if(!inFile.is_open()){
+        throw std::runtime_error(std::format("cant open raw hit file {}", path));
+    }
+    while(inFile.peek() == '#'){
+        inFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    inFile.clear();
+    dataOffset_ = static_cast<uint64_t>(inFile.tellg());
+}
+
+void TextRawHitReader::seek(uint64_t offset){
+    inFile.clear();
+    inFile.seekg(static_cast<std::streamoff>(offset));
+}
+
+bool TextRawHitReader::readBlock(std::vector<mode::pixel_type>& hits, uint64_t& offset){
+    hits.clear();
+    inFile.clear();
+    offset = static_cast<uint64_t>(inFile.tellg());
+
+    mode::pixel_type hit;
+    while(hits.size() < RAW_BLOCK_RECORDS && std::getline(inFile, line)){
+        if(inFile.eof()){
+            // no newline: the writer stopped while writing this line
+            truncated_ = true;
+            break;
+        }
+        if(!parseTextHit(line, hit)){
+            throw std::runtime_error(std::format("malformed raw hit line \"{}\"", line));
+        }
+        hits.push_back(hit);
+    }
+    return !hits.empty();
+}
+
+
+std::vector<RawIndexEntry> RawHitIndex::readSidecar(const std::string& rawPath){
+    std::vector<RawIndexEntry> entries;
+    std::ifstream idxFile(rawPath + RAW_IDX_EXT, std::ios::binary);
+    uint8_t idxHeader[RAW_IDX_HEADER_SIZE];
+    if(idxFile.read(reinterpret_cast<char*>(idxHeader), sizeof(idxHeader))
+        && std::memcmp(idxHeader, RAW_IDX_MAGIC, sizeof(RAW_IDX_MAGIC)) == 0
+        && getLE16(idxHeader + 8) == RAW_IDX_VERSION)
+    {
+        uint8_t entry[RAW_IDX_ENTRY_SIZE];
+        while(idxFile.read(reinterpret_cast<char*>(entry), sizeof(entry))){
+            entries.push_back({
+                getLE64(entry), getLE32(entry + 8), getLE64(entry + 16), getLE64(entry + 24)
+            });
+        }
+    }
+    return entries;
+}
+
+void RawHitIndex::scanRemaining(RawHitReader& reader){
+    uint64_t blockOffset;
+    while(reader.skipBlock(blockOffset)){
+        const auto& info = reader.lastBlock();
+        entries_.push_back({blockOffset, info.records, info.minToa, info.maxToa});
+    }
+}
+
+RawHitIndex RawHitIndex::forFile(const std::string& rawPath){
+    if(isTextRawFile(rawPath)){ return forTextFile(rawPath); }
+
+    RawHitIndex index;
+    RawHitReader reader(rawPath);
+    index.entries_ = readSidecar(rawPath);
+
+    // drop entries of blocks that never fully reached the data file, then pick
+    // up blocks written after the last remaining entry
+    while(!index.entries_.empty()){
+        reader.seek(index.entries_.back().offset);
+        uint64_t lastOffset;
+        if(reader.skipBlock(lastOffset)){ break; }
+        index.entries_.pop_back();
+    }
+    if(index.entries_.empty()){ reader.seek(reader.dataOffset()); }
+    index.scanRemaining(reader);
+    index.truncated_ = reader.truncated();
+    return index;
+}
+
+RawHitIndex RawHitIndex::forTextFile(const std::string& rawPath){
+    RawHitIndex index;
+    TextRawHitReader reader(rawPath);
+    index.entries_ = readSidecar(rawPath);
+    std::vector<mode::pixel_type> hits;
+    uint64_t offset;
+
+    // lines have no length field, so the last entry is kept only if all of its
+    // lines read back, then the lines after it are indexed
+    while(!index.entries_.empty()){
+        reader.seek(index.entries_.back().offset);
+        if(reader.readBlock(hits, offset) && hits.size() == index.entries_.back().records){ break; }
+        index.entries_.pop_back();
+    }
+    if(index.entries_.empty()){ reader.seek(reader.dataOffset()); }
+    while(reader.readBlock(hits, offset)){
+        const auto [lo, hi] = std::minmax_element(hits.begin(), hits.end(),
+            [](const auto& a, const auto& b){ return a.toa < b.toa; });
+        index.entries_.push_back({offset, static_cast<uint32_t>(hits.size()), lo->toa, hi->toa});
+    }
+    index.truncated_ = reader.truncated();
+    return index;
+}
+
+size_t queryRawHits(
+    const std::string& rawPath,
+    uint64_t fromToa,
+    uint64_t toToa,
+    std::vector<mode::pixel_type>& out,
+    bool* truncated
+){
+    const RawHitIndex index = RawHitIndex::forFile(rawPath);
+    if(truncated && index.truncated()){ *truncated = true; }
+    std::vector<mode::pixel_type> hits;
+    size_t found = 0;
+
+    const auto overlaps = [&](const RawIndexEntry& entry){
+        return entry.maxToa >= fromToa && entry.minToa <= toToa;
+    };
+    const auto collect = [&]{
+        for(const auto& hit : hits){
+            if(hit.toa >= fromToa && hit.toa <= toToa){
+                out.push_back(hit);
+                ++found;
+            }
+        }
+    };
+
+    if(isTextRawFile(rawPath)){
+        TextRawHitReader reader(rawPath);
+        uint64_t offset;
+        for(const auto& entry : index.entries()){
+            if(!overlaps(entry)){ continue; }
+            reader.seek(entry.offset);
+            reader.readBlock(hits, offset);
+            collect();
+        }
+        return found;
+    }
+
+    RawHitReader reader(rawPath);
+    for(const auto& entry : index.entries()){
+        if(!overlaps(entry)){ continue; }
+        reader.seek(entry.offset);
+        reader.readBlock(hits);
+        collect();
+    }
+    return found;
+}
+
+std::vector<std::filesystem::path> findRunFiles(
+    const std::string& dir,
+    const std::string& runNum
+){
+    const std::regex fileRegex(
+        std::format(R"({}_RN-{}_FN-(\d+)(\{}|\{}))", RAW_FILE_NAME, runNum, RAW_BIN_EXT, RAW_TEXT_EXT)
+    );
+    std::vector<std::pair<unsigned long, std::filesystem::path>> numbered;
+
+    for (const auto& entry : std::filesystem::directory_iterator(dir))
+    {
+        if(!entry.is_regular_file()){ continue; }
+        const std::string filename = entry.path().filename().string();
+        std::smatch matches;
+        if(std::regex_match(filename, matches, fileRegex)){
+            numbered.emplace_back(std::stoul(matches[1].str()), entry.path());
+        }
+    }
+
+    std::sort(numbered.begin(), numbered.end());
+    std::vector<std::filesystem::path> files;
+    for(auto& [fileNo, path] : numbered){ files.push_back(std::move(path)); }
+    return files;
+}
+
+size_t queryRawRun(
+    const std::string& dir,
+    const std::string& runNum,
+    uint64_t fromToa,
+    uint64_t toToa,
+    std::vector<mode::pixel_type>& out,
+    bool* truncated
+){
+    size_t found = 0;
+    for(const auto& file : findRunFiles(dir, runNum)){
+        found += queryRawHits(file.string(), fromToa, toToa, out, truncated);
+    }
+    return found;
+}
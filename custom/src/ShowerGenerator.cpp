@@ -0,0 +1,322 @@
+#include "ShowerGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include <random>
+
+namespace {
+
+//! @brief largest ToT a pixel reports (10 bit counter)
+constexpr double TOT_MAX = 1023;
+
+//! @brief pixel offsets of 1-4 pixel x-ray clusters, before rotation
+constexpr int XRAY_SHAPE[4][4][2] = {
+    {{0, 0}},
+    {{0, 0}, {1, 0}},
+    {{0, 0}, {1, 0}, {0, 1}},
+    {{0, 0}, {1, 0}, {0, 1}, {1, 1}},
+};
+
+//! @brief share of the cluster ToT per pixel of 1-4 pixel x-ray clusters
+constexpr double XRAY_SHARE[4][4] = {
+    {1.0},
+    {0.6, 0.4},
+    {0.6, 0.2, 0.2},
+    {0.4, 0.2, 0.2, 0.2},
+};
+
+//! @brief readout double columns of the chip
+constexpr size_t DOUBLE_COLUMNS = CHIP_WIDTH / 2;
+
+//! @brief windows with fewer hits are reordered by insertion instead of counting
+constexpr size_t SMALL_WINDOW_HITS = 32;
+
+//! @brief hits sampled by matchHitRate
+constexpr size_t RATE_SAMPLE_HITS = 1 << 18;
+
+uint64_t splitmix64(uint64_t& x){
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t rotl(uint64_t x, int k){
+    return (x << k) | (x >> (64 - k));
+}
+
+//! @brief sorted ToT quantiles of n samples of draw, clamped to [1, TOT_MAX]
+template <typename Draw>
+std::vector<uint16_t> quantiles(size_t n, Draw&& draw){
+    std::vector<uint16_t> q(n);
+    for(auto& v : q){
+        v = static_cast<uint16_t>(std::clamp(std::round(draw()), 1.0, TOT_MAX));
+    }
+    std::sort(q.begin(), q.end());
+    return q;
+}
+
+} // namespace
+
+ShowerGenerator::Rng::Rng(uint64_t seed){
+    for(auto& word : s){ word = splitmix64(seed); }
+}
+
+uint64_t ShowerGenerator::Rng::next(){
+    const uint64_t result = rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+ShowerGenerator::ShowerGenerator(const ShowerSettings& set): settings(set), rng(set.seed){
+    const double weights = settings.xrayWeight + settings.mipWeight + settings.heavyIonWeight;
+    const double particleRate = weights > 0 ? settings.particleRate : 0;
+    const double noiseRate = settings.noisyPixels * settings.noiseRate;
+    const double eventRate = particleRate + noiseRate;
+    meanSpacing = eventRate > 0 ? TOA_TICKS_PER_SEC / eventRate : 1.0;
+
+    // without particle weights only noise is generated (and 0/0 must not
+    // turn the cdf into NaN)
+    const double perWeight = weights > 0 ? particleRate / weights : 0;
+    const double kinds[PARTICLE_KINDS] = {
+        perWeight * settings.xrayWeight,
+        perWeight * settings.mipWeight,
+        perWeight * settings.heavyIonWeight,
+        noiseRate,
+    };
+    double sum = 0;
+    for(size_t k = 0; k < PARTICLE_KINDS; ++k){
+        sum += eventRate > 0 ? kinds[k] / eventRate : (k == 0);
+        kindCdf[k] = sum;
+    }
+    kindCdf.back() = 1.0;
+
+    double sizeWeights = 0;
+    for(double w : settings.xraySizeWeights){ sizeWeights += w; }
+    sum = 0;
+    for(size_t k = 0; k < xraySizeCdf.size(); ++k){
+        sum += sizeWeights > 0 ? settings.xraySizeWeights[k] / sizeWeights : (k == 0);
+        xraySizeCdf[k] = sum;
+    }
+    xraySizeCdf.back() = 1.0;
+
+    // spectra are sampled once here and drawn from as quantile tables
+    std::mt19937_64 spectrumRng(settings.seed);
+    std::normal_distribution<double> normal;
+    xrayTot = quantiles(QUANTILES, [&]{
+        return settings.xrayTotMean + settings.xrayTotSigma * normal(spectrumRng);
+    });
+    mipTot = quantiles(QUANTILES, [&]{
+        // -ln(z^2) of a standard normal z is Moyal distributed
+        const double z = normal(spectrumRng);
+        return settings.mipTotMpv - settings.mipTotWidth * std::log(z * z);
+    });
+
+    const double maxWalk = CLUSTER_TOA_WINDOW > 0 ? CLUSTER_TOA_WINDOW - 1.0 : 0.0;
+    walk.resize(static_cast<size_t>(TOT_MAX) + 1);
+    for(size_t tot = 1; tot < walk.size(); ++tot){
+        walk[tot] = static_cast<uint8_t>(std::min(maxWalk, std::round(settings.timewalk / tot)));
+    }
+
+    noisy.resize(settings.noisyPixels);
+    for(auto& px : noisy){
+        px = mode::pixel_type{};
+        px.coord.x = static_cast<uint8_t>(rng.below(CHIP_WIDTH));
+        px.coord.y = static_cast<uint8_t>(rng.below(CHIP_HEIGHT));
+    }
+}
+
+void ShowerGenerator::addHit(int x, int y, uint64_t toa, double tot){
+    if(x < 0 || y < 0 || x >= CHIP_WIDTH || y >= CHIP_HEIGHT){ return; }
+
+    const auto t = static_cast<uint16_t>(std::clamp(tot, 1.0, TOT_MAX));
+    mode::pixel_type& px = out.emplace_back();
+    px.coord.x = static_cast<uint8_t>(x);
+    px.coord.y = static_cast<uint8_t>(y);
+    px.toa = toa + walk[t];
+    px.tot = t;
+}
+
+void ShowerGenerator::addParticle(uint64_t toa){
+    const double u = rng.uniform();
+    size_t kind = 0;
+    while(u >= kindCdf[kind] && kind + 1 < PARTICLE_KINDS){ ++kind; }
+    ++stats_.particles[kind];
+
+    switch(static_cast<ParticleKind>(kind)){
+        case ParticleKind::XRAY: {
+            const double v = rng.uniform();
+            size_t size = 0;
+            while(v >= xraySizeCdf[size] && size + 1 < xraySizeCdf.size()){ ++size; }
+
+            const int x = rng.below(CHIP_WIDTH);
+            const int y = rng.below(CHIP_HEIGHT);
+            const int flipX = rng.below(2) ? 1 : -1;
+            const int flipY = rng.below(2) ? 1 : -1;
+            const double tot = xrayTot[rng.below(QUANTILES)];
+            for(size_t i = 0; i <= size; ++i){
+                addHit(
+                    x + flipX * XRAY_SHAPE[size][i][0],
+                    y + flipY * XRAY_SHAPE[size][i][1],
+                    toa,
+                    tot * XRAY_SHARE[size][i]
+                );
+            }
+            break;
+        }
+        case ParticleKind::MIP: {
+            // one pixel per step along the major axis of the track
+            const double angle = rng.uniform() * 2 * std::numbers::pi;
+            double dx = std::cos(angle);
+            double dy = std::sin(angle);
+            const double major = std::max(std::abs(dx), std::abs(dy));
+            dx /= major;
+            dy /= major;
+
+            // shifted by a chip size so that truncation rounds off chip pixels too
+            double x = rng.below(CHIP_WIDTH) + CHIP_WIDTH + 0.5;
+            double y = rng.below(CHIP_HEIGHT) + CHIP_HEIGHT + 0.5;
+            const uint32_t length = 1 + rng.below(std::max<uint16_t>(settings.mipMaxLength, 1));
+            for(uint32_t i = 0; i < length; ++i, x += dx, y += dy){
+                addHit(
+                    static_cast<int>(x) - CHIP_WIDTH,
+                    static_cast<int>(y) - CHIP_HEIGHT,
+                    toa,
+                    mipTot[rng.below(QUANTILES)]
+                );
+            }
+            break;
+        }
+        case ParticleKind::HEAVY_ION: {
+            const uint16_t minR = std::min(settings.heavyIonMinRadius, settings.heavyIonMaxRadius);
+            const int r = minR + rng.below(settings.heavyIonMaxRadius - minR + 1);
+            const double r2 = std::max(r * r, 1);
+            const int x = rng.below(CHIP_WIDTH);
+            const int y = rng.below(CHIP_HEIGHT);
+            for(int dy = -r; dy <= r; ++dy){
+                for(int dx = -r; dx <= r; ++dx){
+                    const int d2 = dx * dx + dy * dy;
+                    if(d2 > r * r){ continue; }
+                    addHit(
+                        x + dx,
+                        y + dy,
+                        toa,
+                        settings.heavyIonTotPeak * (1 - 0.75 * d2 / r2) * (0.95 + 0.1 * rng.uniform())
+                    );
+                }
+            }
+            break;
+        }
+        case ParticleKind::NOISE: {
+            if(noisy.empty()){ break; }
+            const auto& px = noisy[rng.below(noisy.size())];
+            addHit(px.coord.x, px.coord.y, toa, 1 + rng.below(std::max<uint16_t>(settings.noiseTotMax, 1)));
+            break;
+        }
+    }
+}
+
+void ShowerGenerator::refill(){
+    out.clear();
+    outPos = 0;
+
+    const uint64_t window = settings.readoutWindow;
+    uint64_t toa = static_cast<uint64_t>(nextToa);
+    const uint64_t windowEnd = window ? (toa / window + 1) * window : toa + 1;
+    do{
+        addParticle(settings.startToa + toa);
+        nextToa -= std::log1p(-rng.uniform()) * meanSpacing;
+        toa = static_cast<uint64_t>(nextToa);
+    } while(toa < windowEnd);
+
+    // each double column drains its hits of the window in turn, in the
+    // order they arrived (stable sort by double column)
+    if(!window || out.size() < 2){ return; }
+    if(out.size() < SMALL_WINDOW_HITS){
+        for(size_t i = 1; i < out.size(); ++i){
+            const mode::pixel_type px = out[i];
+            size_t j = i;
+            for(; j > 0 && (out[j - 1].coord.x >> 1) > (px.coord.x >> 1); --j){ out[j] = out[j - 1]; }
+            out[j] = px;
+        }
+    } else{
+        std::array<uint32_t, DOUBLE_COLUMNS + 1> start{};
+        for(const auto& px : out){ ++start[(px.coord.x >> 1) + 1]; }
+        for(size_t c = 1; c <= DOUBLE_COLUMNS; ++c){ start[c] += start[c - 1]; }
+
+        sorted.resize(out.size());
+        for(const auto& px : out){ sorted[start[px.coord.x >> 1]++] = px; }
+        out.swap(sorted);
+    }
+}
+
+size_t ShowerGenerator::generate(mode::pixel_type* hits, size_t max){
+    size_t n = 0;
+    while(n < max){
+        if(outPos == out.size()){
+            refill();
+            continue;
+        }
+        const size_t take = std::min(max - n, out.size() - outPos);
+        std::copy_n(out.begin() + outPos, take, hits + n);
+        outPos += take;
+        n += take;
+    }
+    stats_.hits += n;
+    return n;
+}
+
+uint64_t ShowerGenerator::fill(SafeBuff<mode::pixel_type>& buf, size_t count, size_t& discarded){
+    scratch.resize(count);
+    generate(scratch.data(), count);
+
+    uint64_t fill;
+    {
+        std::lock_guard<std::mutex> lock(buf.mtx_);
+        fill = buf.addElements(count, scratch.data(), discarded);
+    }
+    buf.cv_.notify_one();
+    return fill;
+}
+
+uint64_t ShowerGenerator::push(BroadcastRing<mode::pixel_type>& ring, size_t count, size_t& discarded){
+    scratch.resize(count);
+    generate(scratch.data(), count);
+    return ring.push(scratch.data(), count, discarded);
+}
+
+ShowerSettings matchHitRate(ShowerSettings settings, double hitRate){
+    const double noiseRate = settings.noisyPixels * settings.noiseRate;
+
+    ShowerGenerator sample(settings);
+    std::vector<mode::pixel_type> hits(RATE_SAMPLE_HITS);
+    sample.generate(hits.data(), hits.size());
+
+    const auto& stats = sample.stats();
+    const uint64_t noiseHits = stats.particles[static_cast<size_t>(ParticleKind::NOISE)];
+    uint64_t particles = 0;
+    for(size_t k = 0; k < PARTICLE_KINDS; ++k){
+        if(k != static_cast<size_t>(ParticleKind::NOISE)){ particles += stats.particles[k]; }
+    }
+
+    if(particles > 0 && stats.hits > noiseHits){
+        const double hitsPerParticle = double(stats.hits - noiseHits) / particles;
+        settings.particleRate = std::max(0.0, hitRate - noiseRate) / hitsPerParticle;
+    }
+    return settings;
+}
+
+EmulatorHitSource showerHitSource(const ShowerSettings& settings){
+    // std::function needs a copyable target
+    auto generator = std::make_shared<ShowerGenerator>(settings);
+    return [generator](mode::pixel_type* hits, size_t max){
+        return generator->generate(hits, max);
+    };
+}
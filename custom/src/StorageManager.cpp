@@ -2,6 +2,7 @@
 #include "globals.h"
 #include <fstream>
 #include <functional>
+#include <future>
 #include <string>
 #include <iostream>
 
@@ -9,51 +10,52 @@
 StorageManager::StorageManager(
     const std::string& rn,
     std::shared_ptr<SafeQueue<SpeciesHit>> shq,
-    std::shared_ptr<SafeBuff<mode::pixel_type>> rh2w,
+    std::shared_ptr<BroadcastRing<mode::pixel_type>> rhr,
     std::shared_ptr<Logger> log
-):runNum(rn),speciesHitsQ(shq),rawHitsToWriteBuff(rh2w),logger(log){}
+):runNum(rn),speciesHitsQ(shq),rawHitsRing(rhr),logger(log){}
 
 StorageManager::~StorageManager(){
     safe_finish(speciesThread,speciesHitsQ);
-    safe_finish(rawThread,rawHitsToWriteBuff);
+    safe_finish(rawThread,rawHitsRing);
 }
 
 void StorageManager::launch(){
-    speciesThread = std::jthread([&](std::stop_token stoken){
+    std::promise<void> speciesStarted, rawStarted;
+    std::future<void> speciesRunning = speciesStarted.get_future();
+    std::future<void> rawRunning = rawStarted.get_future();
+    speciesThread = std::jthread([&, started = std::move(speciesStarted)](std::stop_token stoken) mutable {
+        started.set_value();
         this->handleSpeciesHits(stoken);
     });
-    rawThread = std::jthread([&](std::stop_token stoken){
+    rawThread = std::jthread([&, started = std::move(rawStarted)](std::stop_token stoken) mutable {
+        started.set_value();
         this->handleRawHits(stoken);
     });
+    speciesRunning.wait();
+    rawRunning.wait();
 }
 
-bool StorageManager::checkUpdateOutFile(
-    size_t& lineCount,
-    std::ofstream& outFile,
-    const std::string& filename,
-    const std::string& storagePath,
+bool StorageManager::rollOverFile(
+    size_t& count,
     size_t& fileNo,
-    const size_t softMaxLines){
+    size_t softMax,
+    const std::string& storagePath,
+    const std::string& filename,
+    const std::string& extension,
+    const std::function<bool(const std::string&)>& openFile){
 
-    std::string outFileName;
-    if (lineCount > softMaxLines)
-    {
-        if(outFile.is_open())
-        {
-            outFile.flush();
-            outFile.close();
-        }
-        outFileName = std::format(
-            "{}_RN-{}_FN-{}.txt",
-            filename,runNum,std::to_string(fileNo)
-        );
-        outFile = std::ofstream(storagePath + "/" + outFileName);
-        outFile << header.str();
-        lineCount = 0;
-        fileNo++;
-    }
+    // the first call always rolls over, so the file is open until one fails
+    if (count <= softMax){ return true; }
+
+    const std::string outFileName = std::format(
+        "{}_RN-{}_FN-{}{}",
+        filename,runNum,std::to_string(fileNo),extension
+    );
+    const bool opened = openFile(storagePath + "/" + outFileName);
+    count = 0;
+    fileNo++;
 
-    if(!outFile.is_open()){
+    if(!opened){
         logger->log(
             LogLevel::LL_FATAL,
             std::format("cant create outputfile {}", outFileName)
@@ -63,6 +65,41 @@ bool StorageManager::checkUpdateOutFile(
     return true;
 }
 
+bool StorageManager::checkUpdateOutFile(
+    size_t& lineCount,
+    std::ofstream& outFile,
+    const std::string& filename,
+    const std::string& storagePath,
+    size_t& fileNo,
+    const size_t softMaxLines){
+
+    return rollOverFile(lineCount, fileNo, softMaxLines, storagePath, filename, ".txt",
+        [&](const std::string& path){
+            if(outFile.is_open())
+            {
+                outFile.flush();
+                outFile.close();
+            }
+            outFile = std::ofstream(path);
+            outFile << header.str();
+            return outFile.is_open();
+        });
+}
+
+bool StorageManager::checkUpdateRawFile(
+    size_t& hitCount,
+    RawHitWriter& writer,
+    size_t& fileNo){
+
+    return rollOverFile(hitCount, fileNo, MAX_RAW_FILE_LINES, RAW_DATA_DIR, RAW_FILE_NAME,
+        writer.extension(),
+        [&](const std::string& path){ return writer.open(path, header.str()); });
+}
+
+void writeSpeciesHit(std::ostream& out, const SpeciesHit& hit){
+    out << (int) hit.grade_ << " " << hit.startTOA_ << " " << hit.totalE_ << std::endl;
+}
+
 //! @todo - minimize code duplication for writing different kinds of hits
 // to different files
 void StorageManager::handleSpeciesHits(std::stop_token stopToken){
@@ -97,9 +134,7 @@ void StorageManager::handleSpeciesHits(std::stop_token stopToken){
             
                 count += speciesHitsQ->q_.size();
                 while(!speciesHitsQ->q_.empty()){
-                    const auto curEl = speciesHitsQ->q_.front();
-                    outFile << (int) curEl.grade_ << " " << curEl.startTOA_ << 
-                    " " << curEl.totalE_  << std::endl;
+                    writeSpeciesHit(outFile, speciesHitsQ->q_.front());
                     speciesHitsQ->q_.pop();
                 }
             }
@@ -120,9 +155,7 @@ void StorageManager::handleSpeciesHits(std::stop_token stopToken){
             std::unique_lock lk(speciesHitsQ->mtx_);  
             while(!speciesHitsQ->q_.empty())
             {
-                const auto curEl = speciesHitsQ->q_.front();
-                outFile << curEl.grade_ << " " << curEl.startTOA_ <<
-                " " << curEl.totalE_  << std::endl;
+                writeSpeciesHit(outFile, speciesHitsQ->q_.front());
                 speciesHitsQ->q_.pop();
             }
         }
@@ -147,75 +180,40 @@ void StorageManager::handleRawHits(std::stop_token stopToken){
     {
         logger->log(LogLevel::LL_INFO,"StorageManager rawThread launched");
 
-        mode::pixel_type* workBuf = new mode::pixel_type[MAX_BUFF_EL];
+        const mode::pixel_type* workBuf;
         size_t workBufElements = 0;
 
         size_t count = MAX_RAW_FILE_LINES + 1;
         size_t fileNo = 0;
-        std::ofstream outFile;
+        auto writer = makeRawHitWriter(RAW_FILE_FORMAT);
         while(!stopToken.stop_requested())
         {
-            if(!checkUpdateOutFile(
-                count,
-                outFile,
-                RAW_FILE_NAME,
-                RAW_DATA_DIR,
-                fileNo,
-                MAX_RAW_FILE_LINES)
-            ){
+            if(!checkUpdateRawFile(count, *writer, fileNo)){
                 logger->log(LogLevel::LL_INFO,"StorageManager rawThread cant open outfile");
                 return;
             }
             
-            {
-                std::unique_lock lk(rawHitsToWriteBuff->mtx_);
-                if(!stopToken.stop_requested())
-                {
-                    rawHitsToWriteBuff->cv_.wait(lk, [&]{
-                    return stopToken.stop_requested() || (rawHitsToWriteBuff->numElements_ > 0);});
-                }
-                workBufElements = rawHitsToWriteBuff->copyClear(workBuf,MAX_BUFF_EL);
-            }
-            for(size_t i = 0; i < workBufElements; i++)
-            {
-                outFile 
-                    << (unsigned) workBuf[i].coord.x << " " 
-                    << (unsigned) workBuf[i].coord.y << " "
-                    << workBuf[i].toa << " "
-                    << workBuf[i].tot << std::endl;
-            }
+            // batch up writes: only wake once enough hits have accumulated
+            if(!rawHitsRing->waitForData(RAW_CURSOR_STORAGE, stopToken, RAW_HIT_NOTIF_INC)) { continue; }
+            workBufElements = rawHitsRing->peek(RAW_CURSOR_STORAGE,workBuf,MAX_BUFF_EL);
+            writer->write(workBuf,workBufElements);
+            rawHitsRing->release(RAW_CURSOR_STORAGE,workBufElements);
             count += workBufElements;
         }
 
         // do any final processing
 
-        {
-            std::unique_lock lk(rawHitsToWriteBuff->mtx_);
-            workBufElements = rawHitsToWriteBuff->copyClear(workBuf,MAX_BUFF_EL);
-        }
-
-        if(!checkUpdateOutFile(
-            count,
-            outFile,
-            RAW_FILE_NAME,
-            RAW_DATA_DIR,
-            fileNo,
-            MAX_RAW_FILE_LINES)
-        ){
+        if(!checkUpdateRawFile(count, *writer, fileNo)){
             logger->log(LogLevel::LL_INFO,"StorageManager rawThread cant open outfile");
             return;
         }
 
-        for(size_t i = 0; i < workBufElements; i++)
+        while((workBufElements = rawHitsRing->peek(RAW_CURSOR_STORAGE,workBuf,MAX_BUFF_EL)))
         {
-            outFile
-                << (unsigned) workBuf[i].coord.x << " "
-                << (unsigned) workBuf[i].coord.y << " "
-                << workBuf[i].toa << " "
-                << workBuf[i].tot << std::endl;
+            writer->write(workBuf,workBufElements);
+            rawHitsRing->release(RAW_CURSOR_STORAGE,workBufElements);
         }
-        outFile.flush();
-        outFile.close();
+        writer->close();
         logger->log(LogLevel::LL_INFO,"StorageManager rawThread terminated");
 
     }
@@ -320,7 +318,9 @@ void StorageManager::genHeader(
     header << "# ----  End Acquisition Configuration  ----" << std::endl;
 
     header << "#" << std::endl;
-    header << "# raw format: x(int) y(int) toa(tics) tot(tics)" << std::endl;
+    header << "# raw format: x(int) y(int) toa(tics) tot(tics)"
+        << (RAW_FILE_FORMAT != RawFormat::TEXT ? " (binary blocks, see RawHitFormats.hpp)" : "")
+        << std::endl;
     header << "# species format: grade(int) cluster_start_toa(tics) cluster_energy(keV)" << std::endl;
     header << "# NOTE: tics are since begining of acquisition; 1 tic = 1/Clk_Freq" << std::endl;
     header << "#----------------------------------------------------------------------------------------" << std::endl;
@@ -0,0 +1,100 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <utility>
+
+WorkStealingPool::WorkStealingPool(size_t workers){
+    workers = std::max<size_t>(workers, 1);
+    for(size_t w = 0; w < workers; ++w){
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for(size_t w = 1; w < workers; ++w){
+        threads.emplace_back([this, w](std::stop_token stoken){
+            this->workerLoop(stoken, w);
+        });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool(){
+    for(auto& t : threads){ t.request_stop(); }
+    {
+        std::lock_guard lk(mtx);
+        wakeCv.notify_all();
+    }
+    threads.clear(); // joins
+}
+
+bool WorkStealingPool::take(size_t worker, size_t& task){
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard lk(own.mtx);
+        if(!own.tasks.empty()){
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for(size_t k = 1; k < queues.size(); ++k){
+        WorkerQueue& victim = *queues[(worker + k) % queues.size()];
+        std::lock_guard lk(victim.mtx);
+        if(!victim.tasks.empty()){
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::work(size_t worker){
+    size_t task;
+    while(take(worker, task)){
+        try{
+            (*job)(task, worker);
+        } catch(...){
+            std::lock_guard lk(mtx);
+            if(!failure){ failure = std::current_exception(); }
+        }
+        if(remaining.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            std::lock_guard lk(mtx);
+            doneCv.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::workerLoop(std::stop_token stopToken, size_t worker){
+    uint64_t seen = 0;
+    while(true){
+        {
+            std::unique_lock lk(mtx);
+            wakeCv.wait(lk, [&]{ return stopToken.stop_requested() || generation != seen; });
+            if(stopToken.stop_requested()){ return; }
+            seen = generation;
+        }
+        work(worker);
+    }
+}
+
+void WorkStealingPool::run(size_t count, const TaskFn& fn){
+    if(!count){ return; }
+
+    job = &fn;
+    failure = nullptr;
+    remaining.store(count, std::memory_order_relaxed);
+    for(size_t t = 0; t < count; ++t){
+        WorkerQueue& q = *queues[t % queues.size()];
+        std::lock_guard lk(q.mtx);
+        q.tasks.push_back(t);
+    }
+    {
+        std::lock_guard lk(mtx);
+        ++generation;
+        wakeCv.notify_all();
+    }
+
+    work(0);
+
+    std::unique_lock lk(mtx);
+    doneCv.wait(lk, [&]{ return remaining.load(std::memory_order_acquire) == 0; });
+    job = nullptr;
+    if(failure){ std::rethrow_exception(std::exchange(failure, nullptr)); }
+}
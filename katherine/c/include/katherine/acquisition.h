@@ -96,6 +96,18 @@ typedef struct katherine_acquisition {
     int completed_frames;
     size_t dropped_measurement_data;
 
+    // Batched receive statistics (see katherine_udp_recv_batch).
+    size_t recv_calls;
+    size_t recv_datagrams;
+    size_t recv_last_batch;
+    size_t recv_batch_hist[KATHERINE_UDP_BATCH_MAX + 1];
+    size_t recv_truncated; // datagrams longer than a receive slot, cut short
+
+    // Dedicated receiver thread (see katherine_acquisition_set_recv_thread).
+    bool recv_thread_enabled;
+    size_t recv_ring_dropped;
+    size_t recv_ring_peak;
+
     time_t acq_start_time;
     int report_timeout;
     int fail_timeout;
@@ -114,6 +126,9 @@ katherine_acquisition_init(katherine_acquisition_t *acq, katherine_device_t *dev
 void
 katherine_acquisition_fini(katherine_acquisition_t *acq);
 
+int
+katherine_acquisition_set_recv_thread(katherine_acquisition_t *acq, bool enabled);
+
 int
 katherine_acquisition_begin(katherine_acquisition_t *acq, const katherine_config_t *config, char readout_mode, katherine_acquisition_mode_t acq_mode, bool fast_vco_enabled, bool decode_data);
 
@@ -126,6 +141,15 @@ katherine_acquisition_stop(katherine_acquisition_t *acq);
 int
 katherine_acquisition_read(katherine_acquisition_t *acq);
 
+int
+katherine_acquisition_replay_begin(katherine_acquisition_t *acq, katherine_acquisition_mode_t acq_mode, bool fast_vco_enabled);
+
+int
+katherine_acquisition_decode(katherine_acquisition_t *acq, const char *data, size_t count);
+
+void
+katherine_acquisition_replay_end(katherine_acquisition_t *acq);
+
 const char *
 katherine_str_acquisition_status(char status);
 
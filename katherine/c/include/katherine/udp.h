@@ -22,6 +22,12 @@
 // Uncomment the following line to enable network trace:
 // #define KATHERINE_DEBUG_UDP 2
 
+// Maximum number of datagrams fetched by a single katherine_udp_recv_batch call.
+#define KATHERINE_UDP_BATCH_MAX 64
+
+// Size of a single datagram slot used by katherine_udp_recv_batch (max. UDP payload).
+#define KATHERINE_UDP_DATAGRAM_MAX 65536
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -41,6 +47,9 @@ katherine_udp_recv_exact(katherine_udp_t* u, void* data, size_t count);
     int
 katherine_udp_recv(katherine_udp_t* u, void* data, size_t* count);
 
+    int
+katherine_udp_recv_batch(katherine_udp_t* u, void* data, size_t slot_size, size_t* counts, size_t* n_msgs, size_t* n_truncated);
+
     int
 katherine_udp_mutex_lock(katherine_udp_t *u);
 
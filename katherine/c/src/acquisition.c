@@ -14,6 +14,7 @@
 #include <katherine/acquisition.h>
 #include "command_interface.h"
 #include "md.h"
+#include "md_ring.h"
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
@@ -107,6 +108,28 @@ handle_unknown_msg(katherine_acquisition_t *acq, const uint64_t *data)
     ++acq->dropped_measurement_data;
 }
 
+static inline void
+handle_recv_idle(katherine_acquisition_t *acq, time_t last_data_received, double kill_off_time)
+{
+    double duration = 1000 * difftime(time(NULL), last_data_received);
+    if (acq->report_timeout > 0 && duration > acq->report_timeout && acq->pixel_buffer_valid > 0) {
+        flush_buffer(acq);
+    }
+    if (duration > acq->lack_of_hit_timeout) {
+        printf("timeout between hits\n");
+        acq->state = ACQUISITION_TIMED_OUT;
+    }
+
+    duration = difftime(time(NULL), acq->acq_start_time);
+    if (kill_off_time > 0 && duration > kill_off_time) {
+        acq->state = ACQUISITION_TIMED_OUT;
+    }
+
+    if (!acq->decode_data && acq->aborted) {
+        acq->state = ACQUISITION_SUCCEEDED;
+    }
+}
+
 #ifdef KATHERINE_DEBUG_ACQ
 static inline void
 dump_config(const katherine_acquisition_t *acq, const katherine_config_t *config)
@@ -209,6 +232,8 @@ katherine_acquisition_init(katherine_acquisition_t *acq, katherine_device_t *dev
         goto err_pixel_buffer;
     }
 
+    acq->recv_thread_enabled = false;
+
     acq->report_timeout = report_timeout;
     acq->fail_timeout = fail_timeout;
     acq->lack_of_hit_timeout = lack_of_hit_timeout;
@@ -272,51 +297,55 @@ katherine_acquisition_fini(katherine_acquisition_t *acq)
         if (katherine_udp_mutex_lock(&acq->device->data_socket) != 0) return 1;\
         \
         time_t last_data_received = time(NULL);\
-        double duration;\
         double kill_off_time = acq->fail_timeout <= 0 ? -1 : acq->requested_frames * acq->requested_frame_duration + (double) acq->fail_timeout / 1000.0;\
         int res;\
         \
         size_t i;\
-        size_t received;\
+        size_t m;\
+        size_t n_msgs;\
+        size_t n_truncated;\
+        size_t counts[KATHERINE_UDP_BATCH_MAX];\
+        \
+        /* Split the MD buffer into datagram slots, one per batched datagram. */\
+        size_t slot_size = KATHERINE_UDP_DATAGRAM_MAX;\
+        size_t n_slots = acq->md_buffer_size / slot_size;\
+        if (n_slots > KATHERINE_UDP_BATCH_MAX) {\
+            n_slots = KATHERINE_UDP_BATCH_MAX;\
+        } else if (n_slots == 0) {\
+            n_slots = 1;\
+            slot_size = acq->md_buffer_size;\
+        }\
         \
         acq->pixel_buffer_valid = 0;\
         acq->pixel_buffer_max_valid = acq->pixel_buffer_size / PIXEL_SIZE;\
         \
         while (acq->state == ACQUISITION_RUNNING) {\
-            received = acq->md_buffer_size;\
-            res = katherine_udp_recv(&acq->device->data_socket, acq->md_buffer, &received);\
+            n_msgs = n_slots;\
+            res = katherine_udp_recv_batch(&acq->device->data_socket, acq->md_buffer, slot_size, counts, &n_msgs, &n_truncated);\
             \
             if (res) {\
-                duration = 1000 * difftime(time(NULL), last_data_received);\
-                if (acq->report_timeout > 0 && duration > acq->report_timeout && acq->pixel_buffer_valid > 0) {\
-                    flush_buffer(acq);\
-                }\
-                if (duration > acq->lack_of_hit_timeout) {\
-                    printf("timeout between hits\n");\
-                    acq->state = ACQUISITION_TIMED_OUT;\
-                }\
-                \
-                duration = difftime(time(NULL), acq->acq_start_time);\
-                if (kill_off_time > 0 && duration > kill_off_time) {\
-                    acq->state = ACQUISITION_TIMED_OUT;\
-                }\
-                \
-                if(!acq->decode_data && acq->aborted) {		\
-                    acq->state = ACQUISITION_SUCCEEDED;\
-                }				     \
-                \
+                handle_recv_idle(acq, last_data_received, kill_off_time);\
                 continue;\
             }\
             \
             last_data_received = time(NULL);\
             \
-            if(acq->decode_data) {\
-                const char *it = acq->md_buffer;\
-                    for (i = 0; i < received; i += KATHERINE_MD_SIZE, it += KATHERINE_MD_SIZE) { \
+            ++acq->recv_calls;\
+            acq->recv_datagrams += n_msgs;\
+            acq->recv_last_batch = n_msgs;\
+            ++acq->recv_batch_hist[n_msgs];\
+            acq->recv_truncated += n_truncated;\
+            \
+            for (m = 0; m < n_msgs; ++m) {\
+                const char *slot = acq->md_buffer + m * slot_size;\
+                if(acq->decode_data) {\
+                    const char *it = slot;\
+                    for (i = 0; i < counts[m]; i += KATHERINE_MD_SIZE, it += KATHERINE_MD_SIZE) { \
                         handle_measurement_data_##SUFFIX(acq, (const uint64_t *) it);\
                     }\
-            } else {\
-                    acq->handlers.data_received(acq->user_ctx, acq->md_buffer, received);\
+                } else {\
+                    acq->handlers.data_received(acq->user_ctx, slot, counts[m]);\
+                }\
             }\
         }\
         \
@@ -326,6 +355,24 @@ katherine_acquisition_fini(katherine_acquisition_t *acq)
         case ACQUISITION_TIMED_OUT:     return ETIMEDOUT;\
         default:                        return EAGAIN;\
         }\
+    }\
+    \
+    static void\
+    acquisition_decode_##SUFFIX(katherine_acquisition_t *acq, const char *data, size_t count)\
+    {\
+        static const int PIXEL_SIZE = sizeof(katherine_px_##SUFFIX##_t);\
+        \
+        size_t i;\
+        uint64_t md;\
+        \
+        acq->pixel_buffer_max_valid = acq->pixel_buffer_size / PIXEL_SIZE;\
+        \
+        /* Caller buffers need not be padded to 8 bytes, copy each MD out. */\
+        for (i = 0; i + KATHERINE_MD_SIZE <= count; i += KATHERINE_MD_SIZE) {\
+            md = 0;\
+            memcpy(&md, data + i, KATHERINE_MD_SIZE);\
+            handle_measurement_data_##SUFFIX(acq, &md);\
+        }\
     }
 
 DEFINE_ACQ_IMPL(f_toa_tot)
@@ -335,6 +382,94 @@ DEFINE_ACQ_IMPL(toa_only)
 DEFINE_ACQ_IMPL(f_event_itot)
 DEFINE_ACQ_IMPL(event_itot)
 
+#ifdef KATHERINE_NIX
+
+/* Threaded variant of acquisition_read_*: a receiver thread drains the
+ * data socket into the MD ring (see md_ring.h) while the calling thread
+ * decodes MD's and runs the handlers, so a slow handler never stalls
+ * the socket. */
+#define DEFINE_ACQ_THREADED_IMPL(SUFFIX) \
+    static int\
+    acquisition_read_threaded_##SUFFIX(katherine_acquisition_t *acq)\
+    {\
+        static const int PIXEL_SIZE = sizeof(katherine_px_##SUFFIX##_t);\
+        \
+        if (katherine_udp_mutex_lock(&acq->device->data_socket) != 0) return 1;\
+        \
+        time_t last_data_received = time(NULL);\
+        double kill_off_time = acq->fail_timeout <= 0 ? -1 : acq->requested_frames * acq->requested_frame_duration + (double) acq->fail_timeout / 1000.0;\
+        int res;\
+        \
+        size_t i;\
+        size_t head;\
+        size_t tail;\
+        katherine_md_ring_t ring;\
+        \
+        acq->pixel_buffer_valid = 0;\
+        acq->pixel_buffer_max_valid = acq->pixel_buffer_size / PIXEL_SIZE;\
+        \
+        if ((res = katherine_md_ring_start(&ring, acq)) != 0) {\
+            (void) katherine_udp_mutex_unlock(&acq->device->data_socket);\
+            return res;\
+        }\
+        \
+        while (acq->state == ACQUISITION_RUNNING) {\
+            if (katherine_md_ring_fill(&ring) == 0 && !katherine_md_ring_wait(&ring, KATHERINE_MD_RING_WAIT_MS)) {\
+                handle_recv_idle(acq, last_data_received, kill_off_time);\
+                continue;\
+            }\
+            \
+            last_data_received = time(NULL);\
+            \
+            head = atomic_load_explicit(&ring.head, memory_order_acquire);\
+            tail = atomic_load_explicit(&ring.tail, memory_order_relaxed);\
+            for (; tail != head && acq->state == ACQUISITION_RUNNING; ++tail) {\
+                const char *slot = katherine_md_ring_slot(&ring, tail);\
+                size_t count = ring.lengths[tail % ring.n_slots];\
+                if(acq->decode_data) {\
+                    const char *it = slot;\
+                    for (i = 0; i < count; i += KATHERINE_MD_SIZE, it += KATHERINE_MD_SIZE) { \
+                        handle_measurement_data_##SUFFIX(acq, (const uint64_t *) it);\
+                    }\
+                } else {\
+                    acq->handlers.data_received(acq->user_ctx, slot, count);\
+                }\
+                /* Hand the slot back to the receiver thread. */\
+                atomic_store_explicit(&ring.tail, tail + 1, memory_order_release);\
+            }\
+        }\
+        \
+        katherine_md_ring_stop(&ring);\
+        acq->recv_ring_dropped = ring.dropped_datagrams;\
+        acq->recv_ring_peak = ring.peak_fill;\
+        acq->dropped_measurement_data += ring.dropped_bytes / KATHERINE_MD_SIZE;\
+        \
+        (void) katherine_udp_mutex_unlock(&acq->device->data_socket);\
+        switch (acq->state) {\
+        case ACQUISITION_SUCCEEDED:     return 0;\
+        case ACQUISITION_TIMED_OUT:     return ETIMEDOUT;\
+        default:                        return EAGAIN;\
+        }\
+    }
+
+DEFINE_ACQ_THREADED_IMPL(f_toa_tot)
+DEFINE_ACQ_THREADED_IMPL(toa_tot)
+DEFINE_ACQ_THREADED_IMPL(f_toa_only)
+DEFINE_ACQ_THREADED_IMPL(toa_only)
+DEFINE_ACQ_THREADED_IMPL(f_event_itot)
+DEFINE_ACQ_THREADED_IMPL(event_itot)
+
+#undef DEFINE_ACQ_THREADED_IMPL
+
+#define ACQ_READ(SUFFIX) \
+    (acq->recv_thread_enabled ? acquisition_read_threaded_##SUFFIX(acq) : acquisition_read_##SUFFIX(acq))
+
+#else
+
+#define ACQ_READ(SUFFIX) acquisition_read_##SUFFIX(acq)
+
+#endif /* KATHERINE_NIX */
+
 #undef DEFINE_ACQ_IMPL
 
 /**
@@ -348,23 +483,23 @@ katherine_acquisition_read(katherine_acquisition_t *acq)
     switch (acq->acq_mode) {
     case ACQUISITION_MODE_TOA_TOT:
         if (acq->fast_vco_enabled) {
-            return acquisition_read_f_toa_tot(acq);
+            return ACQ_READ(f_toa_tot);
         } else {
-            return acquisition_read_toa_tot(acq);
+            return ACQ_READ(toa_tot);
         }
 
     case ACQUISITION_MODE_ONLY_TOA:
         if (acq->fast_vco_enabled) {
-            return acquisition_read_f_toa_only(acq);
+            return ACQ_READ(f_toa_only);
         } else {
-            return acquisition_read_toa_only(acq);
+            return ACQ_READ(toa_only);
         }
 
     case ACQUISITION_MODE_EVENT_ITOT:
         if (acq->fast_vco_enabled) {
-            return acquisition_read_f_event_itot(acq);
+            return ACQ_READ(f_event_itot);
         } else {
-            return acquisition_read_event_itot(acq);
+            return ACQ_READ(event_itot);
         }
 
     default:
@@ -372,6 +507,121 @@ katherine_acquisition_read(katherine_acquisition_t *acq)
     }
 }
 
+#undef ACQ_READ
+
+/**
+ * Prepare an acquisition for decoding measurement data supplied by the
+ * caller (see katherine_acquisition_decode) instead of read from a device,
+ * e.g. to replay a capture. No commands are sent; the acquisition may have
+ * been initialized without a device.
+ * @param acq Acquisition
+ * @param acq_mode Acquisition mode the data was recorded in
+ * @param fast_vco_enabled Whether the data was recorded with fast VCO
+ * @return Error code.
+ */
+int
+katherine_acquisition_replay_begin(katherine_acquisition_t *acq, katherine_acquisition_mode_t acq_mode, bool fast_vco_enabled)
+{
+    acq->acq_mode = acq_mode;
+    acq->readout_mode = READOUT_DATA_DRIVEN;
+    acq->fast_vco_enabled = fast_vco_enabled;
+    acq->decode_data = true;
+    acq->aborted = false;
+
+    acq->state = ACQUISITION_RUNNING;
+    acq->completed_frames = 0;
+    acq->requested_frames = 1;
+    acq->requested_frame_duration = 0;
+    acq->dropped_measurement_data = 0;
+
+    acq->pixel_buffer_valid = 0;
+    acq->pixel_buffer_max_valid = 0;
+    acq->last_toa_offset = 0;
+    acq->acq_start_time = time(NULL);
+
+    memset(&acq->current_frame_info, 0, sizeof(katherine_frame_info_t));
+    return 0;
+}
+
+/**
+ * Decode measurement data as if it had been received from the device,
+ * running the acquisition handlers. Used to replay captures, or from a
+ * data_received handler to decode while capturing (decode_data false).
+ * @param acq Acquisition (begun, or prepared by katherine_acquisition_replay_begin)
+ * @param data Measurement data, a multiple of KATHERINE_MD_SIZE bytes
+ * @param count Number of bytes in data
+ * @return Error code.
+ */
+int
+katherine_acquisition_decode(katherine_acquisition_t *acq, const char *data, size_t count)
+{
+    switch (acq->acq_mode) {
+    case ACQUISITION_MODE_TOA_TOT:
+        if (acq->fast_vco_enabled) {
+            acquisition_decode_f_toa_tot(acq, data, count);
+        } else {
+            acquisition_decode_toa_tot(acq, data, count);
+        }
+        return 0;
+
+    case ACQUISITION_MODE_ONLY_TOA:
+        if (acq->fast_vco_enabled) {
+            acquisition_decode_f_toa_only(acq, data, count);
+        } else {
+            acquisition_decode_toa_only(acq, data, count);
+        }
+        return 0;
+
+    case ACQUISITION_MODE_EVENT_ITOT:
+        if (acq->fast_vco_enabled) {
+            acquisition_decode_f_event_itot(acq, data, count);
+        } else {
+            acquisition_decode_event_itot(acq, data, count);
+        }
+        return 0;
+
+    default:
+        return EINVAL;
+    }
+}
+
+/**
+ * Hand pixels still buffered after a replay to the pixels_received handler
+ * (a replay cut short before its frame finished MD leaves some behind).
+ * @param acq Acquisition
+ */
+void
+katherine_acquisition_replay_end(katherine_acquisition_t *acq)
+{
+    if (acq->pixel_buffer_valid > 0) {
+        flush_buffer(acq);
+    }
+}
+
+/**
+ * Enable or disable the dedicated receiver thread.
+ *
+ * When enabled, katherine_acquisition_read spawns a thread which only
+ * drains the data socket into a ring of datagram slots carved out of
+ * the MD buffer; the calling thread decodes them. The MD buffer must
+ * hold at least two KATHERINE_UDP_DATAGRAM_MAX slots.
+ *
+ * @param acq Acquisition
+ * @param enabled True to receive on a dedicated thread
+ * @return Error code (ENOTSUP if the platform lacks support).
+ */
+int
+katherine_acquisition_set_recv_thread(katherine_acquisition_t *acq, bool enabled)
+{
+#ifdef KATHERINE_NIX
+    acq->recv_thread_enabled = enabled;
+    return 0;
+#else
+    acq->recv_thread_enabled = false;
+    return enabled ? ENOTSUP : 0;
+#endif
+}
+
 /**
  * Set detector configuration and begin acquisition.
  * @param acq Acquisition
@@ -416,6 +666,14 @@ katherine_acquisition_begin(katherine_acquisition_t *acq, const katherine_config
     acq->requested_frame_duration = config->acq_time / 1e9;
     acq->dropped_measurement_data = 0;
 
+    acq->recv_calls = 0;
+    acq->recv_datagrams = 0;
+    acq->recv_last_batch = 0;
+    memset(acq->recv_batch_hist, 0, sizeof(acq->recv_batch_hist));
+    acq->recv_truncated = 0;
+    acq->recv_ring_dropped = 0;
+    acq->recv_ring_peak = 0;
+
     acq->pixel_buffer_valid = 0;
     acq->pixel_buffer_max_valid = 0;
     acq->last_toa_offset = 0;
@@ -0,0 +1,249 @@
+/* Katherine Control Library
+ *
+ * Contents of this file are copyrighted and subject to license
+ * conditions specified in the LICENSE file located in the top
+ * directory.
+ */
+
+#pragma once
+
+/*
+ * IMPORTANT NOTICE:
+ *
+ * The following interface is internal.
+ * It is not intended for user application access.
+ */
+
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+
+#include <katherine/global.h>
+
+#ifdef KATHERINE_NIX
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <katherine/acquisition.h>
+
+/* The MD ring decouples socket draining from MD decoding.
+ *
+ * A dedicated receiver thread (the single producer) pulls
+ * datagrams off the data socket straight into fixed-size
+ * slots carved out of the acquisition's MD buffer. The
+ * thread calling katherine_acquisition_read (the single
+ * consumer) decodes the slots and runs the user handlers.
+ *
+ * The head and tail counters increase monotonically; a slot
+ * index is obtained modulo n_slots. They live on separate
+ * cache lines so that producer and consumer do not contend.
+ *
+ * The condition variable is only touched when the consumer
+ * has run out of data and announced itself via the waiting
+ * flag, so the hot path is free of locks.
+ *
+ * One extra slot past the ring is reserved as a scratch area.
+ * When the ring is full the receiver keeps draining the socket
+ * into the scratch slot and counts the datagrams as dropped,
+ * rather than letting the kernel buffer overflow silently.
+ */
+
+#define KATHERINE_MD_RING_CACHE_LINE 64
+
+// How long an idle consumer sleeps before re-checking its timeouts (ms).
+#define KATHERINE_MD_RING_WAIT_MS 100
+
+typedef struct katherine_md_ring {
+    katherine_acquisition_t *acq;
+
+    char *slots;
+    size_t slot_size;
+    size_t n_slots;
+    size_t *lengths;
+
+    _Alignas(KATHERINE_MD_RING_CACHE_LINE) atomic_size_t head;
+    _Alignas(KATHERINE_MD_RING_CACHE_LINE) atomic_size_t tail;
+    _Alignas(KATHERINE_MD_RING_CACHE_LINE) atomic_bool consumer_waiting;
+    atomic_bool stop;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t thread;
+
+    // Written by the receiver thread only, read after it has been joined.
+    size_t dropped_datagrams;
+    size_t dropped_bytes;
+    size_t peak_fill;
+} katherine_md_ring_t;
+
+static inline size_t
+katherine_md_ring_fill(katherine_md_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->head, memory_order_acquire)
+         - atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+static inline char *
+katherine_md_ring_slot(katherine_md_ring_t *ring, size_t counter)
+{
+    return ring->slots + (counter % ring->n_slots) * ring->slot_size;
+}
+
+static inline void *
+katherine_md_ring_receive(void *arg)
+{
+    katherine_md_ring_t *ring = (katherine_md_ring_t *) arg;
+    katherine_udp_t *sock = &ring->acq->device->data_socket;
+    char *scratch = ring->slots + ring->n_slots * ring->slot_size;
+    size_t scratch_counts[KATHERINE_UDP_BATCH_MAX];
+    size_t n_msgs, n_truncated;
+
+    while (!atomic_load_explicit(&ring->stop, memory_order_relaxed)) {
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        size_t free_slots = ring->n_slots - (head - tail);
+
+        if (free_slots == 0) {
+            n_msgs = 1;
+            if (katherine_udp_recv_batch(sock, scratch, ring->slot_size, scratch_counts, &n_msgs, &n_truncated) == 0) {
+                ++ring->dropped_datagrams;
+                ring->dropped_bytes += scratch_counts[0];
+            }
+            continue;
+        }
+
+        // Only fill contiguous slots, the batch must not wrap around.
+        size_t first = head % ring->n_slots;
+        n_msgs = ring->n_slots - first;
+        if (n_msgs > free_slots) n_msgs = free_slots;
+        if (n_msgs > KATHERINE_UDP_BATCH_MAX) n_msgs = KATHERINE_UDP_BATCH_MAX;
+
+        if (katherine_udp_recv_batch(sock, ring->slots + first * ring->slot_size, ring->slot_size, ring->lengths + first, &n_msgs, &n_truncated) != 0) {
+            // Timeout, the consumer keeps track of inactivity.
+            continue;
+        }
+
+        ++ring->acq->recv_calls;
+        ring->acq->recv_datagrams += n_msgs;
+        ring->acq->recv_last_batch = n_msgs;
+        ++ring->acq->recv_batch_hist[n_msgs];
+        ring->acq->recv_truncated += n_truncated;
+
+        atomic_store_explicit(&ring->head, head + n_msgs, memory_order_seq_cst);
+
+        size_t fill = head + n_msgs - tail;
+        if (fill > ring->peak_fill) ring->peak_fill = fill;
+
+        if (atomic_load_explicit(&ring->consumer_waiting, memory_order_seq_cst)) {
+            pthread_mutex_lock(&ring->mutex);
+            pthread_cond_signal(&ring->cond);
+            pthread_mutex_unlock(&ring->mutex);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Block the consumer until the ring holds data or timeout_ms elapses.
+ * @return true if data is available.
+ */
+static inline bool
+katherine_md_ring_wait(katherine_md_ring_t *ring, int timeout_ms)
+{
+    atomic_store_explicit(&ring->consumer_waiting, true, memory_order_seq_cst);
+
+    pthread_mutex_lock(&ring->mutex);
+    if (atomic_load_explicit(&ring->head, memory_order_seq_cst) == atomic_load_explicit(&ring->tail, memory_order_relaxed)) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long) (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            ++deadline.tv_sec;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        (void) pthread_cond_timedwait(&ring->cond, &ring->mutex, &deadline);
+    }
+    pthread_mutex_unlock(&ring->mutex);
+
+    atomic_store_explicit(&ring->consumer_waiting, false, memory_order_relaxed);
+    return katherine_md_ring_fill(ring) > 0;
+}
+
+/**
+ * Carve the ring out of the acquisition's MD buffer and launch the receiver thread.
+ * @return Error code.
+ */
+static inline int
+katherine_md_ring_start(katherine_md_ring_t *ring, katherine_acquisition_t *acq)
+{
+    int res;
+
+    ring->acq = acq;
+    ring->slots = acq->md_buffer;
+    ring->slot_size = KATHERINE_UDP_DATAGRAM_MAX;
+
+    // One slot is kept back as the overflow scratch area.
+    size_t total_slots = acq->md_buffer_size / ring->slot_size;
+    if (total_slots < 2) {
+        return ENOMEM;
+    }
+    ring->n_slots = total_slots - 1;
+
+    ring->lengths = (size_t *) malloc(ring->n_slots * sizeof(size_t));
+    if (ring->lengths == NULL) {
+        return ENOMEM;
+    }
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->consumer_waiting, false);
+    atomic_init(&ring->stop, false);
+    ring->dropped_datagrams = 0;
+    ring->dropped_bytes = 0;
+    ring->peak_fill = 0;
+
+    if ((res = pthread_mutex_init(&ring->mutex, NULL)) != 0) {
+        goto err_mutex;
+    }
+
+    if ((res = pthread_cond_init(&ring->cond, NULL)) != 0) {
+        goto err_cond;
+    }
+
+    if ((res = pthread_create(&ring->thread, NULL, katherine_md_ring_receive, ring)) != 0) {
+        goto err_thread;
+    }
+
+    return 0;
+
+err_thread:
+    pthread_cond_destroy(&ring->cond);
+err_cond:
+    pthread_mutex_destroy(&ring->mutex);
+err_mutex:
+    free(ring->lengths);
+    return res;
+}
+
+/**
+ * Stop and join the receiver thread, release the ring.
+ */
+static inline void
+katherine_md_ring_stop(katherine_md_ring_t *ring)
+{
+    atomic_store_explicit(&ring->stop, true, memory_order_relaxed);
+    (void) pthread_join(ring->thread, NULL);
+
+    pthread_cond_destroy(&ring->cond);
+    pthread_mutex_destroy(&ring->mutex);
+    free(ring->lengths);
+}
+
+#endif /* KATHERINE_NIX */
+
+#endif /* DOXYGEN_SHOULD_SKIP_THIS */
@@ -7,6 +7,11 @@
  * directory.
  */
 
+#ifdef __linux__
+// Required for recvmmsg(2).
+#define _GNU_SOURCE
+#endif
+
 #include <katherine/global.h>
 
 #ifdef KATHERINE_NIX
@@ -62,6 +67,18 @@ katherine_udp_init(katherine_udp_t *u, uint16_t local_port, const char *remote_a
         goto err_socket;
     }
 
+#ifdef KATHERINE_UDP_REUSEADDR
+    // Allow a local device emulator to listen on the same port of another
+    // (loopback) address. Only enabled on request (KATHERINE_EMULATOR):
+    // otherwise a second process binding the port would silently take a share
+    // of the datagrams.
+    int reuse = 1;
+    if (setsockopt(u->sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1) {
+        res = errno;
+        goto err_bind;
+    }
+#endif
+
     // Setup and bind the socket address.
     u->addr_local.sin_family = AF_INET;
     u->addr_local.sin_port = htons(local_port);
@@ -211,6 +228,77 @@ katherine_udp_recv(katherine_udp_t* u, void* data, size_t* count)
     return 0;
 }
 
+/**
+ * Receive a batch of messages (unreliable).
+ *
+ * Blocks until at least one datagram arrives (or the socket timeout expires),
+ * then collects every further datagram already queued on the socket, up to
+ * the given limit, in the same system call. Datagram i is stored at
+ * data + i * slot_size.
+ *
+ * @param u UDP session
+ * @param data Inbound buffer start (at least *n_msgs * slot_size bytes)
+ * @param slot_size Space reserved for each datagram in bytes
+ * @param counts Output array receiving the length of each datagram
+ * @param n_msgs Max. number of datagrams on input, received datagrams on output
+ * @param n_truncated Output number of datagrams cut short because they exceeded slot_size
+ * @return Error code.
+ */
+int
+katherine_udp_recv_batch(katherine_udp_t* u, void* data, size_t slot_size, size_t* counts, size_t* n_msgs, size_t* n_truncated)
+{
+    *n_truncated = 0;
+
+#ifdef __linux__
+    struct mmsghdr msgs[KATHERINE_UDP_BATCH_MAX];
+    struct iovec iovecs[KATHERINE_UDP_BATCH_MAX];
+    size_t i;
+
+    size_t vlen = *n_msgs;
+    if (vlen > KATHERINE_UDP_BATCH_MAX) {
+        vlen = KATHERINE_UDP_BATCH_MAX;
+    }
+
+    memset(msgs, 0, vlen * sizeof(struct mmsghdr));
+    for (i = 0; i < vlen; ++i) {
+        iovecs[i].iov_base = (char *) data + i * slot_size;
+        iovecs[i].iov_len = slot_size;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // MSG_WAITFORONE: block (honoring SO_RCVTIMEO) for the first datagram only.
+    int received = recvmmsg(u->sock, msgs, (unsigned int) vlen, MSG_WAITFORONE, NULL);
+    if (received == -1) {
+        return errno;
+    }
+
+    for (i = 0; i < (size_t) received; ++i) {
+        counts[i] = msgs[i].msg_len;
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            ++*n_truncated;
+        }
+
+#ifdef KATHERINE_DEBUG_UDP
+        dump_buffer("Received:", iovecs[i].iov_base, counts[i]);
+#endif /* KATHERINE_DEBUG_UDP */
+    }
+
+    *n_msgs = (size_t) received;
+    return 0;
+#else
+    // No recvmmsg(2) on this platform, fall back to one datagram per call.
+    int res;
+    counts[0] = slot_size;
+    if ((res = katherine_udp_recv(u, data, &counts[0])) != 0) {
+        return res;
+    }
+
+    *n_msgs = 1;
+    return 0;
+#endif
+}
+
 /**
  * Lock mutual exclusion synchronization primitive.
  * @param u UDP session
@@ -249,6 +249,35 @@ katherine_udp_recv(katherine_udp_t* u, void* data, size_t* count)
     return 0;
 }
 
+/**
+ * Receive a batch of messages (unreliable).
+ *
+ * Winsock offers no multi-datagram receive, so this receives exactly one
+ * datagram into the first slot.
+ *
+ * @param u UDP session
+ * @param data Inbound buffer start (at least slot_size bytes)
+ * @param slot_size Space reserved for each datagram in bytes
+ * @param counts Output array receiving the length of each datagram
+ * @param n_msgs Max. number of datagrams on input, received datagrams on output
+ * @param n_truncated Output number of datagrams cut short because they exceeded slot_size
+ * @return Error code.
+ */
+int
+katherine_udp_recv_batch(katherine_udp_t* u, void* data, size_t slot_size, size_t* counts, size_t* n_msgs, size_t* n_truncated)
+{
+    int res;
+
+    *n_truncated = 0;
+    counts[0] = slot_size;
+    if ((res = katherine_udp_recv(u, data, &counts[0])) != 0) {
+        return res;
+    }
+
+    *n_msgs = 1;
+    return 0;
+}
+
 /**
  * Lock mutual exclusion synchronization primitive.
  * @param u UDP session
@@ -107,6 +107,30 @@ public:
         };
     }
 
+    // Acquisition without a device, for decoding replayed measurement data
+    // (see replay_begin and decode).
+    base_acquisition(std::size_t pixel_buffer_size, acq_mode mode, bool fast_vco_enabled)
+        :acq_{},
+         mode_{mode},
+         fast_vco_enabled_{fast_vco_enabled},
+         decode_data_{true},
+         frame_started_handler_{[](int){ }},
+         frame_ended_handler_{[](int, bool, const katherine::frame_info&){ }},
+         data_received_handler_{[](const char*, size_t){ }}
+    {
+        int res = katherine_acquisition_init(&acq_, nullptr, reinterpret_cast<void*>(this), md_size, pixel_buffer_size, 0, 0, 0);
+        if (res != 0) {
+            throw katherine::system_error{res};
+        }
+
+        acq_.handlers = {
+            /* .pixels_received = */ nullptr,
+            /* .frame_started = */ base_acquisition::forward_frame_started,
+            /* .frame_ended = */ base_acquisition::forward_frame_ended,
+            /* .data_received = */ base_acquisition::forward_data_received
+        };
+    }
+
     virtual ~base_acquisition()
     {
         katherine_acquisition_fini(&acq_);
@@ -130,6 +154,16 @@ public:
         data_received_handler_ = std::move(fn);
     }
 
+    void
+    set_recv_thread(bool enabled)
+    {
+        int res = katherine_acquisition_set_recv_thread(&acq_, enabled);
+
+        if (res != 0) {
+            throw katherine::system_error{res};
+        }
+    }
+
     void
     begin(const katherine::config& config, katherine::readout_type readout_type)
     {
@@ -171,11 +205,44 @@ public:
         }
     }
 
+    void
+    replay_begin()
+    {
+        int res = katherine_acquisition_replay_begin(&acq_, (katherine_acquisition_mode_t) mode_, fast_vco_enabled_);
+
+        if (res != 0) {
+            throw katherine::system_error{res};
+        }
+    }
+
+    void
+    decode(const char *data, std::size_t count)
+    {
+        int res = katherine_acquisition_decode(&acq_, data, count);
+
+        if (res != 0) {
+            throw katherine::system_error{res};
+        }
+    }
+
+    void
+    replay_end()
+    {
+        katherine_acquisition_replay_end(&acq_);
+    }
+
     acq_state state() const                         { return (acq_state) acq_.state; }
     bool aborted() const                            { return acq_.aborted; }
     int requested_frames() const                    { return acq_.requested_frames; }
     int completed_frames() const                    { return acq_.completed_frames; }
     std::size_t dropped_measurement_data() const    { return acq_.dropped_measurement_data; }
+    std::size_t recv_calls() const                  { return acq_.recv_calls; }
+    std::size_t recv_datagrams() const              { return acq_.recv_datagrams; }
+    std::size_t recv_last_batch() const             { return acq_.recv_last_batch; }
+    const std::size_t *recv_batch_histogram() const { return acq_.recv_batch_hist; }
+    std::size_t recv_truncated() const              { return acq_.recv_truncated; }
+    std::size_t recv_ring_dropped() const           { return acq_.recv_ring_dropped; }
+    std::size_t recv_ring_peak() const              { return acq_.recv_ring_peak; }
 
 };
 
@@ -247,6 +314,13 @@ public:
         acq_.handlers.pixels_received = acquisition::forward_pixels_received;
     }
 
+    explicit acquisition(std::size_t pixel_buffer_size)
+      :base_acquisition{pixel_buffer_size, AcqMode::mode, AcqMode::fast_vco_enabled},
+         pixels_received_handler_{[](const pixel_type *, std::size_t){ }}
+    {
+        acq_.handlers.pixels_received = acquisition::forward_pixels_received;
+    }
+
     void
     set_pixels_received_handler(pixels_received_handler&& fn)
     {
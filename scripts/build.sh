@@ -10,8 +10,14 @@ done
 mkdir -p build
 cd build
 
+# emulator port sharing is never left on from an earlier configure
+emu=OFF
 cmake -DCMAKE_BUILD_TYPE=Debug ..
 for arg in "$@"; do
+    if [ "$arg" = "-emu" ]; then
+        emu=ON
+        continue
+    fi
     if [ "$arg" = "-min" ]; then
         cmake -DMAKE_MIN:BOOL=ON ..
         continue
@@ -25,6 +31,6 @@ for arg in "$@"; do
     fi
 done
 
-cmake ..
+cmake -DKATHERINE_EMULATOR:BOOL=$emu ..
 make
 cd ..
\ No newline at end of file
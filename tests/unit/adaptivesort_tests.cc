@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "AdaptiveSort.hpp"
+
+namespace {
+
+struct Item {
+  uint64_t key;
+  size_t order;
+};
+
+SortStats sortItems(const std::vector<Item>& items, std::vector<const Item*>& out,
+                    size_t window = SORT_WINDOW){
+  RadixScratch<Item> scratch;
+  return adaptiveSortPtrs(items.data(), items.size(),
+    [](const Item& it){ return it.key; }, out, scratch, window);
+}
+
+void expectSortedAndStable(const std::vector<const Item*>& out, size_t n){
+  ASSERT_EQ(out.size(), n);
+  for (size_t i = 1; i < n; ++i) {
+    ASSERT_LE(out[i-1]->key, out[i]->key);
+    if (out[i-1]->key == out[i]->key) {
+      ASSERT_LT(out[i-1]->order, out[i]->order) << "not stable";
+    }
+  }
+}
+
+} // namespace
+
+TEST(AdaptiveSortTest, sortedInputIsOneRun) {
+  std::vector<Item> items(1000);
+  for (size_t i = 0; i < items.size(); ++i) { items[i] = {i / 3, i}; }
+  std::vector<const Item*> out;
+  auto stats = sortItems(items, out);
+  expectSortedAndStable(out, items.size());
+  EXPECT_EQ(stats.runs, 1);
+  EXPECT_EQ(stats.moves, 0);
+  EXPECT_FALSE(stats.fellBack);
+}
+
+TEST(AdaptiveSortTest, localInversionsMeasured) {
+  // swap neighbours pairwise: every second element moves back by one
+  std::vector<Item> items(100);
+  for (size_t i = 0; i < items.size(); ++i) { items[i] = {i ^ 1, i}; }
+  std::vector<const Item*> out;
+  auto stats = sortItems(items, out);
+  expectSortedAndStable(out, items.size());
+  EXPECT_EQ(stats.runs, 51);
+  EXPECT_EQ(stats.moves, 50);
+  EXPECT_EQ(stats.maxDisplacement, 1);
+  EXPECT_FALSE(stats.fellBack);
+}
+
+TEST(AdaptiveSortTest, farDisplacementFallsBack) {
+  std::vector<Item> items(1000);
+  for (size_t i = 0; i < items.size(); ++i) { items[i] = {i + 10, i}; }
+  items[900].key = 0;
+  std::vector<const Item*> out;
+  auto stats = sortItems(items, out, 64);
+  expectSortedAndStable(out, items.size());
+  EXPECT_TRUE(stats.fellBack);
+  EXPECT_EQ(out[0], &items[900]);
+}
+
+TEST(AdaptiveSortTest, randomInputFallsBackAndSorts) {
+  std::mt19937_64 rng(3);
+  std::vector<Item> items(5000);
+  for (size_t i = 0; i < items.size(); ++i) { items[i] = {rng() % 1000, i}; }
+  std::vector<const Item*> out;
+  auto stats = sortItems(items, out);
+  expectSortedAndStable(out, items.size());
+  EXPECT_TRUE(stats.fellBack);
+}
+
+TEST(AdaptiveSortTest, metricsAggregate) {
+  SortMetrics metrics;
+  metrics.add({100, 1, 0, 0, false});
+  metrics.add({100, 5, 3, 7, false});
+  metrics.add({100, 50, 128, 900, true});
+  EXPECT_EQ(metrics.batches, 3);
+  EXPECT_EQ(metrics.fallbacks, 1);
+  EXPECT_EQ(metrics.moves, 907);
+  EXPECT_EQ(metrics.maxDisplacement, 128);
+  EXPECT_EQ(metrics.displacementHist[0], 1);
+  EXPECT_EQ(metrics.displacementHist[2], 1); // 2-3
+  EXPECT_EQ(metrics.displacementHist[8], 1); // 128-255
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+#include "CustomDataTypes.hpp"
+
+TEST(BroadcastRingTest, everyCursorSeesEveryElement) {
+  BroadcastRing<int> ring(2, 16);
+  int fakeData[] = {1,2,3};
+  size_t discard;
+  ring.push(fakeData, 3, discard);
+  EXPECT_EQ(discard, 0);
+
+  for (size_t c = 0; c < 2; ++c) {
+    const int* data;
+    EXPECT_EQ(ring.size(c), 3);
+    EXPECT_EQ(3, ring.peek(c, data, 3));
+    EXPECT_TRUE(0 == std::memcmp(data, fakeData, sizeof(fakeData)));
+    ring.release(c, 3);
+    EXPECT_EQ(ring.size(c), 0);
+  }
+}
+
+TEST(BroadcastRingTest, cursorsShareStorage) {
+  BroadcastRing<int> ring(2, 16);
+  int fakeData[] = {1,2,3};
+  size_t discard;
+  ring.push(fakeData, 3, discard);
+
+  const int* first;
+  const int* second;
+  ring.peek(0, first, 3);
+  ring.peek(1, second, 3);
+  EXPECT_EQ(first, second);
+}
+
+TEST(BroadcastRingTest, slowestCursorLimitsSpace) {
+  BroadcastRing<int> ring(2, 8);
+  int fakeData[8] = {0};
+  size_t discard;
+  EXPECT_EQ(8, ring.push(fakeData, 8, discard));
+  EXPECT_EQ(discard, 0);
+
+  // only the fast cursor catches up, so nothing fits yet
+  ring.release(0, 8);
+  ring.push(fakeData, 2, discard);
+  EXPECT_EQ(discard, 2);
+
+  ring.release(1, 3);
+  EXPECT_EQ(8, ring.push(fakeData, 4, discard));
+  EXPECT_EQ(discard, 1);
+  EXPECT_EQ(ring.size(0), 3);
+  EXPECT_EQ(ring.size(1), 8);
+}
+
+TEST(BroadcastRingTest, wrapAroundKeepsOrder) {
+  BroadcastRing<int> ring(1, 8);
+  int first[6] = {0,1,2,3,4,5};
+  int second[6] = {6,7,8,9,10,11};
+  size_t discard;
+  const int* data;
+
+  ring.push(first, 6, discard);
+  ring.release(0, ring.peek(0, data, 6));
+  ring.push(second, 6, discard);
+  EXPECT_EQ(discard, 0);
+
+  // readable region wraps: peek only exposes the contiguous part
+  EXPECT_EQ(2, ring.peek(0, data, 6));
+  EXPECT_EQ(data[0], 6);
+  ring.release(0, 2);
+  EXPECT_EQ(4, ring.peek(0, data, 6));
+  EXPECT_TRUE(0 == std::memcmp(data, second + 2, 4 * sizeof(int)));
+}
+
+TEST(BroadcastRingTest, concurrentConsumersGetFullStream) {
+  auto ring = std::make_shared<BroadcastRing<uint64_t>>(2, 1024);
+  constexpr uint64_t total = 1000000;
+
+  std::jthread producer([&]{
+    uint64_t next = 0;
+    uint64_t chunk[100];
+    while (next < total) {
+      size_t n = std::min<uint64_t>(100, total - next);
+      std::iota(chunk, chunk + n, next);
+      size_t discard;
+      ring->push(chunk, n, discard);
+      next += n - discard;
+      if (discard) { std::this_thread::yield(); }
+    }
+  });
+
+  auto consume = [&](size_t cursor, uint64_t& expected, bool& ok){
+    std::stop_source stop;
+    ok = true;
+    while (expected < total) {
+      ring->waitForData(cursor, stop.get_token());
+      const uint64_t* data;
+      size_t n = ring->peek(cursor, data, 512);
+      for (size_t i = 0; i < n; ++i) {
+        ok = ok && data[i] == expected++;
+      }
+      ring->release(cursor, n);
+    }
+  };
+
+  uint64_t expected0 = 0, expected1 = 0;
+  bool ok0, ok1;
+  {
+    std::jthread c0([&]{ consume(0, expected0, ok0); });
+    std::jthread c1([&]{ consume(1, expected1, ok1); });
+  }
+  EXPECT_TRUE(ok0);
+  EXPECT_TRUE(ok1);
+  EXPECT_EQ(expected0, total);
+  EXPECT_EQ(expected1, total);
+}
+
+TEST(BroadcastRingTest, waitForDataWakesOnThreshold) {
+  auto ring = std::make_shared<BroadcastRing<int>>(2, 64);
+  std::atomic<bool> woke = false;
+
+  std::jthread consumer([&](std::stop_token stoken){
+    while (!stoken.stop_requested() && !ring->waitForData(1, stoken, 10)) {}
+    woke = ring->size(1) >= 10;
+  });
+
+  int fakeData[10] = {0};
+  size_t discard;
+  ring->push(fakeData, 10, discard);
+  consumer.join();
+  EXPECT_TRUE(woke);
+}
+
+TEST(BroadcastRingTest, safeFinish) {
+  auto ring = std::make_shared<BroadcastRing<int>>(2, 64);
+
+  std::jthread t = std::jthread([&](std::stop_token stoken){
+    while (!stoken.stop_requested()) {
+      ring->waitForData(0, stoken);
+    }
+  });
+
+  safe_finish(t, ring);
+  EXPECT_FALSE(t.joinable());
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include "CalibCache.hpp"
+#include "DataProcessor.hpp"
+
+class CalibCacheFixture : public ::testing::Test {
+  protected:
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "calibcache_test";
+    std::string cachePath = (dir / "calib_cache.bin").string();
+
+    EnergyCalib calib;
+
+    void SetUp() override{
+      std::filesystem::remove_all(dir);
+      std::filesystem::create_directories(dir);
+      for(size_t i = 0; i < CHIP_AREA; ++i){
+        calib.bat.push_back(i * 0.5);
+        calib.ita.push_back(1.0 / (i + 1));
+        calib.atb.push_back(-double(i));
+        calib.fac.push_back(i * i);
+      }
+    }
+
+    void TearDown() override{
+      std::filesystem::remove_all(dir);
+    }
+};
+
+TEST_F(CalibCacheFixture, roundTrip) {
+  ASSERT_TRUE(writeCalibCache(cachePath, 42, calib));
+  EXPECT_EQ(std::filesystem::file_size(cachePath), CALIB_CACHE_HEADER_SIZE + 4 * CHIP_AREA * sizeof(double));
+
+  EnergyCalib loaded;
+  ASSERT_TRUE(readCalibCache(cachePath, 42, loaded));
+  EXPECT_EQ(loaded.bat, calib.bat);
+  EXPECT_EQ(loaded.ita, calib.ita);
+  EXPECT_EQ(loaded.atb, calib.atb);
+  EXPECT_EQ(loaded.fac, calib.fac);
+}
+
+TEST_F(CalibCacheFixture, staleSourceHashRejected) {
+  ASSERT_TRUE(writeCalibCache(cachePath, 42, calib));
+  EnergyCalib loaded;
+  EXPECT_FALSE(readCalibCache(cachePath, 43, loaded));
+  EXPECT_TRUE(loaded.bat.empty());
+}
+
+TEST_F(CalibCacheFixture, corruptOrTruncatedRejected) {
+  ASSERT_TRUE(writeCalibCache(cachePath, 42, calib));
+  {
+    std::fstream f(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(CALIB_CACHE_HEADER_SIZE + 1000);
+    f.put('\x55');
+  }
+  EnergyCalib loaded;
+  EXPECT_FALSE(readCalibCache(cachePath, 42, loaded));
+
+  ASSERT_TRUE(writeCalibCache(cachePath, 42, calib));
+  std::filesystem::resize_file(cachePath, CALIB_CACHE_HEADER_SIZE + 8);
+  EXPECT_FALSE(readCalibCache(cachePath, 42, loaded));
+
+  EXPECT_FALSE(readCalibCache((dir / "missing.bin").string(), 42, loaded));
+}
+
+TEST_F(CalibCacheFixture, rebuiltWhenSourcesChange) {
+  const auto srcDir = dir / "calib";
+  std::filesystem::copy(SOURCE_CALIB_DIR, srcDir);
+
+  auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>();
+  auto speciesQ = std::make_shared<SafeQueue<SpeciesHit>>();
+  auto logger = std::make_shared<Logger>("log.txt");
+  const mode::pixel_type px(katherine_coord(3,200),0,0,77);
+
+  // first load parses the text files and creates the cache
+  DataProcessor parsed(ring, speciesQ, logger);
+  ASSERT_TRUE(parsed.loadEnergyCalib(srcDir.string(), cachePath));
+  uint64_t hash;
+  ASSERT_TRUE(hashCalibSources(srcDir.string(), hash));
+  EnergyCalib cached;
+  ASSERT_TRUE(readCalibCache(cachePath, hash, cached));
+
+  // second load comes from the cache, with identical results
+  DataProcessor fromCache(ring, speciesQ, logger);
+  ASSERT_TRUE(fromCache.loadEnergyCalib(srcDir.string(), cachePath));
+  EXPECT_EQ(parsed.getEnergy(px), fromCache.getEnergy(px));
+
+  // editing a source file invalidates the cache, the next load rebuilds it
+  {
+    std::ofstream a(srcDir / "a.txt", std::ios::app);
+    a << " ";
+  }
+  uint64_t newHash;
+  ASSERT_TRUE(hashCalibSources(srcDir.string(), newHash));
+  ASSERT_NE(hash, newHash);
+  EXPECT_FALSE(readCalibCache(cachePath, newHash, cached));
+
+  DataProcessor rebuilt(ring, speciesQ, logger);
+  ASSERT_TRUE(rebuilt.loadEnergyCalib(srcDir.string(), cachePath));
+  EXPECT_TRUE(readCalibCache(cachePath, newHash, cached));
+  EXPECT_EQ(parsed.getEnergy(px), rebuilt.getEnergy(px));
+}
+
+namespace {
+
+//! @brief writes count copies of value, laid out cols per line
+void writeConstants(const std::filesystem::path& path, const std::string& value, size_t count, size_t cols){
+  std::ofstream f(path);
+  for(size_t i = 0; i < count; ++i){
+    f << value << ((i + 1) % cols ? (i % 2 ? "\t" : "  ") : "\r\n");
+  }
+}
+
+} // namespace
+
+TEST_F(CalibCacheFixture, textParserAcceptsAnyLayout) {
+  writeConstants(dir / "a.txt", "0.7", CHIP_AREA, CHIP_WIDTH);
+  writeConstants(dir / "b.txt", "3", CHIP_AREA, 1);
+  writeConstants(dir / "c.txt", "6e1", CHIP_AREA, CHIP_AREA);
+  writeConstants(dir / "t.txt", "2.0", CHIP_AREA, 7);
+
+  auto logger = std::make_shared<Logger>("log.txt");
+  DataProcessor dataProc(std::make_shared<BroadcastRing<mode::pixel_type>>(),
+    std::make_shared<SafeQueue<SpeciesHit>>(), logger);
+  ASSERT_TRUE(dataProc.loadEnergyCalib(dir.string(), ""));
+
+  EnergyCalib expected;
+  expected.bat.assign(1, 3 + 0.7 * 2.0);
+  expected.ita.assign(1, 1 / (2 * 0.7));
+  expected.atb.assign(1, 0.7 * 2.0 - 3);
+  expected.fac.assign(1, 4 * 0.7 * 60);
+  EXPECT_DOUBLE_EQ(calibratedEnergy(expected, 0, 50),
+    dataProc.getEnergy(mode::pixel_type(katherine_coord(100,17),0,0,50)));
+}
+
+TEST_F(CalibCacheFixture, textParserRejectsBadFiles) {
+  auto logger = std::make_shared<Logger>("log.txt");
+  DataProcessor dataProc(std::make_shared<BroadcastRing<mode::pixel_type>>(),
+    std::make_shared<SafeQueue<SpeciesHit>>(), logger);
+
+  for(const char* name : {"a.txt", "b.txt", "c.txt", "t.txt"}){
+    writeConstants(dir / name, "1.25", CHIP_AREA, CHIP_WIDTH);
+  }
+  ASSERT_TRUE(dataProc.loadEnergyCalib(dir.string(), ""));
+
+  // one constant short
+  writeConstants(dir / "b.txt", "1.25", CHIP_AREA - 1, CHIP_WIDTH);
+  EXPECT_FALSE(dataProc.loadEnergyCalib(dir.string(), ""));
+
+  // not a number
+  writeConstants(dir / "b.txt", "1.25", CHIP_AREA, CHIP_WIDTH);
+  { std::ofstream f(dir / "b.txt", std::ios::app); f << "x"; }
+  EXPECT_FALSE(dataProc.loadEnergyCalib(dir.string(), ""));
+
+  // missing
+  std::filesystem::remove(dir / "b.txt");
+  EXPECT_FALSE(dataProc.loadEnergyCalib(dir.string(), ""));
+}
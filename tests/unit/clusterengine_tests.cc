@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "ClusterEngine.hpp"
+
+namespace {
+
+using Clusters = std::vector<std::vector<mode::pixel_type>>;
+
+/**
+ * @brief feeds hits (in time order) to engine as one batch, returns emitted clusters
+ */
+Clusters process(ClusterEngine& engine, const std::vector<mode::pixel_type>& hits, bool flush){
+  std::vector<const mode::pixel_type*> ptrs;
+  for (const auto& h : hits) { ptrs.push_back(&h); }
+
+  Clusters out;
+  engine.process(ptrs.data(), ptrs.size(), flush,
+    [&](const mode::pixel_type* const* members, size_t count){
+      out.emplace_back();
+      for (size_t i = 0; i < count; ++i) { out.back().push_back(*members[i]); }
+    });
+  return out;
+}
+
+mode::pixel_type hit(uint8_t x, uint8_t y, uint64_t toa){
+  return mode::pixel_type(katherine_coord(x,y),toa,0,1);
+}
+
+} // namespace
+
+TEST(ClusterEngineTest, adjacentPixelsJoin) {
+  ClusterEngine engine;
+  auto out = process(engine, {hit(10,10,1), hit(11,11,2), hit(12,12,3), hit(9,10,3)}, true);
+  ASSERT_EQ(out.size(), 1u);
+  EXPECT_EQ(out[0].size(), 4u);
+}
+
+TEST(ClusterEngineTest, separatePixelsSplit) {
+  ClusterEngine engine;
+  auto out = process(engine, {hit(10,10,1), hit(12,10,1), hit(10,12,2), hit(0,0,2)}, true);
+  ASSERT_EQ(out.size(), 4u);
+  EXPECT_EQ(out[0][0].coord.x, 10);
+  EXPECT_EQ(out[1][0].coord.x, 12);
+  EXPECT_EQ(out[2][0].coord.y, 12);
+  EXPECT_EQ(out[3][0].coord.x, 0);
+}
+
+TEST(ClusterEngineTest, chainsMergeIntoEarliestCluster) {
+  ClusterEngine engine;
+  // two branches that only connect through the last hit
+  auto out = process(engine, {hit(10,10,1), hit(14,10,1), hit(11,10,2), hit(13,10,2), hit(12,10,3)}, true);
+  ASSERT_EQ(out.size(), 1u);
+  ASSERT_EQ(out[0].size(), 5u);
+  for (size_t i = 1; i < 5; ++i) { EXPECT_LE(out[0][i-1].toa, out[0][i].toa); }
+}
+
+TEST(ClusterEngineTest, timeWindowSeparatesSamePixel) {
+  ClusterEngine engine;
+  auto out = process(engine, {
+    hit(10,10,100), hit(10,10,100 + CLUSTER_TOA_WINDOW - 1), hit(10,10,100 + 2*CLUSTER_TOA_WINDOW)
+  }, true);
+  ASSERT_EQ(out.size(), 2u);
+  EXPECT_EQ(out[0].size(), 2u);
+  EXPECT_EQ(out[1].size(), 1u);
+}
+
+TEST(ClusterEngineTest, gridFromEarlierBatchIgnored) {
+  ClusterEngine engine;
+  auto first = process(engine, {hit(10,10,1), hit(50,50,100)}, false);
+  ASSERT_EQ(first.size(), 1u);
+
+  // same pixels again, far later: must not join the stale grid entries
+  auto second = process(engine, {hit(10,10,1000), hit(50,50,1001)}, true);
+  ASSERT_EQ(second.size(), 3u);
+  EXPECT_EQ(second[0][0].toa, 100u);
+  EXPECT_EQ(second[1][0].toa, 1000u);
+  EXPECT_EQ(second[2][0].toa, 1001u);
+}
+
+TEST(ClusterEngineTest, openClusterHoldsBackLaterClusters) {
+  ClusterEngine engine;
+  // a track still growing at the end of the batch, and a complete hit after it started
+  auto first = process(engine, {hit(10,10,1), hit(30,30,2), hit(11,10,4), hit(12,10,8), hit(13,10,12)}, false);
+  ASSERT_EQ(first.size(), 0u);
+  EXPECT_EQ(engine.carried(), 5u);
+
+  auto second = process(engine, {hit(14,10,14), hit(100,100,40)}, false);
+  ASSERT_EQ(second.size(), 2u);
+  EXPECT_EQ(second[0].size(), 5u);
+  EXPECT_EQ(second[1].size(), 1u);
+  EXPECT_EQ(engine.carried(), 1u);
+}
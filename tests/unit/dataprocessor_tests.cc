@@ -5,15 +5,15 @@
 
 class DataProcFixture : public ::testing::Test {
   protected:
-    std::shared_ptr<SafeBuff<mode::pixel_type>> rawHitsBuff
-      = std::make_shared<SafeBuff<mode::pixel_type>>();
+    std::shared_ptr<BroadcastRing<mode::pixel_type>> rawHitsRing
+      = std::make_shared<BroadcastRing<mode::pixel_type>>();
 
     std::shared_ptr<SafeQueue<SpeciesHit>> speciesHitsQ =
       std::make_shared<SafeQueue<SpeciesHit>>();
 
     std::shared_ptr<Logger> logger = std::make_shared<Logger>("log.txt");
 
-    DataProcessor dataProc = DataProcessor(rawHitsBuff, speciesHitsQ, logger);
+    DataProcessor dataProc = DataProcessor(rawHitsRing, speciesHitsQ, logger);
 
     void SetUp() override{
       while(!speciesHitsQ->q_.empty()){
@@ -156,47 +156,55 @@ TEST_F(DataProcFixture, detectGrade7TooManyHits) {
 }
 
 TEST_F(DataProcFixture, detectGrade7HitOutOfBoundsAboveX) {
+  // connected through a low energy hit, but out of reach of the center
   mode::pixel_type fakeData[] = {
+    mode::pixel_type(katherine_coord(5,5),3,0,20), // center
+    mode::pixel_type(katherine_coord(4,5),3,0,1),
     mode::pixel_type(katherine_coord(3,5),3,0,10),
-    mode::pixel_type(katherine_coord(5,5),3,0,10),
   };
 
   uint8_t expected[] = {7};
-    
-  ProcessAndCompareGrade(fakeData,2,expected,1);
+
+  ProcessAndCompareGrade(fakeData,3,expected,1);
 }
 
 TEST_F(DataProcFixture, detectGrade7HitOutOfBoundsBelowX) {
+  // connected through a low energy hit, but out of reach of the center
   mode::pixel_type fakeData[] = {
-    mode::pixel_type(katherine_coord(5,5),3,0,10),
+    mode::pixel_type(katherine_coord(5,5),3,0,20), // center
+    mode::pixel_type(katherine_coord(6,5),3,0,1),
     mode::pixel_type(katherine_coord(7,5),3,0,10),
   };
 
   uint8_t expected[] = {7};
-    
-  ProcessAndCompareGrade(fakeData,2,expected,1);
+
+  ProcessAndCompareGrade(fakeData,3,expected,1);
 }
 
 TEST_F(DataProcFixture, detectGrade7HitOutOfBoundsBelowY) {
-    mode::pixel_type fakeData[] = {
-    mode::pixel_type(katherine_coord(5,5),3,0,10),
+  // connected through a low energy hit, but out of reach of the center
+  mode::pixel_type fakeData[] = {
+    mode::pixel_type(katherine_coord(5,5),3,0,20), // center
+    mode::pixel_type(katherine_coord(5,6),3,0,1),
     mode::pixel_type(katherine_coord(5,7),3,0,10),
   };
-  
+
   uint8_t expected[] = {7};
-    
-  ProcessAndCompareGrade(fakeData,2,expected,1);
+
+  ProcessAndCompareGrade(fakeData,3,expected,1);
 }
 
 TEST_F(DataProcFixture, detectGrade7HitOutOfBoundsAboveY) {
-    mode::pixel_type fakeData[] = {
-    mode::pixel_type(katherine_coord(5,5),3,0,10),
+  // connected through a low energy hit, but out of reach of the center
+  mode::pixel_type fakeData[] = {
+    mode::pixel_type(katherine_coord(5,5),3,0,20), // center
+    mode::pixel_type(katherine_coord(5,4),3,0,1),
     mode::pixel_type(katherine_coord(5,3),3,0,10),
   };
-  
+
   uint8_t expected[] = {7};
-    
-  ProcessAndCompareGrade(fakeData,2,expected,1);
+
+  ProcessAndCompareGrade(fakeData,3,expected,1);
 }
 
 TEST_F(DataProcFixture, detectGrade7BadPattern) {
@@ -220,6 +228,19 @@ TEST_F(DataProcFixture, detectGrade7BadPattern) {
   ProcessAndCompareGrade(fakeData,9,expected,1);
 }
 
+TEST_F(DataProcFixture, detectSimultaneousSeparateClusters) {
+  mode::pixel_type fakeData[] = {
+    mode::pixel_type(katherine_coord(10,10),1,0,100),
+    mode::pixel_type(katherine_coord(200,30),1,0,50),
+    mode::pixel_type(katherine_coord(11,11),2,0,10),
+    mode::pixel_type(katherine_coord(200,32),2,0,5)
+  };
+
+  uint8_t expected[] = {1,0,0};
+
+  ProcessAndCompareGrade(fakeData,4,expected,3);
+}
+
 TEST_F(DataProcFixture, detectMultipleClusters) {
   mode::pixel_type fakeData[] = {
     mode::pixel_type(katherine_coord(10,10),1,0,100),
@@ -234,4 +255,125 @@ TEST_F(DataProcFixture, detectMultipleClusters) {
   uint8_t expected[] = {3,5};
 
   ProcessAndCompareGrade(fakeData,6,expected,2);
-}
\ No newline at end of file
+}
+TEST_F(DataProcFixture, openClusterCarriedToNextBatch) {
+  mode::pixel_type batch1[] = {
+    mode::pixel_type(katherine_coord(10,10),1,0,100),
+    mode::pixel_type(katherine_coord(9,10),2,0,1),
+
+    mode::pixel_type(katherine_coord(10,10),10,0,100),
+    mode::pixel_type(katherine_coord(11,10),11,0,1)
+  };
+  mode::pixel_type batch2[] = {
+    mode::pixel_type(katherine_coord(11,9),9,0,1),
+    mode::pixel_type(katherine_coord(9,9),12,0,1),
+
+    mode::pixel_type(katherine_coord(20,20),30,0,7)
+  };
+
+  // second cluster is still open at the end of the first batch
+  dataProc.doProcessing(batch1,4,false);
+  ASSERT_EQ(1,speciesHitsQ->q_.size());
+  EXPECT_EQ(3,speciesHitsQ->q_.front().grade_);
+  speciesHitsQ->q_.pop();
+
+  // ... and completed (including a late hit) by the second one
+  dataProc.doProcessing(batch2,3,false);
+  ASSERT_EQ(1,speciesHitsQ->q_.size());
+  EXPECT_EQ(5,speciesHitsQ->q_.front().grade_);
+  EXPECT_EQ(9,speciesHitsQ->q_.front().startTOA_);
+  EXPECT_DOUBLE_EQ(103,speciesHitsQ->q_.front().totalE_);
+  speciesHitsQ->q_.pop();
+
+  // last cluster of the run is only emitted on flush
+  dataProc.doProcessing(nullptr,0,true);
+  ASSERT_EQ(1,speciesHitsQ->q_.size());
+  EXPECT_EQ(0,speciesHitsQ->q_.front().grade_);
+  EXPECT_EQ(30,speciesHitsQ->q_.front().startTOA_);
+}
+
+TEST_F(DataProcFixture, clusterSplitIntoSingleHitBatches) {
+  mode::pixel_type hits[] = {
+    mode::pixel_type(katherine_coord(10,10),10,0,100), // center
+    mode::pixel_type(katherine_coord(11,10),11,0,1),
+    mode::pixel_type(katherine_coord(11,9),9,0,1),
+    mode::pixel_type(katherine_coord(9,9),11,0,1)
+  };
+
+  for(auto& hit : hits){
+    dataProc.doProcessing(&hit,1,false);
+  }
+  EXPECT_TRUE(speciesHitsQ->q_.empty());
+
+  dataProc.doProcessing(nullptr,0,true);
+  ASSERT_EQ(1,speciesHitsQ->q_.size());
+  EXPECT_EQ(5,speciesHitsQ->q_.front().grade_);
+  EXPECT_DOUBLE_EQ(103,speciesHitsQ->q_.front().totalE_);
+}
+
+TEST_F(DataProcFixture, parallelClusteringMatchesSerial) {
+  // clusters of 1-6 touching hits, separated by small and large toa gaps
+  std::vector<mode::pixel_type> hits;
+  uint64_t toa = 1000;
+  uint32_t rng = 12345;
+  auto next = [&](uint32_t mod){ rng = rng * 1664525 + 1013904223; return (rng >> 8) % mod; };
+  while(hits.size() < 40000){
+    toa += 1 + next(40);
+    const uint8_t x = next(250), y = next(250);
+    for(uint32_t c = next(6); c < 6; ++c){
+      hits.emplace_back(katherine_coord(x + c % 3, y + c / 3), toa + next(3), 0, 1 + next(300));
+    }
+  }
+
+  auto parallelQ = std::make_shared<SafeQueue<SpeciesHit>>();
+  DataProcessor parallelProc(rawHitsRing, parallelQ, logger, 3);
+
+  // uneven batches so shards, carried clusters and batch edges all line up differently
+  for(size_t start = 0, len = 7000; start < hits.size(); start += len, len += 1111){
+    const size_t n = std::min(len, hits.size() - start);
+    dataProc.doProcessing(hits.data() + start, n, false);
+    parallelProc.doProcessing(hits.data() + start, n, false);
+  }
+  dataProc.doProcessing(nullptr, 0, true);
+  parallelProc.doProcessing(nullptr, 0, true);
+
+  ASSERT_GT(speciesHitsQ->q_.size(), 1000u);
+  ASSERT_EQ(speciesHitsQ->q_.size(), parallelQ->q_.size());
+  while(!speciesHitsQ->q_.empty()){
+    const auto& s = speciesHitsQ->q_.front();
+    const auto& p = parallelQ->q_.front();
+    ASSERT_EQ(s.startTOA_, p.startTOA_);
+    ASSERT_EQ(s.grade_, p.grade_);
+    ASSERT_DOUBLE_EQ(s.totalE_, p.totalE_);
+    speciesHitsQ->q_.pop();
+    parallelQ->q_.pop();
+  }
+}
+
+TEST_F(DataProcFixture, energyLutMatchesFormula) {
+  ASSERT_TRUE(dataProc.loadEnergyCalib(SOURCE_CALIB_DIR));
+
+  std::vector<mode::pixel_type> hits;
+  for(uint16_t tot : {0, 1, 17, 31, 32, 63, 64, 500, 1023}){
+    for(uint8_t x : {0, 7, 128, 255}){
+      hits.emplace_back(katherine_coord(x, 255 - x), 0, 0, tot);
+    }
+  }
+
+  ASSERT_EQ(dataProc.buildEnergyLut(0), 0u);
+  std::vector<double> exact;
+  for(const auto& h : hits){ exact.push_back(dataProc.getEnergy(h)); }
+
+  // full chip, and a subset of pixels with a shorter range
+  const size_t fullBytes = dataProc.buildEnergyLut(64);
+  EXPECT_EQ(fullBytes, CHIP_AREA * 64 * sizeof(float) + CHIP_AREA * sizeof(uint32_t));
+  for(size_t i = 0; i < hits.size(); ++i){
+    EXPECT_NEAR(exact[i], dataProc.getEnergy(hits[i]), 1e-6 * std::abs(exact[i]) + 1e-9);
+  }
+
+  const size_t subsetBytes = dataProc.buildEnergyLut(32, {CHIP_WIDTH * 248 + 7, CHIP_WIDTH * 127 + 128});
+  EXPECT_EQ(subsetBytes, 2 * 32 * sizeof(float) + CHIP_AREA * sizeof(uint32_t));
+  for(size_t i = 0; i < hits.size(); ++i){
+    EXPECT_NEAR(exact[i], dataProc.getEnergy(hits[i]), 1e-6 * std::abs(exact[i]) + 1e-9);
+  }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "EnergyKernel.hpp"
+
+namespace {
+
+EnergyCalib makeCalib(){
+  // constants in the range of the real calibration files
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> a(0.6, 0.85), b(1.0, 6.0), c(20.0, 120.0), t(1.0, 4.0);
+  EnergyCalib calib;
+  for (size_t i = 0; i < CHIP_AREA; ++i) {
+    const double ai = a(rng), bi = b(rng), ci = c(rng), ti = t(rng);
+    calib.bat.push_back(bi + ai * ti);
+    calib.ita.push_back(1 / (2 * ai));
+    calib.atb.push_back(ai * ti - bi);
+    calib.fac.push_back(4 * ai * ci);
+  }
+  return calib;
+}
+
+std::vector<mode::pixel_type> makeHits(size_t n){
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<int> coord(0, 255), tot(0, 1023);
+  std::vector<mode::pixel_type> hits(n);
+  for (auto& h : hits) {
+    h.coord.x = coord(rng);
+    h.coord.y = coord(rng);
+    h.tot = tot(rng);
+  }
+  return hits;
+}
+
+void expectMatchesReference(EnergyKernelIsa isa){
+  const auto calib = makeCalib();
+  // odd length: exercises the scalar tail of the vector kernels;
+  // high tot values exercise the distortion correction
+  const auto hits = makeHits(1021);
+
+  std::vector<double> energies(hits.size());
+  calibrateEnergies(hits.data(), hits.size(), calib, energies.data(), isa);
+
+  for (size_t i = 0; i < hits.size(); ++i) {
+    const double ref = calibratedEnergy(calib, CHIP_WIDTH * hits[i].coord.y + hits[i].coord.x, hits[i].tot);
+    ASSERT_DOUBLE_EQ(ref, energies[i]) << "hit " << i << " with " << energyKernelName(isa);
+  }
+}
+
+} // namespace
+
+TEST(EnergyKernelTest, scalarMatchesReference) {
+  expectMatchesReference(EnergyKernelIsa::SCALAR);
+}
+
+TEST(EnergyKernelTest, avx2MatchesReference) {
+  if (bestEnergyKernel() == EnergyKernelIsa::SCALAR) { GTEST_SKIP() << "cpu has no avx2"; }
+  expectMatchesReference(EnergyKernelIsa::AVX2);
+}
+
+TEST(EnergyKernelTest, avx512MatchesReference) {
+  if (bestEnergyKernel() != EnergyKernelIsa::AVX512) { GTEST_SKIP() << "cpu has no avx512"; }
+  expectMatchesReference(EnergyKernelIsa::AVX512);
+}
+
+TEST(EnergyKernelTest, distortionCorrectionApplied) {
+  EnergyCalib calib;
+  calib.bat.assign(CHIP_AREA, 0);
+  calib.ita.assign(CHIP_AREA, 1);
+  calib.atb.assign(CHIP_AREA, 0);
+  calib.fac.assign(CHIP_AREA, 0);
+  // energy = 2 * tot before correction
+  std::vector<mode::pixel_type> hits(16);
+  for (size_t i = 0; i < hits.size(); ++i) { hits[i].tot = i < 8 ? 100 : 1000; }
+
+  std::vector<double> energies(hits.size());
+  calibrateEnergies(hits.data(), hits.size(), calib, energies.data());
+  for (size_t i = 0; i < hits.size(); ++i) {
+    const double raw = 2.0 * hits[i].tot;
+    EXPECT_DOUBLE_EQ(energies[i], raw > 918 ? raw - 0.888 * (raw - 918) : raw);
+  }
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "KatherineEmulator.hpp"
+
+class EmulatorFixture : public ::testing::Test {
+  protected:
+    const std::string logPath = "emulator_test.txt";
+    const std::string recordingPath = "emulator_test.md";
+    std::shared_ptr<Logger> logger = std::make_shared<Logger>(logPath);
+
+    std::vector<mode::pixel_type> received;
+
+    // hits crossing several 14 bit toa boundaries, one per call
+    std::vector<mode::pixel_type> makeHits(size_t n){
+      std::vector<mode::pixel_type> hits(n);
+      for(size_t i = 0; i < n; ++i){
+        hits[i].coord.x = static_cast<uint8_t>(i * 7);
+        hits[i].coord.y = static_cast<uint8_t>(i * 13);
+        hits[i].toa = i * 5000;
+        hits[i].tot = static_cast<uint16_t>(1 + i % 1000);
+      }
+      return hits;
+    }
+
+    // acquires one data driven frame from the emulator, as AcqController does
+    katherine::acq_state acquire(){
+      using namespace std::literals::chrono_literals;
+      katherine::device device(EMU_ADDRESS);
+
+      katherine::config config;
+      config.set_bias_id(0);
+      config.set_acq_time(10s);
+      config.set_no_frames(1);
+      config.set_bias(0);
+      config.set_delayed_start(false);
+      config.set_start_trigger(katherine::no_trigger);
+      config.set_stop_trigger(katherine::no_trigger);
+      config.set_gray_disable(false);
+      config.set_polarity_holes(true);
+      config.set_phase(katherine::phase::p1);
+      config.set_freq(katherine::freq::f40);
+      config.set_dacs(katherine::dacs{});
+      config.set_pixel_config(katherine::px_config{});
+
+      katherine::acquisition<mode> acq{
+        device, katherine::md_size * 65536, sizeof(mode::pixel_type) * 65536, 500ms, 10s, 10000, true
+      };
+      acq.set_pixels_received_handler([&](const mode::pixel_type* px, size_t count){
+        received.insert(received.end(), px, px + count);
+      });
+      acq.begin(config, katherine::readout_type::data_driven);
+      acq.read();
+      return acq.state();
+    }
+
+    void SetUp() override{
+#ifndef KATHERINE_EMULATOR
+      GTEST_SKIP() << "lib_katherine holds the emulator's ports, configure with -DKATHERINE_EMULATOR=ON";
+#endif
+    }
+
+    void TearDown() override{
+      std::remove(logPath.c_str());
+      std::remove(recordingPath.c_str());
+    }
+};
+
+TEST_F(EmulatorFixture, answersStatusCommands) {
+  KatherineEmulator emulator(logger);
+  ASSERT_TRUE(emulator.start());
+
+  katherine::device device(EMU_ADDRESS);
+  EXPECT_EQ(device.chip_id(), CHIP_ID);
+  EXPECT_FLOAT_EQ(device.readout_temperature(), 30.0f);
+}
+
+TEST_F(EmulatorFixture, streamsSourceHits) {
+  const auto hits = makeHits(5000);
+  size_t next = 0;
+  EmulatorSettings settings;
+  settings.hitRate = 0;
+  KatherineEmulator emulator(logger, settings, [&](mode::pixel_type* out, size_t max){
+    const size_t n = std::min(max, hits.size() - next);
+    std::copy(hits.begin() + next, hits.begin() + next + n, out);
+    next += n;
+    return n;
+  });
+  ASSERT_TRUE(emulator.start());
+
+  EXPECT_EQ(acquire(), katherine::acq_state::succeeded);
+  EXPECT_EQ(emulator.acquisitions(), 1);
+  EXPECT_EQ(emulator.sentHits(), hits.size());
+  ASSERT_EQ(received.size(), hits.size());
+  for(size_t i = 0; i < hits.size(); ++i){
+    ASSERT_EQ(received[i].coord.x, hits[i].coord.x) << "hit " << i;
+    ASSERT_EQ(received[i].coord.y, hits[i].coord.y) << "hit " << i;
+    ASSERT_EQ(received[i].toa, hits[i].toa) << "hit " << i;
+    ASSERT_EQ(received[i].tot, hits[i].tot) << "hit " << i;
+  }
+}
+
+TEST_F(EmulatorFixture, streamsRecording) {
+  const auto hits = makeHits(3);
+  {
+    std::ofstream file(recordingPath, std::ios::binary);
+    for(const auto& px : hits){
+      const uint64_t md = encodePixelMd(px);
+      file.write(reinterpret_cast<const char*>(&md), KATHERINE_MD_SIZE);
+    }
+  }
+
+  EmulatorSettings settings;
+  settings.recordingPath = recordingPath;
+  KatherineEmulator emulator(logger, settings);
+  ASSERT_TRUE(emulator.start());
+
+  EXPECT_EQ(acquire(), katherine::acq_state::succeeded);
+  EXPECT_EQ(emulator.sentHits(), 3);
+  ASSERT_EQ(received.size(), 3);
+  EXPECT_EQ(received[2].tot, hits[2].tot);
+  EXPECT_EQ(received[2].coord.y, hits[2].coord.y);
+}
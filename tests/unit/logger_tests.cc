@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Logger.hpp"
+
+class LoggerFixture : public ::testing::Test {
+  protected:
+    const std::string path = "logger_test.txt";
+
+    std::vector<std::string> readLines(){
+      std::ifstream f(path);
+      std::vector<std::string> lines;
+      for (std::string line; std::getline(f, line);) { lines.push_back(line); }
+      return lines;
+    }
+
+    size_t countContaining(const std::string& needle){
+      size_t n = 0;
+      for (const auto& line : readLines()) {
+        if (line.find(needle) != std::string::npos) { ++n; }
+      }
+      return n;
+    }
+
+    void TearDown() override{
+      std::remove(path.c_str());
+    }
+};
+
+TEST_F(LoggerFixture, syncWritesImmediately) {
+  Logger logger(path);
+  logger.log(LogLevel::LL_WARNING, "sync message");
+  EXPECT_EQ(countContaining("[WARNING] \"sync message\""), 1);
+}
+
+TEST_F(LoggerFixture, asyncWritesEverythingByDestruction) {
+  {
+    Logger logger(path, true);
+    for (int i = 0; i < 1000; ++i) {
+      logger.log(LogLevel::LL_INFO, std::format("msg {}", i));
+    }
+  }
+  EXPECT_EQ(countContaining("[INFO] \"msg "), 1000);
+  EXPECT_EQ(countContaining("logfile created"), 1);
+}
+
+TEST_F(LoggerFixture, asyncFlushesOnInterval) {
+  Logger logger(path, true);
+  logger.log(LogLevel::LL_INFO, "eventually");
+  std::this_thread::sleep_for(LOG_FLUSH_INTERVAL * 4);
+  EXPECT_EQ(countContaining("eventually"), 1);
+}
+
+TEST_F(LoggerFixture, asyncFatalIsSynchronousAndOrdered) {
+  Logger logger(path, true);
+  logger.log(LogLevel::LL_INFO, "before fatal");
+  logger.log(LogLevel::LL_FATAL, "fatal now");
+
+  auto lines = readLines();
+  ASSERT_GE(lines.size(), 2);
+  EXPECT_NE(lines[lines.size() - 2].find("before fatal"), std::string::npos);
+  EXPECT_NE(lines.back().find("[FATAL] \"fatal now\""), std::string::npos);
+}
+
+TEST_F(LoggerFixture, asyncKeepsPerThreadOrder) {
+  constexpr int threads = 4;
+  constexpr int perThread = 500;
+  {
+    Logger logger(path, true);
+    std::vector<std::jthread> workers;
+    for (int t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t]{
+        for (int i = 0; i < perThread; ++i) {
+          logger.log(LogLevel::LL_DEBUG, std::format("t{} {}", t, i));
+          if (i % 100 == 0) { std::this_thread::yield(); }
+        }
+      });
+    }
+  }
+
+  std::vector<int> next(threads, 0);
+  size_t seen = 0;
+  for (const auto& line : readLines()) {
+    int t, i;
+    if (sscanf(line.c_str(), "%*d [DEBUG] \"t%d %d\"", &t, &i) == 2) {
+      ASSERT_EQ(i, next[t]++) << "out of order for thread " << t;
+      ++seen;
+    }
+  }
+  EXPECT_EQ(seen, threads * perThread);
+}
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "AcqController.hpp"
+#include "KatherineEmulator.hpp"
+#include "MdCapture.hpp"
+
+bool debugPrints = false;
+
+class MdCaptureFixture : public ::testing::Test {
+  protected:
+    const std::string capturePath = "mdcapture_test.mdc";
+    const std::string logPath = "mdcapture_test.txt";
+
+    std::vector<mode::pixel_type> hits;
+
+    // one data driven frame as the readout sends it, split into datagrams of
+    // mdsPerDatagram MDs
+    std::vector<std::vector<uint8_t>> makeDatagrams(size_t nHits, size_t mdsPerDatagram){
+      std::vector<uint64_t> mds;
+      mds.push_back(uint64_t(0x7) << 44); // new frame
+      uint64_t offset = 0;
+      for(size_t i = 0; i < nHits; ++i){
+        mode::pixel_type px{};
+        px.coord.x = static_cast<uint8_t>(i * 3);
+        px.coord.y = static_cast<uint8_t>(i * 11);
+        px.toa = i * 7000;
+        px.tot = static_cast<uint16_t>(1 + i % 900);
+        if(px.toa >> 14 != offset){
+          offset = px.toa >> 14;
+          mds.push_back(uint64_t(0x5) << 44 | offset);
+        }
+        mds.push_back(encodePixelMd(px));
+        hits.push_back(px);
+      }
+      mds.push_back(uint64_t(0xC) << 44 | nHits); // frame finished
+
+      std::vector<std::vector<uint8_t>> dgrams;
+      for(size_t i = 0; i < mds.size(); i += mdsPerDatagram){
+        std::vector<uint8_t> dgram;
+        for(size_t j = i; j < std::min(mds.size(), i + mdsPerDatagram); ++j){
+          for(size_t b = 0; b < KATHERINE_MD_SIZE; ++b){
+            dgram.push_back(static_cast<uint8_t>(mds[j] >> (8 * b)));
+          }
+        }
+        dgrams.push_back(std::move(dgram));
+      }
+      return dgrams;
+    }
+
+    void writeCapture(const std::vector<std::vector<uint8_t>>& dgrams){
+      MdCaptureWriter writer;
+      ASSERT_TRUE(writer.open(capturePath));
+      auto t = std::chrono::steady_clock::now();
+      for(const auto& dgram : dgrams){
+        t += std::chrono::microseconds(100);
+        writer.write(reinterpret_cast<const char*>(dgram.data()), dgram.size(), t);
+      }
+      EXPECT_EQ(writer.datagrams(), dgrams.size());
+      ASSERT_TRUE(writer.close());
+    }
+
+    void TearDown() override{
+      std::remove(capturePath.c_str());
+      std::remove(logPath.c_str());
+    }
+};
+
+TEST_F(MdCaptureFixture, roundTripsDatagrams) {
+  const auto dgrams = makeDatagrams(1000, 97);
+  writeCapture(dgrams);
+
+  MdCaptureReader reader;
+  ASSERT_TRUE(reader.open(capturePath));
+  MdDatagram dgram;
+  for(size_t i = 0; i < dgrams.size(); ++i){
+    ASSERT_TRUE(reader.next(dgram));
+    EXPECT_GE(dgram.offsetNs, (i + 1) * 100000);
+    ASSERT_EQ(dgram.len, dgrams[i].size());
+    EXPECT_EQ(0, std::memcmp(dgram.data, dgrams[i].data(), dgram.len));
+  }
+  EXPECT_FALSE(reader.next(dgram));
+  EXPECT_FALSE(reader.truncated());
+}
+
+TEST_F(MdCaptureFixture, rejectsForeignAndTruncatedFiles) {
+  {
+    std::ofstream file(capturePath, std::ios::binary);
+    file << "x y toa tot\n";
+  }
+  MdCaptureReader reader;
+  EXPECT_FALSE(reader.open(capturePath));
+
+  writeCapture(makeDatagrams(10, 4));
+  std::filesystem::resize_file(capturePath, std::filesystem::file_size(capturePath) - 1);
+  ASSERT_TRUE(reader.open(capturePath));
+  MdDatagram dgram;
+  while(reader.next(dgram)){}
+  EXPECT_TRUE(reader.truncated());
+}
+
+TEST_F(MdCaptureFixture, replayDecodesLikeAcquisition) {
+  const auto dgrams = makeDatagrams(5000, 1000);
+  writeCapture(dgrams);
+
+  std::vector<mode::pixel_type> received;
+  int framesEnded = 0;
+  katherine::acquisition<mode> acq{sizeof(mode::pixel_type) * 256};
+  acq.set_pixels_received_handler([&](const mode::pixel_type* px, size_t count){
+    received.insert(received.end(), px, px + count);
+  });
+  acq.set_frame_ended_handler([&](int, bool completed, const katherine::frame_info& info){
+    ++framesEnded;
+    EXPECT_TRUE(completed);
+    EXPECT_EQ(info.sent_pixels, hits.size());
+  });
+
+  MdCaptureReader reader;
+  ASSERT_TRUE(reader.open(capturePath));
+  // replaying twice gives the same result
+  for(int pass = 0; pass < 2; ++pass){
+    received.clear();
+    const ReplayStats stats = replayCapture(reader, acq, false);
+    EXPECT_EQ(stats.datagrams, dgrams.size());
+    EXPECT_EQ(acq.state(), katherine::acq_state::succeeded);
+
+    ASSERT_EQ(received.size(), hits.size());
+    for(size_t i = 0; i < hits.size(); ++i){
+      ASSERT_EQ(received[i].coord.x, hits[i].coord.x) << "hit " << i;
+      ASSERT_EQ(received[i].coord.y, hits[i].coord.y) << "hit " << i;
+      ASSERT_EQ(received[i].toa, hits[i].toa) << "hit " << i;
+      ASSERT_EQ(received[i].tot, hits[i].tot) << "hit " << i;
+    }
+  }
+  EXPECT_EQ(framesEnded, 2);
+}
+
+TEST_F(MdCaptureFixture, controllerReplaysIntoRing) {
+  writeCapture(makeDatagrams(2000, 500));
+
+  auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>(1, 4096);
+  auto logger = std::make_shared<Logger>(logPath);
+  AcqController acqCtrl(ring, logger);
+  ASSERT_TRUE(acqCtrl.replay(capturePath, false));
+  EXPECT_FALSE(acqCtrl.replay("missing.mdc", false));
+
+  ASSERT_EQ(ring->size(0), hits.size());
+  const mode::pixel_type* px;
+  size_t seen = 0;
+  while(size_t n = ring->peek(0, px, hits.size())){
+    for(size_t i = 0; i < n; ++i, ++seen){
+      ASSERT_EQ(px[i].toa, hits[seen].toa) << "hit " << seen;
+    }
+    ring->release(0, n);
+  }
+  EXPECT_EQ(seen, hits.size());
+}
+
+TEST_F(MdCaptureFixture, controllerReplaysGeneratedSource) {
+  const auto dgrams = makeDatagrams(3000, 250);
+
+  auto ring = std::make_shared<BroadcastRing<mode::pixel_type>>(1, 4096);
+  auto logger = std::make_shared<Logger>(logPath);
+  AcqController acqCtrl(ring, logger);
+  size_t next = 0;
+  acqCtrl.replay([&](MdDatagram& dgram){
+    if(next == dgrams.size()){ return false; }
+    dgram = {0, reinterpret_cast<const char*>(dgrams[next].data()), dgrams[next].size()};
+    ++next;
+    return true;
+  }, false, "test datagrams");
+
+  EXPECT_EQ(next, dgrams.size());
+  ASSERT_EQ(ring->size(0), hits.size());
+  const mode::pixel_type* px;
+  ASSERT_EQ(ring->peek(0, px, 1), 1);
+  EXPECT_EQ(px->toa, hits.front().toa);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "OverflowReporter.hpp"
+
+class OverflowReporterFixture : public ::testing::Test {
+  protected:
+    const std::string path = "overflowreporter_test.txt";
+    std::shared_ptr<Logger> logger = std::make_shared<Logger>(path);
+    OverflowCounter counter{"testRing", 1024};
+
+    size_t countContaining(const std::string& needle){
+      std::ifstream f(path);
+      size_t n = 0;
+      for (std::string line; std::getline(f, line);) {
+        if (line.find(needle) != std::string::npos) { ++n; }
+      }
+      return n;
+    }
+
+    void TearDown() override{
+      std::remove(path.c_str());
+    }
+};
+
+TEST_F(OverflowReporterFixture, counterTracksTotalsAndPeak) {
+  counter.record(10, 0);
+  counter.record(1024, 5);
+  counter.record(300, 7);
+  EXPECT_EQ(counter.discarded(), 12);
+  EXPECT_EQ(counter.events(), 2);
+  EXPECT_EQ(counter.peakFill(), 1024);
+
+  counter.reset();
+  EXPECT_EQ(counter.discarded(), 0);
+  EXPECT_EQ(counter.peakFill(), 0);
+}
+
+TEST_F(OverflowReporterFixture, oneLinePerIntervalNotPerDiscard) {
+  OverflowReporter reporter(logger);
+  reporter.add(counter);
+
+  for (int i = 0; i < 1000; ++i) { counter.record(1024, 3); }
+  reporter.report();
+  EXPECT_EQ(countContaining("testRing overflow: discarded 3000 elements"), 1);
+
+  counter.record(1024, 1);
+  reporter.report();
+  EXPECT_EQ(countContaining("episode so far: 3001 elements"), 1);
+
+  // quiet interval closes the episode
+  reporter.report();
+  EXPECT_EQ(countContaining("testRing overflow episode ended: discarded 3001 elements"), 1);
+
+  reporter.report();
+  EXPECT_EQ(countContaining("testRing overflow"), 3);
+}
+
+TEST_F(OverflowReporterFixture, quietCounterLogsNothing) {
+  OverflowReporter reporter(logger);
+  reporter.add(counter);
+  counter.record(500, 0);
+  reporter.report();
+  EXPECT_EQ(countContaining("testRing"), 0);
+}
+
+TEST_F(OverflowReporterFixture, stopClosesEpisodeAndSummarizes) {
+  {
+    OverflowReporter reporter(logger, std::chrono::milliseconds(10000));
+    reporter.add(counter);
+    reporter.start();
+    counter.record(1024, 42);
+    reporter.stop();
+    EXPECT_EQ(countContaining("episode ended: discarded 42 elements"), 1);
+    EXPECT_EQ(reporter.summary(),
+      "[testRing: discarded 42 elements in 1 pushes, 1 overflow episodes, peak fill 1024/1024]");
+  }
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "PipelineProbe.hpp"
+
+class PipelineProbeFixture : public ::testing::Test {
+  protected:
+    std::shared_ptr<BroadcastRing<mode::pixel_type>> ring =
+      std::make_shared<BroadcastRing<mode::pixel_type>>(RAW_CURSOR_COUNT, 4096);
+    std::shared_ptr<SafeQueue<SpeciesHit>> speciesQ = std::make_shared<SafeQueue<SpeciesHit>>();
+    OverflowCounter overflow{"testRing", 4096};
+    std::vector<mode::pixel_type> hits = std::vector<mode::pixel_type>(1000);
+
+    void push(size_t count){
+      size_t discarded;
+      const uint64_t fill = ring->push(hits.data(), count, discarded);
+      overflow.record(fill, discarded);
+    }
+};
+
+TEST_F(PipelineProbeFixture, latenciesGrowAlongThePipeline) {
+  using namespace std::chrono_literals;
+  PipelineProbe probe(ring, speciesQ, overflow, 100us);
+  probe.start();
+
+  probe.fed(1000);
+  std::this_thread::sleep_for(20ms);
+  push(1000);
+  speciesQ->q_.emplace(0, 0, 0.);
+  std::this_thread::sleep_for(20ms);
+  ring->release(RAW_CURSOR_PROCESSING, 1000);
+  EXPECT_FALSE(probe.drained());
+  std::this_thread::sleep_for(20ms);
+  ring->release(RAW_CURSOR_STORAGE, 1000);
+  EXPECT_TRUE(probe.drained());
+
+  const PipelineReport report = probe.stop();
+  EXPECT_EQ(report.fed, 1000);
+  EXPECT_EQ(report.discarded, 0);
+  for(const auto& lat : report.latencies){ ASSERT_EQ(lat.size(), 1); }
+  const double ring_ = report.percentile(PipelineStage::RING, 0.5);
+  const double processed = report.percentile(PipelineStage::PROCESSED, 0.5);
+  const double stored = report.percentile(PipelineStage::STORED, 0.5);
+  // stages are 20ms apart, marks are taken within a few intervals
+  EXPECT_GE(ring_, 0.01);
+  EXPECT_GE(processed, ring_ + 0.01);
+  EXPECT_GE(stored, processed + 0.01);
+  EXPECT_NEAR(report.seconds, stored, 0.01);
+
+  EXPECT_EQ(report.processingDepth.peak, 1000);
+  EXPECT_EQ(report.storageDepth.peak, 1000);
+  EXPECT_EQ(report.speciesDepth.peak, 1);
+  EXPECT_GT(report.storageDepth.mean, report.processingDepth.mean);
+}
+
+TEST_F(PipelineProbeFixture, discardedHitsCountAsHandled) {
+  using namespace std::chrono_literals;
+  PipelineProbe probe(ring, speciesQ, overflow, 100us);
+  probe.start();
+
+  // 5000 hits into a 4096 element ring: 904 are lost
+  for(int i = 0; i < 5; ++i){
+    push(1000);
+    probe.fed((i + 1) * 1000);
+  }
+  ring->release(RAW_CURSOR_PROCESSING, 4096);
+  ring->release(RAW_CURSOR_STORAGE, 4096);
+  EXPECT_TRUE(probe.drained());
+
+  const PipelineReport report = probe.stop();
+  EXPECT_EQ(report.fed, 5000);
+  EXPECT_EQ(report.discarded, 904);
+  for(size_t s = 0; s < PIPELINE_STAGES; ++s){
+    EXPECT_EQ(report.handled[s], 5000);
+    EXPECT_FALSE(report.latencies[s].empty());
+  }
+}
+
+TEST(PipelineReportTest, percentiles) {
+  PipelineReport report;
+  EXPECT_EQ(report.percentile(PipelineStage::STORED, 0.5), 0);
+  for(int i = 1; i <= 100; ++i){ report.latencies[0].push_back(i); }
+  EXPECT_EQ(report.percentile(PipelineStage::RING, 0), 1);
+  EXPECT_EQ(report.percentile(PipelineStage::RING, 0.5), 51);
+  EXPECT_EQ(report.percentile(PipelineStage::RING, 0.99), 100);
+  EXPECT_EQ(report.percentile(PipelineStage::RING, 1), 100);
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "RadixSort.hpp"
+
+namespace {
+
+struct Item {
+  uint64_t key;
+  size_t order;
+};
+
+std::vector<const Item*> sortItems(const std::vector<Item>& items){
+  std::vector<const Item*> out;
+  RadixScratch<Item> scratch;
+  radixSortPtrs(items.data(), items.size(),
+    [](const Item& it){ return it.key; }, out, scratch);
+  return out;
+}
+
+void expectSortedAndStable(const std::vector<const Item*>& out, size_t n){
+  ASSERT_EQ(out.size(), n);
+  for (size_t i = 1; i < n; ++i) {
+    ASSERT_LE(out[i-1]->key, out[i]->key);
+    if (out[i-1]->key == out[i]->key) {
+      ASSERT_LT(out[i-1]->order, out[i]->order) << "not stable";
+    }
+  }
+}
+
+} // namespace
+
+TEST(RadixSortTest, sortsFullRangeKeys) {
+  std::mt19937_64 rng(1);
+  std::vector<Item> items(10000);
+  for (size_t i = 0; i < items.size(); ++i) { items[i] = {rng(), i}; }
+  expectSortedAndStable(sortItems(items), items.size());
+}
+
+TEST(RadixSortTest, sortsNarrowRangeWithLargeBase) {
+  std::mt19937_64 rng(2);
+  std::vector<Item> items(5000);
+  for (size_t i = 0; i < items.size(); ++i) {
+    items[i] = {(1ull << 50) + rng() % 300, i};
+  }
+  expectSortedAndStable(sortItems(items), items.size());
+}
+
+TEST(RadixSortTest, allKeysEqual) {
+  std::vector<Item> items(1000);
+  for (size_t i = 0; i < items.size(); ++i) { items[i] = {42, i}; }
+  auto out = sortItems(items);
+  expectSortedAndStable(out, items.size());
+  EXPECT_EQ(out[0], &items[0]);
+}
+
+TEST(RadixSortTest, smallBatchFallback) {
+  std::vector<Item> items = {{5,0},{1,1},{5,2},{0,3}};
+  ASSERT_LT(items.size(), RADIX_SORT_MIN);
+  auto out = sortItems(items);
+  expectSortedAndStable(out, items.size());
+  EXPECT_EQ(out[0]->order, 3);
+}
+
+TEST(RadixSortTest, emptyBatch) {
+  std::vector<Item> items;
+  EXPECT_TRUE(sortItems(items).empty());
+}
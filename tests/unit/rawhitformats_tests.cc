@@ -0,0 +1,423 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "RawHitFormats.hpp"
+
+class RawHitFormatsFixture : public ::testing::Test {
+  protected:
+    const std::string path = "rawhitformats_test.bin";
+    const std::string header = "# Software: SPRINT3 test\n# Chip ID: none\n";
+
+    std::vector<mode::pixel_type> makeHits(size_t n){
+      std::vector<mode::pixel_type> hits(n);
+      for (size_t i = 0; i < n; ++i) {
+        hits[i] = {};
+        hits[i].coord.x = static_cast<uint8_t>(i);
+        hits[i].coord.y = static_cast<uint8_t>(i * 7);
+        hits[i].toa = 0x0123456789ull * i;
+        hits[i].tot = static_cast<uint16_t>(i * 3);
+      }
+      return hits;
+    }
+
+    void TearDown() override{
+      std::remove(path.c_str());
+      std::remove((path + RAW_IDX_EXT).c_str());
+    }
+};
+
+TEST_F(RawHitFormatsFixture, binaryRoundTrip) {
+  // spans several blocks, last one partially filled
+  auto hits = makeHits(2 * RAW_BLOCK_RECORDS + 17);
+  {
+    BinaryRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+    writer.write(hits.data(), 10);
+    writer.write(hits.data() + 10, hits.size() - 10);
+  }
+
+  RawHitReader reader(path);
+  EXPECT_EQ(reader.version(), RAW_BIN_VERSION);
+  EXPECT_EQ(reader.metadata(), header);
+
+  std::vector<mode::pixel_type> block;
+  ASSERT_TRUE(reader.readBlock(block));
+  EXPECT_EQ(block.size(), RAW_BLOCK_RECORDS);
+
+  RawHitReader again(path);
+  auto read = again.readAll();
+  ASSERT_EQ(read.size(), hits.size());
+  for (size_t i = 0; i < hits.size(); ++i) {
+    ASSERT_EQ(read[i].coord.x, hits[i].coord.x);
+    ASSERT_EQ(read[i].coord.y, hits[i].coord.y);
+    ASSERT_EQ(read[i].toa, hits[i].toa);
+    ASSERT_EQ(read[i].tot, hits[i].tot);
+  }
+}
+
+TEST_F(RawHitFormatsFixture, binaryFileSize) {
+  auto hits = makeHits(100);
+  {
+    BinaryRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+    writer.write(hits.data(), hits.size());
+  }
+  std::ifstream f(path, std::ios::binary | std::ios::ate);
+  EXPECT_EQ(static_cast<size_t>(f.tellg()),
+    sizeof(RAW_BIN_MAGIC) + 8 + header.size()
+    + RAW_BLOCK_HEADER_SIZE + hits.size() * RAW_BIN_RECORD_SIZE);
+}
+
+TEST_F(RawHitFormatsFixture, emptyFileHasNoBlocks) {
+  {
+    BinaryRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+  }
+  RawHitReader reader(path);
+  std::vector<mode::pixel_type> block;
+  EXPECT_FALSE(reader.readBlock(block));
+}
+
+TEST_F(RawHitFormatsFixture, readerRejectsUnknownVersion) {
+  auto hits = makeHits(10);
+  {
+    BinaryRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+    writer.write(hits.data(), hits.size());
+  }
+  {
+    std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(8);
+    f.put(static_cast<char>(RAW_BIN_VERSION + 1));
+  }
+  EXPECT_THROW(RawHitReader reader(path), std::runtime_error);
+}
+
+TEST_F(RawHitFormatsFixture, textFormatUnchanged) {
+  auto hits = makeHits(2);
+  {
+    TextRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+    writer.write(hits.data(), hits.size());
+  }
+  std::ifstream f(path);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  EXPECT_EQ(ss.str(), header + "0 0 0 0\n1 7 4886718345 3\n");
+}
+
+TEST_F(RawHitFormatsFixture, readerRejectsNonBinaryFile) {
+  {
+    TextRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+  }
+  EXPECT_THROW(RawHitReader reader(path), std::runtime_error);
+}
+
+TEST_F(RawHitFormatsFixture, readerStopsAtTruncatedBlock) {
+  auto hits = makeHits(100);
+  {
+    BinaryRawHitWriter writer;
+    ASSERT_TRUE(writer.open(path, header));
+    writer.write(hits.data(), hits.size());
+  }
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size() - 5);
+
+  RawHitReader reader(path);
+  std::vector<mode::pixel_type> block;
+  EXPECT_FALSE(reader.readBlock(block));
+  EXPECT_TRUE(block.empty());
+  EXPECT_TRUE(reader.truncated());
+}
+
+TEST_F(RawHitFormatsFixture, columnarRoundTrip) {
+  // includes toa steps backwards and a huge jump
+  auto hits = makeHits(RAW_BLOCK_RECORDS + 500);
+  hits[3].toa = hits[2].toa - 5;
+  hits[100].toa = UINT64_MAX;
+  hits[101].toa = 0;
+  {
+    BinaryRawHitWriter writer(RAW_BLOCK_COLUMNAR);
+    ASSERT_TRUE(writer.open(path, header));
+    writer.write(hits.data(), hits.size());
+  }
+
+  RawHitReader reader(path);
+  EXPECT_EQ(reader.metadata(), header);
+  std::vector<mode::pixel_type> block;
+  ASSERT_TRUE(reader.readBlock(block));
+  EXPECT_EQ(reader.lastBlock().encoding, RAW_BLOCK_COLUMNAR);
+  EXPECT_EQ(reader.lastBlock().minToa, 0);
+  EXPECT_EQ(reader.lastBlock().maxToa, UINT64_MAX);
+
+  RawHitReader again(path);
+  auto read = again.readAll();
+  ASSERT_EQ(read.size(), hits.size());
+  for (size_t i = 0; i < hits.size(); ++i) {
+    ASSERT_EQ(read[i].coord.x, hits[i].coord.x);
+    ASSERT_EQ(read[i].coord.y, hits[i].coord.y);
+    ASSERT_EQ(read[i].toa, hits[i].toa);
+    ASSERT_EQ(read[i].tot, hits[i].tot);
+  }
+}
+
+TEST_F(RawHitFormatsFixture, columnarBlockHeaderMinMax) {
+  auto hits = makeHits(10);
+  std::vector<uint8_t> out;
+  encodeRawBlock(RAW_BLOCK_COLUMNAR, hits.data() + 1, 9, out);
+  RawBlockInfo info = {RAW_BLOCK_COLUMNAR, 9,
+    static_cast<uint32_t>(out.size() - RAW_BLOCK_HEADER_SIZE),
+    hits[1].toa, hits[9].toa};
+
+  std::vector<mode::pixel_type> decoded;
+  decodeRawBlock(info, out.data() + RAW_BLOCK_HEADER_SIZE, decoded);
+  ASSERT_EQ(decoded.size(), 9);
+  EXPECT_EQ(decoded[8].toa, hits[9].toa);
+}
+
+TEST_F(RawHitFormatsFixture, columnarIsSmallerForNearSortedToa) {
+  // realistic stream: toa almost monotonic with small steps, small tot
+  std::vector<mode::pixel_type> hits(RAW_BLOCK_RECORDS);
+  uint64_t toa = 1ull << 40;
+  for (size_t i = 0; i < hits.size(); ++i) {
+    hits[i] = {};
+    hits[i].coord.x = static_cast<uint8_t>(i * 13);
+    hits[i].coord.y = static_cast<uint8_t>(i * 29);
+    toa += (i % 7 == 0) ? 0 : (i % 5) * 11;
+    hits[i].toa = (i % 31 == 0) ? toa - 3 : toa;
+    hits[i].tot = static_cast<uint16_t>(20 + i % 200);
+  }
+  std::vector<uint8_t> fixed, columnar;
+  encodeRawBlock(RAW_BLOCK_FIXED, hits.data(), hits.size(), fixed);
+  encodeRawBlock(RAW_BLOCK_COLUMNAR, hits.data(), hits.size(), columnar);
+  EXPECT_LT(columnar.size() * 2, fixed.size());
+
+  // narrow values: both columns take the bit-packed path
+  RawBlockInfo info = {RAW_BLOCK_COLUMNAR, static_cast<uint32_t>(hits.size()),
+    static_cast<uint32_t>(columnar.size() - RAW_BLOCK_HEADER_SIZE),
+    hits[0].toa, toa};
+  const uint8_t* payload = columnar.data() + RAW_BLOCK_HEADER_SIZE;
+  EXPECT_EQ(payload[2 * hits.size()], RAW_COLUMN_BITPACK);
+
+  std::vector<mode::pixel_type> decoded;
+  decodeRawBlock(info, payload, decoded);
+  for (size_t i = 0; i < hits.size(); ++i) {
+    ASSERT_EQ(decoded[i].toa, hits[i].toa);
+    ASSERT_EQ(decoded[i].tot, hits[i].tot);
+  }
+}
+
+TEST_F(RawHitFormatsFixture, columnarRejectsTruncatedPayload) {
+  auto hits = makeHits(50);
+  std::vector<uint8_t> out;
+  encodeRawBlock(RAW_BLOCK_COLUMNAR, hits.data(), hits.size(), out);
+  RawBlockInfo info = {RAW_BLOCK_COLUMNAR, 50,
+    static_cast<uint32_t>(out.size() - RAW_BLOCK_HEADER_SIZE - 3), 0, 0};
+
+  std::vector<mode::pixel_type> decoded;
+  EXPECT_THROW(
+    decodeRawBlock(info, out.data() + RAW_BLOCK_HEADER_SIZE, decoded),
+    std::runtime_error
+  );
+}
+
+TEST_F(RawHitFormatsFixture, rejectsCorruptRecordCount) {
+  auto hits = makeHits(50);
+  std::vector<uint8_t> out;
+  encodeRawBlock(RAW_BLOCK_COLUMNAR, hits.data(), hits.size(), out);
+  const uint32_t payloadLen = static_cast<uint32_t>(out.size() - RAW_BLOCK_HEADER_SIZE);
+  std::vector<mode::pixel_type> decoded;
+
+  // a flipped high bit must be rejected before anything is allocated for it
+  RawBlockInfo info = {RAW_BLOCK_COLUMNAR, 0x80000032u, payloadLen, 0, 0};
+  EXPECT_THROW(
+    decodeRawBlock(info, out.data() + RAW_BLOCK_HEADER_SIZE, decoded),
+    std::runtime_error
+  );
+
+  // in range, but more hits than the payload has x and y bytes for
+  info.records = static_cast<uint32_t>(payloadLen / 2 + 1);
+  EXPECT_THROW(
+    decodeRawBlock(info, out.data() + RAW_BLOCK_HEADER_SIZE, decoded),
+    std::runtime_error
+  );
+}
+
+class RawHitIndexFixture : public RawHitFormatsFixture {
+  protected:
+    // blocks cover consecutive toa ranges of RAW_BLOCK_RECORDS hits each
+    std::vector<mode::pixel_type> writeBlocks(size_t blocks, uint16_t encoding){
+      std::vector<mode::pixel_type> hits(blocks * RAW_BLOCK_RECORDS);
+      for (size_t i = 0; i < hits.size(); ++i) {
+        hits[i] = {};
+        hits[i].coord.x = static_cast<uint8_t>(i);
+        hits[i].toa = 1000 + 2 * i;
+      }
+      BinaryRawHitWriter writer(encoding);
+      EXPECT_TRUE(writer.open(path, header));
+      writer.write(hits.data(), hits.size());
+      return hits;
+    }
+
+    const std::string textPath = "rawhitformats_test.txt";
+
+    // as writeBlocks, plus extra hits in a partial last group, as text lines
+    std::vector<mode::pixel_type> writeTextLines(size_t blocks, size_t extra){
+      std::vector<mode::pixel_type> hits(blocks * RAW_BLOCK_RECORDS + extra);
+      for (size_t i = 0; i < hits.size(); ++i) {
+        hits[i] = {};
+        hits[i].coord.x = static_cast<uint8_t>(i);
+        hits[i].coord.y = static_cast<uint8_t>(i >> 8);
+        hits[i].toa = 1000 + 2 * i;
+        hits[i].tot = static_cast<uint16_t>(i % 1000);
+      }
+      TextRawHitWriter writer;
+      EXPECT_TRUE(writer.open(textPath, header));
+      writer.write(hits.data(), hits.size());
+      return hits;
+    }
+
+    void TearDown() override{
+      std::remove(textPath.c_str());
+      std::remove((textPath + RAW_IDX_EXT).c_str());
+      RawHitFormatsFixture::TearDown();
+    }
+};
+
+TEST_F(RawHitIndexFixture, sidecarHasEntryPerBlock) {
+  auto hits = writeBlocks(3, RAW_BLOCK_FIXED);
+  auto index = RawHitIndex::forFile(path);
+  ASSERT_EQ(index.entries().size(), 3);
+  EXPECT_EQ(index.entries()[1].records, RAW_BLOCK_RECORDS);
+  EXPECT_EQ(index.entries()[1].minToa, hits[RAW_BLOCK_RECORDS].toa);
+  EXPECT_EQ(index.entries()[1].maxToa, hits[2 * RAW_BLOCK_RECORDS - 1].toa);
+
+  RawHitReader reader(path);
+  std::vector<mode::pixel_type> block;
+  reader.seek(index.entries()[2].offset);
+  ASSERT_TRUE(reader.readBlock(block));
+  EXPECT_EQ(block[0].toa, hits[2 * RAW_BLOCK_RECORDS].toa);
+}
+
+TEST_F(RawHitIndexFixture, queryReturnsOnlyInterval) {
+  for (uint16_t encoding : {RAW_BLOCK_FIXED, RAW_BLOCK_COLUMNAR}) {
+    auto hits = writeBlocks(4, encoding);
+    // straddles the boundary between block 1 and 2
+    const uint64_t from = hits[2 * RAW_BLOCK_RECORDS - 10].toa - 1;
+    const uint64_t to = hits[2 * RAW_BLOCK_RECORDS + 10].toa;
+
+    std::vector<mode::pixel_type> out;
+    EXPECT_EQ(queryRawHits(path, from, to, out), 21);
+    ASSERT_EQ(out.size(), 21);
+    EXPECT_EQ(out.front().toa, hits[2 * RAW_BLOCK_RECORDS - 10].toa);
+    EXPECT_EQ(out.back().toa, to);
+  }
+}
+
+TEST_F(RawHitIndexFixture, missingOrStaleSidecarFallsBackToScan) {
+  auto hits = writeBlocks(3, RAW_BLOCK_FIXED);
+
+  // drop the last entry, as if the run died between block and index write
+  std::filesystem::resize_file(path + RAW_IDX_EXT,
+    RAW_IDX_HEADER_SIZE + 2 * RAW_IDX_ENTRY_SIZE);
+  EXPECT_EQ(RawHitIndex::forFile(path).entries().size(), 3);
+
+  std::remove((path + RAW_IDX_EXT).c_str());
+  auto index = RawHitIndex::forFile(path);
+  ASSERT_EQ(index.entries().size(), 3);
+  EXPECT_EQ(index.entries()[2].maxToa, hits.back().toa);
+}
+
+TEST_F(RawHitIndexFixture, truncatedLastBlockEndsData) {
+  for (uint16_t encoding : {RAW_BLOCK_FIXED, RAW_BLOCK_COLUMNAR}) {
+    auto hits = writeBlocks(3, encoding);
+    const uint64_t lastOffset = RawHitIndex::forFile(path).entries()[2].offset;
+
+    // cut inside the last payload, then inside its header; the sidecar still
+    // lists the block, as if it reached the disk before the data
+    for (uint64_t cut : {lastOffset + RAW_BLOCK_HEADER_SIZE + 100, lastOffset + 5}) {
+      std::filesystem::resize_file(path, cut);
+      auto index = RawHitIndex::forFile(path);
+      EXPECT_EQ(index.entries().size(), 2);
+      EXPECT_TRUE(index.truncated());
+
+      std::vector<mode::pixel_type> out;
+      bool truncated = false;
+      const uint64_t from = hits[RAW_BLOCK_RECORDS - 5].toa;
+      EXPECT_EQ(queryRawHits(path, from, hits.back().toa, out, &truncated), 5 + RAW_BLOCK_RECORDS);
+      EXPECT_TRUE(truncated);
+      ASSERT_FALSE(out.empty());
+      EXPECT_EQ(out.back().toa, hits[2 * RAW_BLOCK_RECORDS - 1].toa);
+
+      RawHitReader reader(path);
+      EXPECT_EQ(reader.readAll().size(), 2 * RAW_BLOCK_RECORDS);
+      EXPECT_TRUE(reader.truncated());
+    }
+  }
+}
+
+TEST_F(RawHitIndexFixture, textFilesAreIndexedAndQueried) {
+  auto hits = writeTextLines(3, 17);
+  auto index = RawHitIndex::forFile(textPath);
+  ASSERT_EQ(index.entries().size(), 4);
+  EXPECT_FALSE(index.truncated());
+  EXPECT_EQ(index.entries()[0].offset, header.size());
+  EXPECT_EQ(index.entries()[1].minToa, hits[RAW_BLOCK_RECORDS].toa);
+  EXPECT_EQ(index.entries()[3].records, 17);
+  EXPECT_EQ(index.entries()[3].maxToa, hits.back().toa);
+
+  // straddles the boundary between group 1 and 2, with and without sidecar
+  const uint64_t from = hits[2 * RAW_BLOCK_RECORDS - 10].toa;
+  const uint64_t to = hits[2 * RAW_BLOCK_RECORDS + 10].toa;
+  for (int pass = 0; pass < 2; ++pass) {
+    std::vector<mode::pixel_type> out;
+    EXPECT_EQ(queryRawHits(textPath, from, to, out), 21);
+    ASSERT_EQ(out.size(), 21);
+    EXPECT_EQ(out.front().coord.x, hits[2 * RAW_BLOCK_RECORDS - 10].coord.x);
+    EXPECT_EQ(out.front().coord.y, hits[2 * RAW_BLOCK_RECORDS - 10].coord.y);
+    EXPECT_EQ(out.front().tot, hits[2 * RAW_BLOCK_RECORDS - 10].tot);
+    EXPECT_EQ(out.back().toa, to);
+    std::remove((textPath + RAW_IDX_EXT).c_str());
+  }
+  EXPECT_EQ(RawHitIndex::forFile(textPath).entries().size(), 4);
+}
+
+TEST_F(RawHitIndexFixture, textTruncatedLastLineEndsData) {
+  auto hits = writeTextLines(3, 0);
+  const uint64_t lastOffset = RawHitIndex::forFile(textPath).entries()[2].offset;
+
+  // cut inside a line of the last group, which the sidecar still lists
+  std::filesystem::resize_file(textPath, lastOffset + 100);
+  auto index = RawHitIndex::forFile(textPath);
+  ASSERT_EQ(index.entries().size(), 3);
+  EXPECT_TRUE(index.truncated());
+  EXPECT_EQ(index.entries()[2].offset, lastOffset);
+  EXPECT_LT(index.entries()[2].records, RAW_BLOCK_RECORDS);
+
+  std::vector<mode::pixel_type> out;
+  bool truncated = false;
+  EXPECT_EQ(queryRawHits(textPath, hits[0].toa, hits[2 * RAW_BLOCK_RECORDS - 1].toa, out, &truncated),
+    2 * RAW_BLOCK_RECORDS);
+  EXPECT_TRUE(truncated);
+}
+
+TEST_F(RawHitIndexFixture, findRunFilesOrdersByFileNumber) {
+  const auto dir = std::filesystem::temp_directory_path() / "rawhitindex_test";
+  std::filesystem::create_directories(dir);
+  for (const char* name : {"rawHits_RN-7_FN-10.bin", "rawHits_RN-7_FN-2.bin",
+                           "rawHits_RN-7_FN-2.bin.idx", "rawHits_RN-17_FN-1.bin",
+                           "rawHits_RN-7_FN-3.txt", "rawHits_RN-7_FN-4.txt.idx"}) {
+    std::ofstream(dir / name);
+  }
+
+  auto files = findRunFiles(dir.string(), "7");
+  ASSERT_EQ(files.size(), 3);
+  EXPECT_EQ(files[0].filename(), "rawHits_RN-7_FN-2.bin");
+  EXPECT_EQ(files[1].filename(), "rawHits_RN-7_FN-3.txt");
+  EXPECT_EQ(files[2].filename(), "rawHits_RN-7_FN-10.bin");
+  std::filesystem::remove_all(dir);
+}
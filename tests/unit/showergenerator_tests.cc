@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+#include "ShowerGenerator.hpp"
+
+namespace {
+
+std::vector<mode::pixel_type> generate(ShowerGenerator& gen, size_t n){
+  std::vector<mode::pixel_type> hits(n);
+  EXPECT_EQ(gen.generate(hits.data(), n), n);
+  return hits;
+}
+
+// hits per second of toa covered by hits
+double hitRate(const std::vector<mode::pixel_type>& hits){
+  const auto [lo, hi] = std::minmax_element(hits.begin(), hits.end(),
+    [](const auto& a, const auto& b){ return a.toa < b.toa; });
+  return hits.size() / ((hi->toa - lo->toa) / TOA_TICKS_PER_SEC);
+}
+
+} // namespace
+
+TEST(ShowerGeneratorTest, sameSeedSameStream) {
+  ShowerSettings settings;
+  ShowerGenerator a(settings), b(settings);
+  settings.seed = 2;
+  ShowerGenerator c(settings);
+
+  // chunking does not change the stream
+  auto hitsA = generate(a, 10000);
+  std::vector<mode::pixel_type> hitsB(10000);
+  b.generate(hitsB.data(), 3);
+  b.generate(hitsB.data() + 3, hitsB.size() - 3);
+  const auto hitsC = generate(c, 10000);
+
+  size_t same = 0;
+  for(size_t i = 0; i < hitsA.size(); ++i){
+    ASSERT_EQ(hitsA[i].toa, hitsB[i].toa);
+    ASSERT_EQ(hitsA[i].coord.x, hitsB[i].coord.x);
+    ASSERT_EQ(hitsA[i].tot, hitsB[i].tot);
+    same += hitsA[i].toa == hitsC[i].toa && hitsA[i].coord.x == hitsC[i].coord.x;
+  }
+  EXPECT_LT(same, hitsA.size() / 10);
+  EXPECT_EQ(a.stats().hits, 10000);
+}
+
+TEST(ShowerGeneratorTest, hitsAreValidAndReadoutOrdered) {
+  ShowerSettings settings;
+  settings.particleRate = 5e6;
+  ShowerGenerator gen(settings);
+  const auto hits = generate(gen, 200000);
+
+  // within a readout window hits come by double column, so no hit is older
+  // than the window (plus timewalk) behind the newest one seen
+  uint64_t newest = 0;
+  size_t outOfOrder = 0;
+  for(const auto& px : hits){
+    ASSERT_GE(px.tot, 1);
+    ASSERT_LE(px.tot, 1023);
+    ASSERT_GE(px.toa + settings.readoutWindow + CLUSTER_TOA_WINDOW, newest);
+    outOfOrder += px.toa < newest;
+    newest = std::max<uint64_t>(newest, px.toa);
+  }
+  EXPECT_GT(outOfOrder, hits.size() / 10);
+
+  settings.readoutWindow = 0;
+  ShowerGenerator ordered(settings);
+  newest = 0;
+  for(const auto& px : generate(ordered, 200000)){
+    ASSERT_GE(px.toa + CLUSTER_TOA_WINDOW, newest);
+    newest = std::max<uint64_t>(newest, px.toa);
+  }
+}
+
+TEST(ShowerGeneratorTest, followsSpeciesMixAndFlux) {
+  ShowerSettings settings;
+  settings.xrayWeight = 0.5;
+  settings.mipWeight = 0.3;
+  settings.heavyIonWeight = 0.2;
+  settings.noisyPixels = 0;
+  ShowerGenerator gen(settings);
+  generate(gen, 1000000);
+
+  const auto& particles = gen.stats().particles;
+  const double total = particles[0] + particles[1] + particles[2];
+  EXPECT_NEAR(particles[size_t(ParticleKind::XRAY)] / total, 0.5, 0.02);
+  EXPECT_NEAR(particles[size_t(ParticleKind::MIP)] / total, 0.3, 0.02);
+  EXPECT_NEAR(particles[size_t(ParticleKind::HEAVY_ION)] / total, 0.2, 0.02);
+  EXPECT_EQ(particles[size_t(ParticleKind::NOISE)], 0);
+
+  // single pixel x-rays only: one hit per particle
+  ShowerSettings single;
+  single.mipWeight = single.heavyIonWeight = 0;
+  single.xraySizeWeights = {1, 0, 0, 0};
+  single.noisyPixels = 0;
+  single.particleRate = 2e6;
+  ShowerGenerator singles(single);
+  EXPECT_NEAR(hitRate(generate(singles, 500000)), 2e6, 2e6 * 0.02);
+}
+
+TEST(ShowerGeneratorTest, noiseOnlyWithoutParticleWeights) {
+  ShowerSettings settings;
+  settings.xrayWeight = settings.mipWeight = settings.heavyIonWeight = 0;
+  ShowerGenerator gen(settings);
+  const auto hits = generate(gen, 100000);
+
+  const auto& particles = gen.stats().particles;
+  EXPECT_EQ(particles[size_t(ParticleKind::XRAY)], 0);
+  EXPECT_EQ(particles[size_t(ParticleKind::MIP)], 0);
+  EXPECT_EQ(particles[size_t(ParticleKind::HEAVY_ION)], 0);
+  EXPECT_EQ(particles[size_t(ParticleKind::NOISE)], hits.size());
+  for(const auto& px : hits){ ASSERT_LE(px.tot, settings.noiseTotMax); }
+  const double rate = settings.noisyPixels * settings.noiseRate;
+  EXPECT_NEAR(hitRate(hits), rate, rate * 0.02);
+}
+
+TEST(ShowerGeneratorTest, xrayClustersAreSmallAndTouching) {
+  ShowerSettings settings;
+  settings.mipWeight = settings.heavyIonWeight = 0;
+  settings.noisyPixels = 0;
+  settings.readoutWindow = 0;
+  settings.timewalk = 0;
+  settings.particleRate = 10; // clusters far apart in time
+  ShowerGenerator gen(settings);
+  const auto hits = generate(gen, 100000);
+
+  // group hits by toa: each group is one x-ray
+  std::vector<size_t> sizes(5);
+  for(size_t i = 0; i < hits.size(); ){
+    size_t j = i + 1;
+    while(j < hits.size() && hits[j].toa == hits[i].toa){
+      EXPECT_LE(std::abs(hits[j].coord.x - hits[i].coord.x), 1);
+      EXPECT_LE(std::abs(hits[j].coord.y - hits[i].coord.y), 1);
+      ++j;
+    }
+    ASSERT_LE(j - i, 4);
+    ++sizes[j - i];
+    i = j;
+  }
+  EXPECT_GT(sizes[1], sizes[2]);
+  EXPECT_GT(sizes[2], sizes[3]);
+  EXPECT_GT(sizes[3], sizes[4]);
+  EXPECT_GT(sizes[4], 0);
+}
+
+TEST(ShowerGeneratorTest, matchesRequestedHitRate) {
+  const ShowerSettings settings = matchHitRate(ShowerSettings(), 3e6);
+  ShowerGenerator gen(settings);
+  EXPECT_NEAR(hitRate(generate(gen, 1000000)), 3e6, 3e6 * 0.05);
+}
+
+TEST(ShowerGeneratorTest, feedsBuffersAndEmulator) {
+  ShowerGenerator gen;
+  size_t discarded;
+
+  SafeBuff<mode::pixel_type> buf;
+  EXPECT_EQ(gen.fill(buf, 1000, discarded), 1000);
+  EXPECT_EQ(discarded, 0);
+  EXPECT_EQ(gen.fill(buf, MAX_BUFF_EL, discarded), MAX_BUFF_EL);
+  EXPECT_EQ(discarded, 1000);
+
+  BroadcastRing<mode::pixel_type> ring(1, 4096);
+  EXPECT_EQ(gen.push(ring, 5000, discarded), 4096);
+  EXPECT_EQ(discarded, 5000 - 4096);
+
+  // the emulator source yields the generator's stream
+  ShowerGenerator reference;
+  const auto expected = generate(reference, 1000);
+  auto source = showerHitSource();
+  std::vector<mode::pixel_type> hits(1000);
+  ASSERT_EQ(source(hits.data(), hits.size()), hits.size());
+  for(size_t i = 0; i < hits.size(); ++i){
+    ASSERT_EQ(hits[i].toa, expected[i].toa);
+  }
+}
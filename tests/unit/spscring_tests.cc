@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+#include "CustomDataTypes.hpp"
+
+TEST(SpscRingTest, capacityRoundsUpToPow2) {
+  SpscRing<int> ring(1000);
+  EXPECT_EQ(ring.capacity(), 1024);
+}
+
+TEST(SpscRingTest, pushPopGeneral) {
+  SpscRing<int> ring(16);
+  int fakeData[] = {1,2,3};
+  size_t discard;
+  EXPECT_EQ(3, ring.push(fakeData, 3, discard));
+  EXPECT_EQ(discard, 0);
+  EXPECT_EQ(ring.size(), 3);
+
+  int recvBuf[3];
+  EXPECT_EQ(3, ring.pop(recvBuf, 3));
+  EXPECT_EQ(ring.size(), 0);
+  EXPECT_TRUE(0 == std::memcmp(recvBuf, fakeData, sizeof(fakeData)));
+}
+
+TEST(SpscRingTest, pushOverflowDiscards) {
+  SpscRing<int> ring(8);
+  int fakeData[10] = {0};
+  size_t discard;
+  EXPECT_EQ(8, ring.push(fakeData, 10, discard));
+  EXPECT_EQ(discard, 2);
+
+  // remove one, then only one more fits
+  int recvBuf[1];
+  EXPECT_EQ(1, ring.pop(recvBuf, 1));
+  EXPECT_EQ(8, ring.push(fakeData, 2, discard));
+  EXPECT_EQ(discard, 1);
+}
+
+TEST(SpscRingTest, popLessThanAvailable) {
+  SpscRing<int> ring(16);
+  int fakeData[10] = {1,2,3,4,5,6,7,8,9,10};
+  size_t discard;
+  ring.push(fakeData, 10, discard);
+
+  int recvBuf[5];
+  EXPECT_EQ(5, ring.pop(recvBuf, 5));
+  EXPECT_EQ(ring.size(), 5);
+  EXPECT_TRUE(0 == std::memcmp(recvBuf, fakeData, sizeof(recvBuf)));
+  EXPECT_EQ(5, ring.pop(recvBuf, 5));
+  EXPECT_TRUE(0 == std::memcmp(recvBuf, fakeData + 5, sizeof(recvBuf)));
+}
+
+TEST(SpscRingTest, wrapAroundKeepsOrder) {
+  SpscRing<int> ring(8);
+  int first[6] = {0,1,2,3,4,5};
+  int second[6] = {6,7,8,9,10,11};
+  size_t discard;
+  int recvBuf[6];
+
+  ring.push(first, 6, discard);
+  EXPECT_EQ(6, ring.pop(recvBuf, 6));
+  ring.push(second, 6, discard);
+  EXPECT_EQ(discard, 0);
+
+  // readable region wraps: peek only exposes the contiguous part
+  const int* data;
+  EXPECT_EQ(2, ring.peek(data, 6));
+  EXPECT_EQ(data[0], 6);
+
+  EXPECT_EQ(6, ring.pop(recvBuf, 6));
+  EXPECT_TRUE(0 == std::memcmp(recvBuf, second, sizeof(second)));
+}
+
+TEST(SpscRingTest, concurrentProducerConsumer) {
+  auto ring = std::make_shared<SpscRing<uint64_t>>(1024);
+  constexpr uint64_t total = 1000000;
+
+  std::jthread producer([&]{
+    uint64_t next = 0;
+    uint64_t chunk[100];
+    while (next < total) {
+      size_t n = std::min<uint64_t>(100, total - next);
+      std::iota(chunk, chunk + n, next);
+      size_t discard;
+      ring->push(chunk, n, discard);
+      next += n - discard;
+      if (discard) { std::this_thread::yield(); }
+    }
+  });
+
+  uint64_t expected = 0;
+  std::vector<uint64_t> recvBuf(512);
+  std::stop_source stop;
+  while (expected < total) {
+    ring->waitForData(stop.get_token());
+    size_t n = ring->pop(recvBuf.data(), recvBuf.size());
+    for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(recvBuf[i], expected++);
+    }
+  }
+}
+
+TEST(SpscRingTest, waitForDataWakesOnThreshold) {
+  auto ring = std::make_shared<SpscRing<int>>(64);
+  std::atomic<bool> woke = false;
+
+  std::jthread consumer([&](std::stop_token stoken){
+    while (!stoken.stop_requested() && !ring->waitForData(stoken, 10)) {}
+    woke = ring->size() >= 10;
+  });
+
+  int fakeData[10] = {0};
+  size_t discard;
+  ring->push(fakeData, 10, discard);
+  consumer.join();
+  EXPECT_TRUE(woke);
+}
+
+TEST(SpscRingTest, safeFinish) {
+  auto ring = std::make_shared<SpscRing<int>>(64);
+
+  std::jthread t = std::jthread([&](std::stop_token stoken){
+    while (!stoken.stop_requested()) {
+      ring->waitForData(stoken);
+    }
+  });
+
+  safe_finish(t, ring);
+  EXPECT_FALSE(t.joinable());
+}
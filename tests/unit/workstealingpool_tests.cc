@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "WorkStealingPool.hpp"
+
+TEST(WorkStealingPoolTest, runsEveryTaskOnce) {
+  WorkStealingPool pool(4);
+  ASSERT_EQ(pool.size(), 4u);
+
+  std::vector<std::atomic<int>> runs(1000);
+  pool.run(runs.size(), [&](size_t task, size_t worker){
+    ASSERT_LT(worker, pool.size());
+    runs[task]++;
+  });
+  for (auto& r : runs) { EXPECT_EQ(r.load(), 1); }
+}
+
+TEST(WorkStealingPoolTest, reusableAcrossBatches) {
+  WorkStealingPool pool(3);
+  std::atomic<size_t> sum = 0;
+  for (size_t batch = 1; batch <= 50; ++batch) {
+    pool.run(batch, [&](size_t task, size_t){ sum += task + 1; });
+  }
+  // sum over batches b of b(b+1)/2
+  size_t expected = 0;
+  for (size_t b = 1; b <= 50; ++b) { expected += b * (b + 1) / 2; }
+  EXPECT_EQ(sum.load(), expected);
+}
+
+TEST(WorkStealingPoolTest, idleWorkersStealFromBusyOne) {
+  WorkStealingPool pool(4);
+  // task 0 blocks its worker until all others ran; they must be stolen
+  std::atomic<size_t> others = 0;
+  pool.run(16, [&](size_t task, size_t){
+    if (task == 0) {
+      while (others.load() < 15) { std::this_thread::yield(); }
+    } else {
+      others++;
+    }
+  });
+  EXPECT_EQ(others.load(), 15u);
+}
+
+TEST(WorkStealingPoolTest, singleWorkerRunsInline) {
+  WorkStealingPool pool(1);
+  const auto caller = std::this_thread::get_id();
+  size_t count = 0;
+  pool.run(10, [&](size_t, size_t worker){
+    EXPECT_EQ(worker, 0u);
+    EXPECT_EQ(std::this_thread::get_id(), caller);
+    ++count;
+  });
+  EXPECT_EQ(count, 10u);
+}
+
+TEST(WorkStealingPoolTest, rethrowsTaskException) {
+  WorkStealingPool pool(2);
+  std::atomic<size_t> finished = 0;
+  EXPECT_THROW(
+    pool.run(8, [&](size_t task, size_t){
+      if (task == 3) { throw std::runtime_error("task failed"); }
+      finished++;
+    }),
+    std::runtime_error
+  );
+  EXPECT_EQ(finished.load(), 7u);
+
+  // still usable afterwards
+  pool.run(4, [&](size_t, size_t){ finished++; });
+  EXPECT_EQ(finished.load(), 11u);
+}